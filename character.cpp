@@ -1,7 +1,8 @@
 #include <stdafx.h>
 #include "character.h"
+#include "pathfinding/AgentSystem.h"
 
-Character::Character() : mLinearVelocity(0.0f, 0.0f), mAngularVelocity(0.0f)
+Character::Character() : mLinearVelocity(0.0f, 0.0f), mAngularVelocity(0.0f), mAgent(AgentSystem::NO_AGENT)
 {
 	RTTI_BEGIN
 		RTTI_EXTEND (MOAIEntity2D)
@@ -22,9 +22,14 @@ public:
 	
 	USVec2D GetLinearVelocity() const { return mLinearVelocity;}
 	float GetAngularVelocity() const { return mAngularVelocity;}
+
+	// Agent of the Crowd moving the character, NO_AGENT outside of a crowd
+	void SetAgent(int agent) { mAgent = agent;}
+	int GetAgent() const { return mAgent;}
 private:
 	USVec2D mLinearVelocity;
 	float mAngularVelocity;
+	int mAgent;
 	
 	
 	
@@ -0,0 +1,185 @@
+#include <stdafx.h>
+#include "crowd.h"
+
+#include "character.h"
+#include "pathfinding/pathfinder.h"
+
+Crowd::Crowd() : MOAIEntity2D()
+{
+	RTTI_BEGIN
+		RTTI_EXTEND(MOAIEntity2D)
+	RTTI_END
+}
+
+Crowd::~Crowd()
+{
+	for (int i = 0; i < mAgents.GetAgentCount(); ++i) {
+		Character* character = mCharacters[mAgents.GetHandle(i)];
+		character->SetAgent(AgentSystem::NO_AGENT);
+		this->LuaRelease(character);
+	}
+}
+
+bool Crowd::IsInCrowd(const Character* character) const
+{
+	// The agent handle of a character of another crowd may be valid here too
+	int agent = character->GetAgent();
+	return agent != AgentSystem::NO_AGENT && static_cast<size_t>(agent) < mCharacters.size() && mCharacters[agent] == character;
+}
+
+void Crowd::AddCharacter(Character* character, float maxSpeed)
+{
+	int agent = character->GetAgent();
+	if (agent != AgentSystem::NO_AGENT) {
+		if (IsInCrowd(character)) {
+			mAgents.SetMaxSpeed(agent, maxSpeed);
+		}
+		return;
+	}
+
+	USVec2D position = character->GetLoc();
+	agent = mAgents.AddAgent(position.mX, position.mY, maxSpeed);
+	if (static_cast<size_t>(agent) >= mCharacters.size()) {
+		mCharacters.resize(agent + 1, nullptr);
+	}
+	mCharacters[agent] = character;
+	character->SetAgent(agent);
+	// The crowd keeps its characters alive while they are in it
+	this->LuaRetain(character);
+}
+
+void Crowd::RemoveCharacter(Character* character)
+{
+	if (!IsInCrowd(character)) {
+		return;
+	}
+	int agent = character->GetAgent();
+	mAgents.RemoveAgent(agent);
+	mCharacters[agent] = nullptr;
+	character->SetAgent(AgentSystem::NO_AGENT);
+	this->LuaRelease(character);
+}
+
+void Crowd::FollowPath(Character* character, const Pathfinder& pathfinder)
+{
+	if (!IsInCrowd(character)) {
+		return;
+	}
+	int agent = character->GetAgent();
+	const std::vector<USVec2D>& waypoints = pathfinder.GetWaypoints();
+	mPoints.clear();
+	for (const USVec2D& waypoint : waypoints) {
+		mPoints.push_back(waypoint.mX);
+		mPoints.push_back(waypoint.mY);
+	}
+	mAgents.SetPath(agent, mPoints.data(), static_cast<int>(waypoints.size()));
+}
+
+bool Crowd::HasArrived(const Character* character) const
+{
+	return IsInCrowd(character) && mAgents.HasArrived(character->GetAgent());
+}
+
+void Crowd::OnUpdate(float step)
+{
+	mAgents.Update(step);
+
+	const float* positionsX = mAgents.GetPositionsX();
+	const float* positionsY = mAgents.GetPositionsY();
+	const float* velocitiesX = mAgents.GetVelocitiesX();
+	const float* velocitiesY = mAgents.GetVelocitiesY();
+	const float* rotations = mAgents.GetRotations();
+	const float* angularVelocities = mAgents.GetAngularVelocities();
+	for (int i = 0; i < mAgents.GetAgentCount(); ++i) {
+		Character* character = mCharacters[mAgents.GetHandle(i)];
+		character->SetLoc(USVec2D(positionsX[i], positionsY[i]));
+		character->SetRot(rotations[i]);
+		character->SetLinearVelocity(velocitiesX[i], velocitiesY[i]);
+		character->SetAngularVelocity(angularVelocities[i]);
+	}
+}
+
+
+
+
+
+// Lua configuration
+
+void Crowd::RegisterLuaFuncs(MOAILuaState& state)
+{
+	MOAIEntity2D::RegisterLuaFuncs(state);
+
+	luaL_Reg regTable [] = {
+		{ "addCharacter",			_addCharacter},
+		{ "removeCharacter",		_removeCharacter},
+		{ "followPath",				_followPath},
+		{ "setArrivalRadius",		_setArrivalRadius},
+		{ "hasArrived",				_hasArrived},
+		{ "getAgentCount",			_getAgentCount},
+		{ NULL, NULL }
+	};
+
+	luaL_register(state, 0, regTable);
+}
+
+int Crowd::_addCharacter(lua_State* L)
+{
+	MOAI_LUA_SETUP(Crowd, "UU")
+
+	// Character and its highest speed, in units per second
+	Character* character = state.GetLuaObject<Character>(2, true);
+	if (character) {
+		self->AddCharacter(character, state.GetValue<float>(3, 100.0f));
+	}
+	return 0;
+}
+
+int Crowd::_removeCharacter(lua_State* L)
+{
+	MOAI_LUA_SETUP(Crowd, "UU")
+
+	Character* character = state.GetLuaObject<Character>(2, true);
+	if (character) {
+		self->RemoveCharacter(character);
+	}
+	return 0;
+}
+
+int Crowd::_followPath(lua_State* L)
+{
+	MOAI_LUA_SETUP(Crowd, "UUU")
+
+	// The character follows the current path of the pathfinder
+	Character* character = state.GetLuaObject<Character>(2, true);
+	Pathfinder* pathfinder = state.GetLuaObject<Pathfinder>(3, true);
+	if (character && pathfinder) {
+		self->FollowPath(character, *pathfinder);
+	}
+	return 0;
+}
+
+int Crowd::_setArrivalRadius(lua_State* L)
+{
+	MOAI_LUA_SETUP(Crowd, "UN")
+
+	self->GetAgents().SetArrivalRadius(state.GetValue<float>(2, 4.0f));
+	return 0;
+}
+
+int Crowd::_hasArrived(lua_State* L)
+{
+	MOAI_LUA_SETUP(Crowd, "UU")
+
+	// Returns whether the character stands on the end of its path, or has none
+	Character* character = state.GetLuaObject<Character>(2, true);
+	state.Push(character && self->HasArrived(character));
+	return 1;
+}
+
+int Crowd::_getAgentCount(lua_State* L)
+{
+	MOAI_LUA_SETUP(Crowd, "U")
+
+	state.Push(self->GetAgents().GetAgentCount());
+	return 1;
+}
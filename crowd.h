@@ -0,0 +1,52 @@
+#ifndef __CROWD_H__
+#define __CROWD_H__
+
+#include <moaicore/MOAIEntity2D.h>
+#include "pathfinding/AgentSystem.h"
+
+class Character;
+class Pathfinder;
+
+// Moves many characters along their paths with a single entity update per frame. The
+// characters are not updated themselves, the crowd advances all of its agents at once and
+// writes their positions, rotations and velocities back to the characters.
+class Crowd: public virtual MOAIEntity2D
+{
+public:
+	DECL_LUA_FACTORY(Crowd)
+
+	Crowd();
+	~Crowd();
+
+	// A character belongs to a single crowd, adding it again only changes its speed
+	void AddCharacter(Character* character, float maxSpeed);
+	void RemoveCharacter(Character* character);
+	// Follows the waypoints of the current path of the pathfinder
+	void FollowPath(Character* character, const Pathfinder& pathfinder);
+	// False for characters of other crowds
+	bool HasArrived(const Character* character) const;
+	const AgentSystem& GetAgents() const { return mAgents; }
+	AgentSystem& GetAgents() { return mAgents; }
+protected:
+	virtual void OnUpdate(float step);
+private:
+	bool IsInCrowd(const Character* character) const;
+
+	AgentSystem mAgents;
+	// Character of each agent handle
+	std::vector<Character*> mCharacters;
+	std::vector<float> mPoints;
+
+	// Lua configuration
+public:
+	virtual void RegisterLuaFuncs(MOAILuaState& state);
+private:
+	static int _addCharacter(lua_State* L);
+	static int _removeCharacter(lua_State* L);
+	static int _followPath(lua_State* L);
+	static int _setArrivalRadius(lua_State* L);
+	static int _hasArrived(lua_State* L);
+	static int _getAgentCount(lua_State* L);
+};
+
+#endif
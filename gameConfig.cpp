@@ -2,10 +2,12 @@
 #include "gameConfig.h"
 
 #include "character.h"
+#include "crowd.h"
 #include "pathfinding/pathfinder.h"
 
 void Configure(MOAIGlobals* globals)
 {
 	REGISTER_LUA_CLASS(Character)
+	REGISTER_LUA_CLASS(Crowd)
 	REGISTER_LUA_CLASS(Pathfinder)
 }
\ No newline at end of file
@@ -0,0 +1,153 @@
+#include <stdafx.h>
+
+#include "AStarSearch.h"
+#include <algorithm>
+#include <cstdlib>
+
+const unsigned int AStarSearch::UNLIMITED = 0xFFFFFFFF;
+
+AStarSearch::AStarSearch(const CostGrid& grid, SearchContext& context) :
+	mGrid(grid),
+	mContext(context),
+	mEndIndex(-1),
+	mStatus(SEARCH_IDLE),
+	mConnectivity(GridTopology::CONNECTIVITY_4),
+	mCornerCutting(GridTopology::CUT_CORNERS_NEVER),
+	mHeuristicScale(1)
+{
+}
+
+void AStarSearch::Begin(const GridNode& start, const GridNode& end) {
+	mEndNode = end;
+	mStats.Clear();
+	mHeuristicScale = mGrid.GetMinCost();
+
+	if (!mGrid.IsWalkable(start) || !mGrid.IsWalkable(end) || start.Compare(end)) {
+		mStatus = SEARCH_FAILED;
+		return;
+	}
+
+	mContext.Prepare(mGrid.GetCellCount());
+	mContext.Reset();
+
+	int startIndex = mGrid.GetIndex(start);
+	mEndIndex = mGrid.GetIndex(end);
+
+	PathNode& startNode = mContext.Visit(startIndex);
+	startNode.h = CalculateDistance(start);
+	mContext.PushOpen(startIndex, OpenList::MakeKey(startNode.g + startNode.h, startNode.h));
+	mStats.heuristicEvaluations = 1;
+	mStats.generated = 1;
+	mStats.openListPeak = 1;
+	mStatus = SEARCH_RUNNING;
+}
+
+AStarSearch::Status AStarSearch::Step(unsigned int maxExpansions) {
+	int successors[MAX_SUCCESSORS];
+	int costs[MAX_SUCCESSORS];
+	for (unsigned int expansions = 0; mStatus == SEARCH_RUNNING && expansions < maxExpansions; ++expansions) {
+		if (mContext.IsOpenListEmpty()) {
+			mStatus = SEARCH_FAILED;
+			break;
+		}
+
+		int index = mContext.PopOpen();
+		const PathNode& pathNode = mContext.GetNode(index);
+		++mStats.expanded;
+
+		if (index == mEndIndex) {
+			// Node is the end node
+			mStatus = SEARCH_FOUND;
+			break;
+		}
+
+		// Node is not the end node
+		int numSuccessors = GetSuccessors(index, successors, costs);
+		for (int i = 0; i < numSuccessors; ++i) {
+			int nextIndex = successors[i];
+			int cost = pathNode.g + costs[i];
+
+			bool visited = mContext.IsVisited(nextIndex);
+			PathNode& nextPathNode = mContext.Visit(nextIndex);
+			if (visited) {
+				if (cost >= nextPathNode.g) {
+					continue;
+				}
+			} else {
+				nextPathNode.h = CalculateDistance(mGrid.GetNode(nextIndex));
+				++mStats.heuristicEvaluations;
+			}
+
+			nextPathNode.g = cost;
+			nextPathNode.parent = index;
+			OpenList::Key key = OpenList::MakeKey(nextPathNode.g + nextPathNode.h, nextPathNode.h);
+			if (mContext.IsOpen(nextIndex)) {
+				// Cheaper path to a node already on the open list
+				mContext.UpdateOpen(nextIndex, key);
+			} else {
+				// New node, or a closed node reached with a smaller cost that has to be reopened
+				mStats.reopened += visited;
+				mContext.PushOpen(nextIndex, key);
+				++mStats.generated;
+			}
+		}
+		mStats.openListPeak = std::max(mStats.openListPeak, static_cast<unsigned int>(mContext.GetOpenListSize()));
+	}
+	return mStatus;
+}
+
+void AStarSearch::BuildPath(std::vector<GridNode>& path) const {
+	// Counting the cells first lets the path be written in place, from the end
+	size_t length = 1;
+	for (int index = mEndIndex; mContext.GetNode(index).parent >= 0; index = mContext.GetNode(index).parent) {
+		GridNode node = mGrid.GetNode(index);
+		GridNode parentNode = mGrid.GetNode(mContext.GetNode(index).parent);
+		length += std::max(std::abs(node.x - parentNode.x), std::abs(node.y - parentNode.y));
+	}
+
+	mContext.ResizeBuffer(path, length);
+	for (int index = mEndIndex; index >= 0; index = mContext.GetNode(index).parent) {
+		GridNode node = mGrid.GetNode(index);
+		path[--length] = node;
+		if (mContext.GetNode(index).parent >= 0) {
+			// Cells between the node and its parent
+			GridNode parentNode = mGrid.GetNode(mContext.GetNode(index).parent);
+			int stepX = (parentNode.x > node.x) - (parentNode.x < node.x);
+			int stepY = (parentNode.y > node.y) - (parentNode.y < node.y);
+			for (node = GridNode(node.x + stepX, node.y + stepY); !node.Compare(parentNode); node = GridNode(node.x + stepX, node.y + stepY)) {
+				path[--length] = node;
+			}
+		}
+	}
+}
+
+int AStarSearch::GetSuccessors(int index, int* successors, int* costs) const {
+	int numSuccessors = GetNodeConnections(index, successors, costs);
+	for (int i = 0; i < numSuccessors; ++i) {
+		costs[i] *= mGrid.GetCost(successors[i]);
+	}
+	return numSuccessors;
+}
+
+int AStarSearch::GetNodeConnections(int index, int* connections, int* weights) const {
+	// Nodes in the search are always inside the grid, so thanks to the blocked border
+	// the neighbours can be read without checking the grid limits
+	int stride = mGrid.GetStride();
+	int numConnections = 0;
+	for (int i = 0; i < GridTopology::GetDirectionCount(mConnectivity); ++i) {
+		int nextIndex = index + GridTopology::GetOffset(i, stride);
+		if (!mGrid.IsWalkable(nextIndex)) {
+			continue;
+		}
+		if (GridTopology::IsDiagonal(i)) {
+			bool firstWalkable = mGrid.IsWalkable(index + GridTopology::GetOffset(GridTopology::GetFirstSide(i), stride));
+			bool secondWalkable = mGrid.IsWalkable(index + GridTopology::GetOffset(GridTopology::GetSecondSide(i), stride));
+			if (!GridTopology::CanCutCorner(mCornerCutting, firstWalkable, secondWalkable)) {
+				continue;
+			}
+		}
+		connections[numConnections] = nextIndex;
+		weights[numConnections++] = GridTopology::GetWeight(mConnectivity, i);
+	}
+	return numConnections;
+}
@@ -0,0 +1,82 @@
+#ifndef __ASTARSEARCH_H__
+#define __ASTARSEARCH_H__
+
+#include <vector>
+#include "GridNode.h"
+#include "CostGrid.h"
+#include "GridTopology.h"
+#include "SearchContext.h"
+#include "SearchStats.h"
+
+// Resumable A* search over a CostGrid. A query is started with Begin() and advanced
+// with Step(), which expands at most the given number of nodes before returning, so
+// the cost of a search can be spread over several frames.
+//
+// Moves are 4-connected by default. On an 8-connected grid every move costs the entered
+// cell times the fixed point weight of GridTopology, and diagonal moves beside blocked
+// cells follow the corner cutting rule. The heuristic is the Manhattan or octile distance
+// scaled by the lowest cost of the grid, so it never overestimates.
+class AStarSearch {
+public:
+	enum Status {
+		SEARCH_IDLE,
+		SEARCH_RUNNING,
+		SEARCH_FOUND,
+		SEARCH_FAILED
+	};
+
+	static const unsigned int UNLIMITED;
+
+	AStarSearch(const CostGrid& grid, SearchContext& context);
+	virtual ~AStarSearch() {}
+
+	virtual void Begin(const GridNode& start, const GridNode& end);
+	virtual Status Step(unsigned int maxExpansions);
+	Status Run() { return Step(UNLIMITED); }
+	void Cancel() { mStatus = SEARCH_IDLE; }
+
+	// Takes effect on the next Begin()
+	void SetMovement(GridTopology::Connectivity connectivity, GridTopology::CornerCutting cornerCutting) { mConnectivity = connectivity; mCornerCutting = cornerCutting; }
+	GridTopology::Connectivity GetConnectivity() const { return mConnectivity; }
+	GridTopology::CornerCutting GetCornerCutting() const { return mCornerCutting; }
+
+	Status GetStatus() const { return mStatus; }
+	bool IsRunning() const { return mStatus == SEARCH_RUNNING; }
+	unsigned int GetExpandedCount() const { return mStats.expanded; }
+	// Counters of the current query, the time and allocated bytes are left to the caller
+	const SearchStats& GetStats() const { return mStats; }
+	virtual size_t GetOpenListSize() const { return mContext.GetOpenListSize(); }
+
+	// Writes the cells from start to end of the path found, the search must have finished with SEARCH_FOUND.
+	// Consecutive nodes of the search that are not adjacent are joined with a straight line of cells.
+	virtual void BuildPath(std::vector<GridNode>& path) const;
+
+protected:
+	static const int MAX_SUCCESSORS = 8;
+
+	// Fills the nodes reachable from an expanded node and the cost to reach each of them
+	virtual int GetSuccessors(int index, int* successors, int* costs) const;
+	// Fills the walkable neighbours of a node and the weight of the move to each of them
+	int GetNodeConnections(int index, int* connections, int* weights) const;
+	int CalculateDistance(const GridNode& node) const { return CalculateDistance(node, mEndNode); }
+	int CalculateDistance(const GridNode& node, const GridNode& target) const {
+		return GridTopology::GetDistance(mConnectivity, target.x - node.x, target.y - node.y) * mHeuristicScale;
+	}
+
+	const CostGrid& mGrid;
+	SearchContext& mContext;
+
+	int mEndIndex;
+	Status mStatus;
+	SearchStats mStats;
+	GridTopology::Connectivity mConnectivity;
+	GridTopology::CornerCutting mCornerCutting;
+	// Lowest cost of the grid when the query began
+	int mHeuristicScale;
+
+private:
+
+	GridNode mEndNode;
+};
+
+#endif
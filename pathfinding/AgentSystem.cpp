@@ -0,0 +1,208 @@
+#include <stdafx.h>
+
+#include "AgentSystem.h"
+#include <algorithm>
+#include <cmath>
+
+const int AgentSystem::NO_AGENT = -1;
+
+namespace {
+
+const float DEFAULT_ARRIVAL_RADIUS = 4.0f;
+// Squared distance to the last point of a path below which the agent stands on it
+const float ARRIVED_DISTANCE_SQUARED = 1e-4f;
+const float DEGREES_PER_RADIAN = 57.2957795f;
+
+// Steers every agent straight to its target and moves it, the same operations for every
+// agent without branches. The arrays never overlap, which lets the loop be vectorized.
+void MoveAgents(int count, float step, const float* __restrict targetsX, const float* __restrict targetsY, const float* __restrict maxSpeeds,
+	float* __restrict positionsX, float* __restrict positionsY, float* __restrict velocitiesX, float* __restrict velocitiesY) {
+	float inverseStep = 1.0f / step;
+	for (int i = 0; i < count; ++i) {
+		float dx = targetsX[i] - positionsX[i];
+		float dy = targetsY[i] - positionsY[i];
+		float distance = std::sqrt(dx * dx + dy * dy);
+		float speed = std::min(maxSpeeds[i], distance * inverseStep);
+		float scale = speed / std::max(distance, 1e-6f);
+		velocitiesX[i] = dx * scale;
+		velocitiesY[i] = dy * scale;
+		positionsX[i] += velocitiesX[i] * step;
+		positionsY[i] += velocitiesY[i] * step;
+	}
+}
+
+}
+
+AgentSystem::AgentSystem() :
+	mUnusedPoints(0),
+	mArrivalRadius(DEFAULT_ARRIVAL_RADIUS)
+{
+}
+
+int AgentSystem::AddAgent(float x, float y, float maxSpeed) {
+	int agent;
+	if (mFreeHandles.empty()) {
+		agent = static_cast<int>(mIndices.size());
+		mIndices.push_back(-1);
+	} else {
+		agent = mFreeHandles.back();
+		mFreeHandles.pop_back();
+	}
+	mIndices[agent] = static_cast<int>(mHandles.size());
+	mHandles.push_back(agent);
+
+	mPositionsX.push_back(x);
+	mPositionsY.push_back(y);
+	mVelocitiesX.push_back(0.0f);
+	mVelocitiesY.push_back(0.0f);
+	mRotations.push_back(0.0f);
+	mAngularVelocities.push_back(0.0f);
+	mMaxSpeeds.push_back(maxSpeed);
+	mTargetsX.push_back(x);
+	mTargetsY.push_back(y);
+	mTurning.push_back(true);
+	int poolSize = static_cast<int>(mPathPoints.size());
+	mPathBegins.push_back(poolSize);
+	mPathEnds.push_back(poolSize);
+	mWaypoints.push_back(poolSize);
+	return agent;
+}
+
+void AgentSystem::RemoveAgent(int agent) {
+	int index = mIndices[agent];
+	int last = static_cast<int>(mHandles.size()) - 1;
+	mUnusedPoints += mPathEnds[index] - mPathBegins[index];
+
+	// The last agent takes the place of the removed one in every array
+	mPositionsX[index] = mPositionsX[last];
+	mPositionsY[index] = mPositionsY[last];
+	mVelocitiesX[index] = mVelocitiesX[last];
+	mVelocitiesY[index] = mVelocitiesY[last];
+	mRotations[index] = mRotations[last];
+	mAngularVelocities[index] = mAngularVelocities[last];
+	mMaxSpeeds[index] = mMaxSpeeds[last];
+	mTargetsX[index] = mTargetsX[last];
+	mTargetsY[index] = mTargetsY[last];
+	mTurning[index] = mTurning[last];
+	mPathBegins[index] = mPathBegins[last];
+	mPathEnds[index] = mPathEnds[last];
+	mWaypoints[index] = mWaypoints[last];
+	mHandles[index] = mHandles[last];
+	mIndices[mHandles[index]] = index;
+
+	mPositionsX.pop_back();
+	mPositionsY.pop_back();
+	mVelocitiesX.pop_back();
+	mVelocitiesY.pop_back();
+	mRotations.pop_back();
+	mAngularVelocities.pop_back();
+	mMaxSpeeds.pop_back();
+	mTargetsX.pop_back();
+	mTargetsY.pop_back();
+	mTurning.pop_back();
+	mPathBegins.pop_back();
+	mPathEnds.pop_back();
+	mWaypoints.pop_back();
+	mHandles.pop_back();
+
+	mIndices[agent] = -1;
+	mFreeHandles.push_back(agent);
+	if (mUnusedPoints * 2 > mPathPoints.size()) {
+		CompactPaths();
+	}
+}
+
+void AgentSystem::Clear() {
+	mPositionsX.clear();
+	mPositionsY.clear();
+	mVelocitiesX.clear();
+	mVelocitiesY.clear();
+	mRotations.clear();
+	mAngularVelocities.clear();
+	mMaxSpeeds.clear();
+	mTargetsX.clear();
+	mTargetsY.clear();
+	mTurning.clear();
+	mPathBegins.clear();
+	mPathEnds.clear();
+	mWaypoints.clear();
+	mHandles.clear();
+	mIndices.clear();
+	mFreeHandles.clear();
+	mPathPoints.clear();
+	mUnusedPoints = 0;
+}
+
+void AgentSystem::SetPath(int agent, const float* points, int pointCount) {
+	int index = mIndices[agent];
+	mUnusedPoints += mPathEnds[index] - mPathBegins[index];
+	mPathBegins[index] = static_cast<int>(mPathPoints.size());
+	mPathPoints.insert(mPathPoints.end(), points, points + pointCount * 2);
+	mPathEnds[index] = static_cast<int>(mPathPoints.size());
+	mWaypoints[index] = mPathBegins[index];
+	mTurning[index] = true;
+	if (mUnusedPoints * 2 > mPathPoints.size()) {
+		CompactPaths();
+	}
+}
+
+void AgentSystem::CompactPaths() {
+	std::vector<float> points;
+	points.reserve(mPathPoints.size() - mUnusedPoints);
+	for (size_t i = 0; i < mHandles.size(); ++i) {
+		int begin = static_cast<int>(points.size());
+		points.insert(points.end(), mPathPoints.begin() + mPathBegins[i], mPathPoints.begin() + mPathEnds[i]);
+		mWaypoints[i] += begin - mPathBegins[i];
+		mPathEnds[i] += begin - mPathBegins[i];
+		mPathBegins[i] = begin;
+	}
+	mPathPoints.swap(points);
+	mUnusedPoints = 0;
+}
+
+void AgentSystem::Update(float step) {
+	int count = GetAgentCount();
+	if (count == 0 || step <= 0.0f) {
+		return;
+	}
+
+	// Waypoints passed since the last update, an agent without a path heads to where it stands
+	float arrivalRadiusSquared = mArrivalRadius * mArrivalRadius;
+	const float* points = mPathPoints.data();
+	for (int i = 0; i < count; ++i) {
+		int waypoint = mWaypoints[i];
+		int end = mPathEnds[i];
+		while (waypoint < end) {
+			float dx = points[waypoint] - mPositionsX[i];
+			float dy = points[waypoint + 1] - mPositionsY[i];
+			float distanceSquared = dx * dx + dy * dy;
+			if (distanceSquared > (waypoint + 2 < end ? arrivalRadiusSquared : ARRIVED_DISTANCE_SQUARED)) {
+				break;
+			}
+			waypoint += 2;
+		}
+		if (waypoint != mWaypoints[i]) {
+			mTurning[i] = true;
+			mWaypoints[i] = waypoint;
+		}
+		mTargetsX[i] = waypoint < end ? points[waypoint] : mPositionsX[i];
+		mTargetsY[i] = waypoint < end ? points[waypoint + 1] : mPositionsY[i];
+	}
+
+	MoveAgents(count, step, mTargetsX.data(), mTargetsY.data(), mMaxSpeeds.data(), mPositionsX.data(), mPositionsY.data(), mVelocitiesX.data(), mVelocitiesY.data());
+
+	// Agents face where they move, and keep their rotation while standing. Heading straight
+	// to the same waypoint keeps the direction, only agents with a new one turn.
+	float inverseStep = 1.0f / step;
+	for (int i = 0; i < count; ++i) {
+		mAngularVelocities[i] = 0.0f;
+		if (!mTurning[i] || (mVelocitiesX[i] == 0.0f && mVelocitiesY[i] == 0.0f)) {
+			continue;
+		}
+		float rotation = std::atan2(mVelocitiesY[i], mVelocitiesX[i]) * DEGREES_PER_RADIAN;
+		float turn = std::fmod(rotation - mRotations[i] + 540.0f, 360.0f) - 180.0f;
+		mAngularVelocities[i] = turn * inverseStep;
+		mRotations[i] = rotation;
+		mTurning[i] = false;
+	}
+}
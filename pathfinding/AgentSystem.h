@@ -0,0 +1,90 @@
+#ifndef __AGENTSYSTEM_H__
+#define __AGENTSYSTEM_H__
+
+#include <vector>
+
+// Moves many agents along their paths in one pass per frame. The agents are stored as
+// structure of arrays, index i of every array belongs to the same agent, and removing an
+// agent moves the last one into its place. Handles stay valid until their agent is removed.
+//
+// An update first finds the waypoint each agent heads to, the only step reading the paths,
+// and then steers and moves every agent with the same arithmetic over plain arrays. Agents
+// go straight to their waypoint at their highest speed, and slow down to stop exactly on it.
+// A waypoint within the arrival radius is passed, except the last one of the path.
+//
+// The points of every path are stored one after another in a single pool, as x and y pairs.
+// Replaced paths leave holes, which are compacted when they are half of the pool.
+class AgentSystem {
+public:
+	static const int NO_AGENT;
+
+	AgentSystem();
+
+	// Returns the handle of the new agent, standing still without a path
+	int AddAgent(float x, float y, float maxSpeed);
+	void RemoveAgent(int agent);
+	void Clear();
+	bool IsAgent(int agent) const { return agent >= 0 && agent < static_cast<int>(mIndices.size()) && mIndices[agent] >= 0; }
+
+	// Copies the points of a path, given as x and y pairs. The agent heads to the first one.
+	void SetPath(int agent, const float* points, int pointCount);
+	void ClearPath(int agent) { SetPath(agent, nullptr, 0); }
+	void SetMaxSpeed(int agent, float maxSpeed) { mMaxSpeeds[mIndices[agent]] = maxSpeed; }
+	void SetArrivalRadius(float arrivalRadius) { mArrivalRadius = arrivalRadius; }
+	float GetArrivalRadius() const { return mArrivalRadius; }
+
+	// Advances every agent by a step in seconds
+	void Update(float step);
+
+	// True when the agent stands on the last point of its path, or has no path
+	bool HasArrived(int agent) const { int index = mIndices[agent]; return mWaypoints[index] >= mPathEnds[index]; }
+	// Waypoint the agent heads to, counted from the first point of its path
+	int GetWaypoint(int agent) const { int index = mIndices[agent]; return (mWaypoints[index] - mPathBegins[index]) / 2; }
+
+	// Agents in the order of the arrays, and the handle of each
+	int GetAgentCount() const { return static_cast<int>(mHandles.size()); }
+	int GetHandle(int index) const { return mHandles[index]; }
+	int GetIndex(int agent) const { return mIndices[agent]; }
+	const float* GetPositionsX() const { return mPositionsX.data(); }
+	const float* GetPositionsY() const { return mPositionsY.data(); }
+	const float* GetVelocitiesX() const { return mVelocitiesX.data(); }
+	const float* GetVelocitiesY() const { return mVelocitiesY.data(); }
+	// Rotations in degrees and angular velocities in degrees per second, facing where the agent moves
+	const float* GetRotations() const { return mRotations.data(); }
+	const float* GetAngularVelocities() const { return mAngularVelocities.data(); }
+
+	// Floats of the path pool, holes included
+	size_t GetPathPoolSize() const { return mPathPoints.size(); }
+
+private:
+	void CompactPaths();
+
+	std::vector<float> mPositionsX;
+	std::vector<float> mPositionsY;
+	std::vector<float> mVelocitiesX;
+	std::vector<float> mVelocitiesY;
+	std::vector<float> mRotations;
+	std::vector<float> mAngularVelocities;
+	std::vector<float> mMaxSpeeds;
+	// Point each agent heads to, gathered from the paths before steering
+	std::vector<float> mTargetsX;
+	std::vector<float> mTargetsY;
+	// Agents heading to a new waypoint, whose rotation is computed again
+	std::vector<bool> mTurning;
+	// Offsets in mPathPoints of the path of each agent and of its current waypoint
+	std::vector<int> mPathBegins;
+	std::vector<int> mPathEnds;
+	std::vector<int> mWaypoints;
+
+	// Handle of each agent, and index of the agent of each handle or -1 for free handles
+	std::vector<int> mHandles;
+	std::vector<int> mIndices;
+	std::vector<int> mFreeHandles;
+
+	std::vector<float> mPathPoints;
+	// Floats of mPathPoints no longer used by a path
+	size_t mUnusedPoints;
+	float mArrivalRadius;
+};
+
+#endif
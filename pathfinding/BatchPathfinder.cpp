@@ -0,0 +1,83 @@
+#include <stdafx.h>
+
+#include "BatchPathfinder.h"
+#include <algorithm>
+
+// Small chunks balance better between threads as the cost of a query varies a lot
+const size_t BatchPathfinder::QUERIES_PER_CHUNK = 8;
+
+BatchPathfinder::BatchPathfinder(const CostGrid& grid, unsigned int threadCount) :
+	mGrid(grid),
+	mConnectivity(GridTopology::CONNECTIVITY_4),
+	mCornerCutting(GridTopology::CUT_CORNERS_NEVER),
+	mThreadPool(threadCount)
+{
+	for (unsigned int i = 0; i < mThreadPool.GetThreadCount(); ++i) {
+		mWorkers.push_back(new Worker(grid));
+	}
+}
+
+BatchPathfinder::~BatchPathfinder() {
+	for (Worker* worker : mWorkers) {
+		delete worker;
+	}
+}
+
+void BatchPathfinder::SetMovement(GridTopology::Connectivity connectivity, GridTopology::CornerCutting cornerCutting) {
+	mConnectivity = connectivity;
+	mCornerCutting = cornerCutting;
+	for (Worker* worker : mWorkers) {
+		worker->jps.SetMovement(connectivity, cornerCutting);
+	}
+}
+
+void BatchPathfinder::FindPaths(const PathQuery* queries, size_t count, PathBatch& batch, Algorithm algorithm) {
+	for (Worker* worker : mWorkers) {
+		worker->nodes.clear();
+		worker->expandedCount = 0;
+	}
+	mLocations.resize(count);
+
+	// Every worker appends its paths to its own buffer
+	mThreadPool.ParallelFor(count, QUERIES_PER_CHUNK, [&](size_t begin, size_t end, unsigned int workerIndex) {
+		Worker& worker = *mWorkers[workerIndex];
+		AStarSearch& search = ALGORITHM_JPS == algorithm ? static_cast<AStarSearch&>(worker.jps) : worker.astar.Get(mConnectivity, mCornerCutting);
+		for (size_t i = begin; i < end; ++i) {
+			PathLocation& location = mLocations[i];
+			location.worker = workerIndex;
+			location.offset = worker.nodes.size();
+			location.length = 0;
+
+			search.Begin(queries[i].start, queries[i].end);
+			if (AStarSearch::SEARCH_FOUND == search.Run()) {
+				search.BuildPath(worker.path);
+				worker.nodes.insert(worker.nodes.end(), worker.path.begin(), worker.path.end());
+				location.length = worker.path.size();
+			}
+			worker.expandedCount += search.GetExpandedCount();
+		}
+	});
+
+	// Gathers the paths in query order
+	batch.offsets.resize(count + 1);
+	batch.offsets[0] = 0;
+	for (size_t i = 0; i < count; ++i) {
+		batch.offsets[i + 1] = batch.offsets[i] + mLocations[i].length;
+	}
+	batch.nodes.resize(batch.offsets[count]);
+	mThreadPool.ParallelFor(count, QUERIES_PER_CHUNK * 8, [&](size_t begin, size_t end, unsigned int) {
+		for (size_t i = begin; i < end; ++i) {
+			const PathLocation& location = mLocations[i];
+			const std::vector<GridNode>& nodes = mWorkers[location.worker]->nodes;
+			std::copy(nodes.begin() + location.offset, nodes.begin() + location.offset + location.length, batch.nodes.begin() + batch.offsets[i]);
+		}
+	});
+}
+
+unsigned long long BatchPathfinder::GetExpandedCount() const {
+	unsigned long long expandedCount = 0;
+	for (const Worker* worker : mWorkers) {
+		expandedCount += worker->expandedCount;
+	}
+	return expandedCount;
+}
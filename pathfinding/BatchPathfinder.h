@@ -0,0 +1,82 @@
+#ifndef __BATCHPATHFINDER_H__
+#define __BATCHPATHFINDER_H__
+
+#include <vector>
+#include "GridNode.h"
+#include "CostGrid.h"
+#include "SearchContext.h"
+#include "AStarSearch.h"
+#include "SpecializedAStar.h"
+#include "JumpPointSearch.h"
+#include "ThreadPool.h"
+
+struct PathQuery {
+	GridNode start;
+	GridNode end;
+};
+
+// Paths of a batch stored back to back in one buffer. Path i is made of the nodes in
+// [offsets[i], offsets[i + 1]), an empty range means there is no path.
+struct PathBatch {
+	std::vector<GridNode> nodes;
+	std::vector<size_t> offsets;
+
+	size_t GetPathCount() const { return offsets.empty() ? 0 : offsets.size() - 1; }
+	size_t GetPathLength(size_t path) const { return offsets[path + 1] - offsets[path]; }
+	const GridNode* GetPath(size_t path) const { return nodes.data() + offsets[path]; }
+};
+
+// Solves many queries in parallel against a grid that is not modified meanwhile. Every
+// worker of the thread pool owns its own search context, so queries share nothing but
+// the read-only grid.
+class BatchPathfinder {
+public:
+	enum Algorithm {
+		ALGORITHM_ASTAR,
+		ALGORITHM_JPS
+	};
+
+	// A thread count of 0 uses one thread per hardware thread
+	BatchPathfinder(const CostGrid& grid, unsigned int threadCount = 0);
+	~BatchPathfinder();
+
+	void FindPaths(const PathQuery* queries, size_t count, PathBatch& batch, Algorithm algorithm = ALGORITHM_ASTAR);
+	// Moves of the searches of every worker, see AStarSearch::SetMovement()
+	void SetMovement(GridTopology::Connectivity connectivity, GridTopology::CornerCutting cornerCutting);
+
+	unsigned int GetThreadCount() const { return mThreadPool.GetThreadCount(); }
+	// Workers of the batches, free for other parallel work between them
+	ThreadPool& GetThreadPool() { return mThreadPool; }
+	unsigned long long GetExpandedCount() const;
+
+private:
+	static const size_t QUERIES_PER_CHUNK;
+
+	// Scratch memory of one worker
+	struct Worker {
+		Worker(const CostGrid& grid) : astar(grid, context), jps(grid, context), expandedCount(0) {}
+
+		SearchContext context;
+		AStarVariants astar;
+		JumpPointSearch jps;
+		std::vector<GridNode> nodes;
+		std::vector<GridNode> path;
+		unsigned long long expandedCount;
+	};
+
+	// Where each path was written before being gathered in the batch
+	struct PathLocation {
+		unsigned int worker;
+		size_t offset;
+		size_t length;
+	};
+
+	const CostGrid& mGrid;
+	GridTopology::Connectivity mConnectivity;
+	GridTopology::CornerCutting mCornerCutting;
+	ThreadPool mThreadPool;
+	std::vector<Worker*> mWorkers;
+	std::vector<PathLocation> mLocations;
+};
+
+#endif
@@ -0,0 +1,133 @@
+#include <stdafx.h>
+
+#include "BidirectionalSearch.h"
+#include <algorithm>
+
+const int BidirectionalSearch::INFINITE_COST = 0x7FFFFFFF;
+
+BidirectionalSearch::BidirectionalSearch(const CostGrid& grid, SearchContext& context, SearchContext& reverseContext) :
+	AStarSearch(grid, context),
+	mReverseContext(reverseContext),
+	mBestCost(INFINITE_COST),
+	mMeetIndex(-1)
+{
+}
+
+void BidirectionalSearch::Begin(const GridNode& start, const GridNode& end) {
+	AStarSearch::Begin(start, end);
+	mStartNode = start;
+	mBestCost = INFINITE_COST;
+	mMeetIndex = -1;
+	if (!IsRunning()) {
+		return;
+	}
+
+	mReverseContext.Prepare(mGrid.GetCellCount());
+	mReverseContext.Reset();
+	PathNode& endNode = mReverseContext.Visit(mEndIndex);
+	endNode.h = CalculateDistance(end, start);
+	mReverseContext.PushOpen(mEndIndex, OpenList::MakeKey(endNode.g + endNode.h, endNode.h));
+	++mStats.heuristicEvaluations;
+	++mStats.generated;
+	mStats.openListPeak = 2;
+}
+
+AStarSearch::Status BidirectionalSearch::Step(unsigned int maxExpansions) {
+	GridNode end = mGrid.GetNode(mEndIndex);
+	for (unsigned int expansions = 0; mStatus == SEARCH_RUNNING && expansions < maxExpansions; ++expansions) {
+		// No path through the nodes left on an open list can be cheaper than the best one
+		if (mContext.IsOpenListEmpty() || mReverseContext.IsOpenListEmpty() ||
+			static_cast<int>(GetLowestF(mContext)) >= mBestCost || static_cast<int>(GetLowestF(mReverseContext)) >= mBestCost) {
+			mStatus = mMeetIndex >= 0 ? SEARCH_FOUND : SEARCH_FAILED;
+			break;
+		}
+
+		if (mContext.GetOpenListSize() <= mReverseContext.GetOpenListSize()) {
+			Expand(true, mStartNode, end);
+		} else {
+			Expand(false, end, mStartNode);
+		}
+		mStats.openListPeak = std::max(mStats.openListPeak, static_cast<unsigned int>(GetOpenListSize()));
+	}
+	return mStatus;
+}
+
+void BidirectionalSearch::Expand(bool forward, const GridNode& origin, const GridNode& target) {
+	SearchContext& context = forward ? mContext : mReverseContext;
+	SearchContext& otherContext = forward ? mReverseContext : mContext;
+	unsigned int otherLowestF = GetLowestF(otherContext);
+
+	int index = context.PopOpen();
+	if (otherContext.IsClosed(index)) {
+		// Already done by the other direction
+		return;
+	}
+	const PathNode& pathNode = context.GetNode(index);
+	// The other direction has to reach the node from its own open list, which costs at
+	// least its lowest f minus the distance from the node to where it started
+	int otherBound = static_cast<int>(otherLowestF) - CalculateDistance(mGrid.GetNode(index), origin);
+	if (pathNode.g + pathNode.h >= mBestCost || pathNode.g + otherBound >= mBestCost) {
+		return;
+	}
+	++mStats.expanded;
+
+	int successors[MAX_SUCCESSORS];
+	int weights[MAX_SUCCESSORS];
+	int numSuccessors = GetNodeConnections(index, successors, weights);
+	for (int i = 0; i < numSuccessors; ++i) {
+		int nextIndex = successors[i];
+		if (context.IsClosed(nextIndex) || otherContext.IsClosed(nextIndex)) {
+			continue;
+		}
+
+		// Moving into a cell costs that cell, so backwards the move costs the expanded cell
+		int cost = pathNode.g + mGrid.GetCost(forward ? nextIndex : index) * weights[i];
+		bool visited = context.IsVisited(nextIndex);
+		PathNode& nextPathNode = context.Visit(nextIndex);
+		if (visited) {
+			if (cost >= nextPathNode.g) {
+				continue;
+			}
+		} else {
+			nextPathNode.h = CalculateDistance(mGrid.GetNode(nextIndex), target);
+			++mStats.heuristicEvaluations;
+		}
+
+		nextPathNode.g = cost;
+		nextPathNode.parent = index;
+		OpenList::Key key = OpenList::MakeKey(nextPathNode.g + nextPathNode.h, nextPathNode.h);
+		if (context.IsOpen(nextIndex)) {
+			context.UpdateOpen(nextIndex, key);
+		} else {
+			context.PushOpen(nextIndex, key);
+			++mStats.generated;
+		}
+
+		if (otherContext.IsVisited(nextIndex) && cost + otherContext.GetNode(nextIndex).g < mBestCost) {
+			mBestCost = cost + otherContext.GetNode(nextIndex).g;
+			mMeetIndex = nextIndex;
+		}
+	}
+}
+
+void BidirectionalSearch::BuildPath(std::vector<GridNode>& path) const {
+	// Forward parents lead from the meeting node back to the start, backward parents on to the end
+	size_t forwardLength = 0;
+	for (int index = mMeetIndex; index >= 0; index = mContext.GetNode(index).parent) {
+		++forwardLength;
+	}
+	size_t length = forwardLength;
+	for (int index = mReverseContext.GetNode(mMeetIndex).parent; index >= 0; index = mReverseContext.GetNode(index).parent) {
+		++length;
+	}
+
+	mContext.ResizeBuffer(path, length);
+	size_t position = forwardLength;
+	for (int index = mMeetIndex; index >= 0; index = mContext.GetNode(index).parent) {
+		path[--position] = mGrid.GetNode(index);
+	}
+	position = forwardLength;
+	for (int index = mReverseContext.GetNode(mMeetIndex).parent; index >= 0; index = mReverseContext.GetNode(index).parent) {
+		path[position++] = mGrid.GetNode(index);
+	}
+}
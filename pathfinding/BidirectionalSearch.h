@@ -0,0 +1,46 @@
+#ifndef __BIDIRECTIONALSEARCH_H__
+#define __BIDIRECTIONALSEARCH_H__
+
+#include "AStarSearch.h"
+
+// Bidirectional A* with the termination and pruning rules of NBA* (Pijls and Post). A
+// forward search from the start and a backward search from the end run at the same time,
+// expanding the side with the smaller open list, and every path where they meet is a
+// candidate. A node is skipped when no path through it can beat the best candidate, and
+// once a node is done in one direction the other direction never expands it. The search
+// ends when either open list is empty, with a path as cheap as the one of A*.
+//
+// It pays off on open terrain whose costs make the heuristic weak, where the two halves
+// meet before either covers the area A* would. On maps with obstacles both halves fill
+// the pockets around their origins and it expands more cells than A*, which is faster
+// there. Expanding the side with the lower f or alternating sides expands more still.
+//
+// The forward search uses the context of AStarSearch and the backward search a second
+// context, where the parent of a node is the next node towards the end.
+class BidirectionalSearch : public AStarSearch {
+public:
+	BidirectionalSearch(const CostGrid& grid, SearchContext& context, SearchContext& reverseContext);
+
+	virtual void Begin(const GridNode& start, const GridNode& end);
+	virtual Status Step(unsigned int maxExpansions);
+	virtual size_t GetOpenListSize() const { return mContext.GetOpenListSize() + mReverseContext.GetOpenListSize(); }
+	virtual void BuildPath(std::vector<GridNode>& path) const;
+
+	// Cost of the best path found so far
+	int GetBestCost() const { return mBestCost; }
+
+private:
+	static const int INFINITE_COST;
+
+	// Expands the best node of one direction, origin is the node that direction started from
+	void Expand(bool forward, const GridNode& origin, const GridNode& target);
+	static unsigned int GetLowestF(const SearchContext& context) { return static_cast<unsigned int>(context.GetTopKey() >> 32); }
+
+	SearchContext& mReverseContext;
+	GridNode mStartNode;
+	int mBestCost;
+	// Node where the forward and backward halves of the best path meet
+	int mMeetIndex;
+};
+
+#endif
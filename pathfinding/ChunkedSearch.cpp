@@ -0,0 +1,176 @@
+#include <stdafx.h>
+
+#include "ChunkedSearch.h"
+#include "GridTopology.h"
+#include "OpenList.h"
+#include <climits>
+
+// Tables of up to 256k nodes, enough for queries visiting 192k cells, are kept between
+// queries since growing the table again for every query costs about as much as the search
+const size_t ChunkedSearch::MAX_NODE_BYTES = 4 * 1024 * 1024;
+
+namespace {
+
+const size_t MIN_NODES = 1024;
+
+// Fibonacci hashing of 4 x 4 blocks of cells, the cells of a block take consecutive
+// slots so that the neighbors of a node are usually in the same cache lines
+size_t HashCell(int x, int y, size_t mask) {
+	unsigned long long block = (static_cast<unsigned long long>(y >> 2) << 32) | static_cast<unsigned int>(x >> 2);
+	size_t slot = static_cast<size_t>((block * 0x9E3779B97F4A7C15ULL) >> 40) << 4;
+	return (slot | ((y & 3) << 2) | (x & 3)) & mask;
+}
+
+}
+
+ChunkedSearch::ChunkedSearch(ChunkedWorld& world) :
+	mWorld(world),
+	mNodeCount(0),
+	mExpandedCount(0),
+	mPathCost(0)
+{
+}
+
+void ChunkedSearch::Clear() {
+	std::vector<Node>().swap(mNodes);
+	mNodeCount = 0;
+}
+
+ChunkedSearch::Node& ChunkedSearch::GetNode(int x, int y) {
+	if ((mNodeCount + 1) * 4 > mNodes.size() * 3) {
+		Grow();
+	}
+	size_t mask = mNodes.size() - 1;
+	for (size_t slot = HashCell(x, y, mask); ; slot = (slot + 1) & mask) {
+		Node& node = mNodes[slot];
+		if (!node.used) {
+			Node visited = { x, y, UINT_MAX, -1, false, true };
+			node = visited;
+			++mNodeCount;
+			return node;
+		}
+		if (node.x == x && node.y == y) {
+			return node;
+		}
+	}
+}
+
+void ChunkedSearch::Grow() {
+	Node free = { 0, 0, 0, -1, false, false };
+	std::vector<Node> nodes(std::max(MIN_NODES, mNodes.size() * 2), free);
+	nodes.swap(mNodes);
+	size_t mask = mNodes.size() - 1;
+	for (const Node& node : nodes) {
+		if (node.used) {
+			size_t slot = HashCell(node.x, node.y, mask);
+			while (mNodes[slot].used) {
+				slot = (slot + 1) & mask;
+			}
+			mNodes[slot] = node;
+		}
+	}
+}
+
+int ChunkedSearch::CalculateDistance(int x, int y) const {
+	return GridTopology::GetDistance(GridTopology::CONNECTIVITY_4, mEndNode.x - x, mEndNode.y - y) * mWorld.GetMinCost();
+}
+
+void ChunkedSearch::EnterChunk(int x, int y, int direction) {
+	// The frontier is about to fault on this chunk, the chunks beyond it in the same
+	// direction and beside it are likely to be next
+	int chunkX = x / mWorld.GetChunkSize();
+	int chunkY = y / mWorld.GetChunkSize();
+	int stepX = GridTopology::dirX[direction];
+	int stepY = GridTopology::dirY[direction];
+	mWorld.Prefetch(chunkX + stepX, chunkY + stepY);
+	mWorld.Prefetch(chunkX + stepY, chunkY + stepX);
+	mWorld.Prefetch(chunkX - stepY, chunkY - stepX);
+}
+
+bool ChunkedSearch::FindPath(const GridNode& start, const GridNode& end, std::vector<GridNode>& path) {
+	path.clear();
+	mEndNode = end;
+	mExpandedCount = 0;
+	mPathCost = 0;
+	if (!mWorld.IsWalkable(start.x, start.y) || !mWorld.IsWalkable(end.x, end.y) || start.Compare(end)) {
+		return false;
+	}
+
+	// Frees the table after a large query and clears a smaller one
+	if (GetNodeBytes() > MAX_NODE_BYTES) {
+		Clear();
+	}
+	Node free = { 0, 0, 0, -1, false, false };
+	std::fill(mNodes.begin(), mNodes.end(), free);
+	mNodeCount = 0;
+	mOpenList = std::priority_queue<OpenEntry>();
+
+	GetNode(start.x, start.y).g = 0;
+	int startH = CalculateDistance(start.x, start.y);
+	OpenEntry startEntry = { OpenList::MakeKey(startH, startH), start.x, start.y };
+	mOpenList.push(startEntry);
+
+	int chunkSize = mWorld.GetChunkSize();
+	bool found = false;
+	while (!mOpenList.empty()) {
+		OpenEntry entry = mOpenList.top();
+		mOpenList.pop();
+		Node& node = GetNode(entry.x, entry.y);
+		if (node.closed) {
+			// Stale entry of a node reached again with a smaller cost
+			continue;
+		}
+		node.closed = true;
+		++mExpandedCount;
+		if (entry.x == end.x && entry.y == end.y) {
+			found = true;
+			break;
+		}
+
+		unsigned int g = node.g;
+		for (int i = 0; i < GridTopology::GetDirectionCount(GridTopology::CONNECTIVITY_4); ++i) {
+			int x = entry.x + GridTopology::dirX[i];
+			int y = entry.y + GridTopology::dirY[i];
+			if (!mWorld.IsInside(x, y)) {
+				continue;
+			}
+			if ((x / chunkSize != entry.x / chunkSize || y / chunkSize != entry.y / chunkSize) && !mWorld.IsResident(x / chunkSize, y / chunkSize)) {
+				EnterChunk(x, y, i);
+			}
+			ChunkedWorld::Cost cost = mWorld.GetCost(x, y);
+			if (cost == CostGrid::BLOCKED) {
+				continue;
+			}
+
+			// Cells reached for the first time have an infinite cost
+			Node& next = GetNode(x, y);
+			unsigned int nextG = g + cost;
+			if (nextG >= next.g) {
+				continue;
+			}
+			next.g = nextG;
+			next.parentDirection = static_cast<signed char>(i);
+			// Closed nodes reached with a smaller cost are reopened
+			next.closed = false;
+			int h = CalculateDistance(x, y);
+			OpenEntry nextEntry = { OpenList::MakeKey(nextG + h, h), x, y };
+			mOpenList.push(nextEntry);
+		}
+	}
+	if (!found) {
+		return false;
+	}
+
+	mPathCost = GetNode(end.x, end.y).g;
+	GridNode node = end;
+	for (;;) {
+		path.push_back(node);
+		int direction = GetNode(node.x, node.y).parentDirection;
+		if (direction < 0) {
+			break;
+		}
+		node = GridNode(node.x - GridTopology::dirX[direction], node.y - GridTopology::dirY[direction]);
+	}
+	std::reverse(path.begin(), path.end());
+	return true;
+}
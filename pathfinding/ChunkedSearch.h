@@ -0,0 +1,71 @@
+#ifndef __CHUNKEDSEARCH_H__
+#define __CHUNKEDSEARCH_H__
+
+#include <queue>
+#include <vector>
+#include "GridNode.h"
+#include "ChunkedWorld.h"
+
+// A* over a ChunkedWorld with the costs and heuristic of AStarSearch, moving in 4
+// directions only, the heuristic scaled by the lowest cost of the world. Search nodes
+// live in a hash table of the cells visited by the query, so memory grows with the cells
+// searched and not with the size of the world or the chunks touched. When the search
+// reaches a chunk that is not resident it prefetches the chunks beyond it, ahead of the
+// search frontier.
+class ChunkedSearch {
+public:
+	static const size_t MAX_NODE_BYTES;
+
+	explicit ChunkedSearch(ChunkedWorld& world);
+
+	// Writes the cells from start to end, false if there is no path
+	bool FindPath(const GridNode& start, const GridNode& end, std::vector<GridNode>& path);
+
+	unsigned int GetExpandedCount() const { return mExpandedCount; }
+	unsigned int GetPathCost() const { return mPathCost; }
+	// Bytes of the node table, which keeps the size of the largest query since it was freed
+	size_t GetNodeBytes() const { return mNodes.capacity() * sizeof(Node); }
+	// Frees the node table, it is also freed when a query starts with more than MAX_NODE_BYTES
+	void Clear();
+
+private:
+	struct Node {
+		// World cell, worlds can have more cells than an int can index
+		int x;
+		int y;
+		unsigned int g;
+		// Direction from the parent, -1 for the start
+		signed char parentDirection;
+		bool closed;
+		// False for a free slot of the table
+		bool used;
+	};
+
+	struct OpenEntry {
+		unsigned long long key;
+		int x;
+		int y;
+
+		bool operator<(const OpenEntry& other) const { return key > other.key; }
+	};
+
+	// Returns the node of a cell, visiting it if the query did not yet. Visiting a cell
+	// can move every node.
+	Node& GetNode(int x, int y);
+	// Doubles the node table, moving the nodes of the query
+	void Grow();
+	int CalculateDistance(int x, int y) const;
+	void EnterChunk(int x, int y, int direction);
+
+	ChunkedWorld& mWorld;
+	// Open addressing with linear probing, a power of two size at most three quarters full
+	std::vector<Node> mNodes;
+	size_t mNodeCount;
+	std::priority_queue<OpenEntry> mOpenList;
+
+	GridNode mEndNode;
+	unsigned int mExpandedCount;
+	unsigned int mPathCost;
+};
+
+#endif
@@ -0,0 +1,217 @@
+#include <stdafx.h>
+
+#include "ChunkedWorld.h"
+#include <algorithm>
+#include <cstring>
+
+const unsigned int ChunkedWorld::FORMAT_VERSION = 1;
+// Enough chunks for a search crossing the corner of four chunks without thrashing
+const int ChunkedWorld::MIN_RESIDENT_CHUNKS = 4;
+
+namespace {
+
+const char MAGIC[4] = { 'P', 'F', 'W', 'D' };
+// Chunk data starts at a page boundary so that chunks map to whole pages
+const size_t CHUNKS_ALIGNMENT = 4096;
+
+}
+
+struct ChunkedWorld::Header {
+	char magic[4];
+	unsigned int formatVersion;
+	unsigned int cols;
+	unsigned int rows;
+	unsigned int chunkSize;
+	// Lowest cost of a walkable cell, 0 when there is none. Files written before it was
+	// stored hold 0, which only weakens the heuristic of the searches.
+	unsigned int minCost;
+	unsigned long long chunksOffset;
+};
+
+ChunkedWorld::ChunkedWorld() :
+	mCols(0),
+	mRows(0),
+	mChunkSize(0),
+	mChunkShift(0),
+	mChunkMask(0),
+	mChunksX(0),
+	mChunksY(0),
+	mChunksOffset(0),
+	mMinCost(0),
+	mCapacity(MIN_RESIDENT_CHUNKS),
+	mLastChunkId(-1),
+	mLastChunk(nullptr),
+	mFaults(0),
+	mPrefetches(0),
+	mEvictions(0)
+{
+}
+
+bool ChunkedWorld::Open(const char* filename) {
+	Close();
+	if (!mFile.Open(filename) || mFile.GetSize() < sizeof(Header)) {
+		Close();
+		return false;
+	}
+
+	const Header* header = reinterpret_cast<const Header*>(mFile.GetData());
+	unsigned int chunkSize = header->chunkSize;
+	if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->formatVersion != FORMAT_VERSION
+		|| chunkSize == 0 || chunkSize > 4096 || (chunkSize & (chunkSize - 1)) != 0 || header->cols >= 0x40000000 || header->rows >= 0x40000000 || header->minCost >= CostGrid::BLOCKED) {
+		Close();
+		return false;
+	}
+	unsigned long long chunksX = (header->cols + chunkSize - 1ULL) / chunkSize;
+	unsigned long long chunksY = (header->rows + chunkSize - 1ULL) / chunkSize;
+	unsigned long long chunksSize = chunksX * chunksY * chunkSize * chunkSize;
+	if (chunksX * chunksY >= 0x80000000ULL || header->chunksOffset > mFile.GetSize() || chunksSize > mFile.GetSize() - header->chunksOffset) {
+		Close();
+		return false;
+	}
+
+	mCols = header->cols;
+	mRows = header->rows;
+	mChunkSize = chunkSize;
+	for (mChunkShift = 0; (1 << mChunkShift) < mChunkSize; ++mChunkShift) {
+	}
+	mChunkMask = mChunkSize - 1;
+	mChunksX = static_cast<int>(chunksX);
+	mChunksY = static_cast<int>(chunksY);
+	mChunksOffset = static_cast<size_t>(header->chunksOffset);
+	mMinCost = static_cast<Cost>(header->minCost);
+	return true;
+}
+
+void ChunkedWorld::Close() {
+	mFile.Close();
+	mCols = mRows = mChunkSize = mChunksX = mChunksY = 0;
+	mMinCost = 0;
+	mResident.clear();
+	mIndex.clear();
+	mPrefetched.clear();
+	mLastChunkId = -1;
+	mLastChunk = nullptr;
+}
+
+bool ChunkedWorld::Write(const char* filename, int cols, int rows, int chunkSize, const RowSource& source) {
+	if (cols < 0 || rows < 0 || chunkSize <= 0 || (chunkSize & (chunkSize - 1)) != 0) {
+		return false;
+	}
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	Header header = {};
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.formatVersion = FORMAT_VERSION;
+	header.cols = cols;
+	header.rows = rows;
+	header.chunkSize = chunkSize;
+	header.chunksOffset = CHUNKS_ALIGNMENT;
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	std::vector<char> padding(CHUNKS_ALIGNMENT - sizeof(header), 0);
+	file.write(padding.data(), padding.size());
+
+	// Converts one row of chunks at a time, so the whole world never needs to be in memory
+	int chunksX = (cols + chunkSize - 1) / chunkSize;
+	size_t stride = static_cast<size_t>(chunksX) * chunkSize;
+	std::vector<Cost> rowsBuffer(stride * chunkSize);
+	Cost minCost = CostGrid::BLOCKED;
+	for (int chunkY = 0; chunkY * chunkSize < rows; ++chunkY) {
+		std::fill(rowsBuffer.begin(), rowsBuffer.end(), CostGrid::BLOCKED);
+		for (int y = 0; y < chunkSize && chunkY * chunkSize + y < rows; ++y) {
+			Cost* row = &rowsBuffer[y * stride];
+			source(chunkY * chunkSize + y, row);
+			if (cols > 0) {
+				minCost = std::min(minCost, *std::min_element(row, row + cols));
+			}
+		}
+		for (int chunkX = 0; chunkX < chunksX; ++chunkX) {
+			for (int y = 0; y < chunkSize; ++y) {
+				file.write(reinterpret_cast<const char*>(&rowsBuffer[y * stride + chunkX * chunkSize]), chunkSize);
+			}
+		}
+	}
+
+	// The lowest cost is only known once every row was read
+	header.minCost = minCost == CostGrid::BLOCKED ? 0 : minCost;
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	return file.good();
+}
+
+bool ChunkedWorld::Write(const char* filename, const CostGrid& grid, int chunkSize) {
+	return Write(filename, grid.GetCols(), grid.GetRows(), chunkSize, [&grid](int y, Cost* row) {
+		memcpy(row, grid.GetData() + grid.GetIndex(0, y), grid.GetCols());
+	});
+}
+
+void ChunkedWorld::SetMemoryBudget(size_t bytes) {
+	size_t chunkBytes = std::max<size_t>(GetChunkBytes(), 1);
+	mCapacity = std::max<size_t>(bytes / chunkBytes, MIN_RESIDENT_CHUNKS);
+	while (mResident.size() > mCapacity) {
+		Evict();
+	}
+}
+
+const ChunkedWorld::Cost* ChunkedWorld::GetChunk(int chunkX, int chunkY) {
+	int id = GetChunkId(chunkX, chunkY);
+	auto found = mIndex.find(id);
+	if (mIndex.end() != found) {
+		mResident.splice(mResident.begin(), mResident, found->second);
+		return mResident.front().cells.data();
+	}
+
+	++mFaults;
+	if (mResident.size() >= mCapacity) {
+		// Reuses the memory of the least recently used chunk
+		ForgetChunk(mResident.back().id);
+		mResident.splice(mResident.begin(), mResident, --mResident.end());
+	} else {
+		mResident.push_front(ResidentChunk());
+	}
+
+	ResidentChunk& chunk = mResident.front();
+	chunk.id = id;
+	const Cost* data = GetChunkData(id);
+	chunk.cells.assign(data, data + GetChunkBytes());
+	mIndex[id] = mResident.begin();
+	mPrefetched.erase(id);
+	return chunk.cells.data();
+}
+
+void ChunkedWorld::Evict() {
+	ForgetChunk(mResident.back().id);
+	mResident.pop_back();
+}
+
+void ChunkedWorld::ForgetChunk(int id) {
+	mIndex.erase(id);
+	++mEvictions;
+	if (id == mLastChunkId) {
+		mLastChunkId = -1;
+		mLastChunk = nullptr;
+	}
+}
+
+void ChunkedWorld::Prefetch(int chunkX, int chunkY) {
+	if (!IsChunkInside(chunkX, chunkY)) {
+		return;
+	}
+	int id = GetChunkId(chunkX, chunkY);
+	if (!mIndex.count(id) && mPrefetched.insert(id).second) {
+		mFile.Prefetch(mChunksOffset + id * GetChunkBytes(), GetChunkBytes());
+		++mPrefetches;
+	}
+}
+
+ChunkedWorld::Cost ChunkedWorld::GetCost(int x, int y) {
+	int offset;
+	int id = GetChunkId(x, y, offset);
+	if (id != mLastChunkId) {
+		mLastChunk = GetChunk(x >> mChunkShift, y >> mChunkShift);
+		mLastChunkId = id;
+	}
+	return mLastChunk[offset];
+}
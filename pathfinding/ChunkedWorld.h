@@ -0,0 +1,113 @@
+#ifndef __CHUNKEDWORLD_H__
+#define __CHUNKEDWORLD_H__
+
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "CostGrid.h"
+#include "MappedFile.h"
+
+// World grid stored on disk as square chunks of cells, for worlds too large to keep in a
+// CostGrid. The world file is memory mapped and chunks are copied to a bounded LRU cache
+// of resident chunks the first time they are read, so the memory used does not depend on
+// the size of the world. Reading a chunk that is not resident is a chunk fault, which
+// reads the file synchronously unless the chunk was prefetched before.
+//
+// World files hold a header and every chunk in row-major order, each one a block of
+// chunkSize x chunkSize cost bytes, with a power of two chunkSize. Cells past the edges
+// of the world are blocked.
+class ChunkedWorld {
+public:
+	typedef CostGrid::Cost Cost;
+	// Writes one row of the world, cols costs
+	typedef std::function<void(int y, Cost* row)> RowSource;
+
+	static const unsigned int FORMAT_VERSION;
+	static const int MIN_RESIDENT_CHUNKS;
+
+	ChunkedWorld();
+
+	bool Open(const char* filename);
+	void Close();
+	bool IsOpen() const { return mFile.IsOpen(); }
+
+	static bool Write(const char* filename, int cols, int rows, int chunkSize, const RowSource& source);
+	static bool Write(const char* filename, const CostGrid& grid, int chunkSize);
+
+	int GetCols() const { return mCols; }
+	int GetRows() const { return mRows; }
+	int GetChunkSize() const { return mChunkSize; }
+	// Lowest cost of a walkable cell, the scale of the heuristic of a search
+	Cost GetMinCost() const { return mMinCost; }
+	int GetChunksX() const { return mChunksX; }
+	int GetChunksY() const { return mChunksY; }
+	bool IsInside(int x, int y) const { return x >= 0 && y >= 0 && x < mCols && y < mRows; }
+	bool IsChunkInside(int chunkX, int chunkY) const { return chunkX >= 0 && chunkY >= 0 && chunkX < mChunksX && chunkY < mChunksY; }
+
+	// Limits the memory of the resident chunks, evicting the least recently used ones
+	void SetMemoryBudget(size_t bytes);
+	size_t GetMemoryBudget() const { return mCapacity * GetChunkBytes(); }
+
+	// Cells of a chunk, made resident if needed. Only valid until the next call that can
+	// make another chunk resident.
+	const Cost* GetChunk(int chunkX, int chunkY);
+	bool IsResident(int chunkX, int chunkY) const { return mIndex.count(GetChunkId(chunkX, chunkY)) != 0; }
+	// Starts reading a chunk in the background if it is not resident
+	void Prefetch(int chunkX, int chunkY);
+
+	Cost GetCost(int x, int y);
+	bool IsWalkable(int x, int y) { return IsInside(x, y) && GetCost(x, y) != CostGrid::BLOCKED; }
+
+	unsigned int GetFaultCount() const { return mFaults; }
+	unsigned int GetPrefetchCount() const { return mPrefetches; }
+	unsigned int GetEvictionCount() const { return mEvictions; }
+	size_t GetResidentBytes() const { return mResident.size() * GetChunkBytes(); }
+	void ResetCounters() { mFaults = mPrefetches = mEvictions = 0; }
+
+private:
+	struct Header;
+	struct ResidentChunk {
+		int id;
+		std::vector<Cost> cells;
+	};
+	typedef std::list<ResidentChunk> ResidentList;
+
+	int GetChunkId(int chunkX, int chunkY) const { return chunkY * mChunksX + chunkX; }
+	int GetChunkId(int x, int y, int& offset) const {
+		offset = ((y & mChunkMask) << mChunkShift) + (x & mChunkMask);
+		return GetChunkId(x >> mChunkShift, y >> mChunkShift);
+	}
+	size_t GetChunkBytes() const { return static_cast<size_t>(mChunkSize) * mChunkSize; }
+	const Cost* GetChunkData(int id) const { return mFile.GetData() + mChunksOffset + id * GetChunkBytes(); }
+	void Evict();
+	void ForgetChunk(int id);
+
+	MappedFile mFile;
+	int mCols;
+	int mRows;
+	int mChunkSize;
+	int mChunkShift;
+	int mChunkMask;
+	int mChunksX;
+	int mChunksY;
+	size_t mChunksOffset;
+	Cost mMinCost;
+
+	size_t mCapacity;
+	// Most recently used chunks first
+	ResidentList mResident;
+	std::unordered_map<int, ResidentList::iterator> mIndex;
+	// Chunks prefetched since they were last resident
+	std::unordered_set<int> mPrefetched;
+	// Last chunk read by GetCost(), most reads fall in the same chunk as the previous one
+	int mLastChunkId;
+	const Cost* mLastChunk;
+
+	unsigned int mFaults;
+	unsigned int mPrefetches;
+	unsigned int mEvictions;
+};
+
+#endif
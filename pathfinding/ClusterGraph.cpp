@@ -0,0 +1,418 @@
+#include <stdafx.h>
+
+#include "ClusterGraph.h"
+#include "GridTopology.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+// Walkable stretches of a border up to this width get a single entrance in the middle,
+// wider ones get an entrance at each end
+const int ClusterGraph::MAX_ENTRANCE_WIDTH = 6;
+
+ClusterGraph::ClusterGraph() :
+	mGrid(nullptr),
+	mClusterSize(0),
+	mClustersX(0),
+	mClustersY(0),
+	mExpandedCount(0)
+{
+}
+
+void ClusterGraph::Build(const CostGrid& grid, int clusterSize) {
+	mGrid = &grid;
+	mClusterSize = std::max(clusterSize, 2);
+	mClustersX = (grid.GetCols() + mClusterSize - 1) / mClusterSize;
+	mClustersY = (grid.GetRows() + mClusterSize - 1) / mClusterSize;
+
+	mClusters.resize(mClustersX * mClustersY);
+	for (int cy = 0; cy < mClustersY; ++cy) {
+		for (int cx = 0; cx < mClustersX; ++cx) {
+			Cluster& cluster = mClusters[cy * mClustersX + cx];
+			cluster.x0 = cx * mClusterSize;
+			cluster.y0 = cy * mClusterSize;
+			cluster.x1 = std::min(cluster.x0 + mClusterSize, grid.GetCols()) - 1;
+			cluster.y1 = std::min(cluster.y0 + mClusterSize, grid.GetRows()) - 1;
+			cluster.nodes.clear();
+		}
+	}
+	mNodes.clear();
+	mFreeNodes.clear();
+	mCellNodes.assign(grid.GetCellCount(), -1);
+	mContext.Prepare(grid.GetCellCount());
+
+	for (int cy = 0; cy < mClustersY; ++cy) {
+		for (int cx = 0; cx < mClustersX; ++cx) {
+			int cluster = cy * mClustersX + cx;
+			if (cx + 1 < mClustersX) {
+				BuildBorder(cluster, cluster + 1, true);
+			}
+			if (cy + 1 < mClustersY) {
+				BuildBorder(cluster, cluster + mClustersX, false);
+			}
+		}
+	}
+	for (int cluster = 0; cluster < static_cast<int>(mClusters.size()); ++cluster) {
+		CollectNodes(cluster);
+		BuildIntraEdges(cluster);
+	}
+}
+
+void ClusterGraph::RebuildClusters(int clusterX0, int clusterY0, int clusterX1, int clusterY1) {
+	clusterX0 = std::max(clusterX0, 0);
+	clusterY0 = std::max(clusterY0, 0);
+	clusterX1 = std::min(clusterX1, mClustersX - 1);
+	clusterY1 = std::min(clusterY1, mClustersY - 1);
+	if (!mGrid || clusterX0 > clusterX1 || clusterY0 > clusterY1) {
+		return;
+	}
+
+	// Borders between the clusters of the range and with their neighbours
+	for (int cy = clusterY0; cy <= clusterY1; ++cy) {
+		for (int cx = std::max(clusterX0 - 1, 0); cx <= clusterX1 && cx + 1 < mClustersX; ++cx) {
+			int cluster = cy * mClustersX + cx;
+			ClearBorder(cluster, cluster + 1);
+			BuildBorder(cluster, cluster + 1, true);
+		}
+	}
+	for (int cy = std::max(clusterY0 - 1, 0); cy <= clusterY1 && cy + 1 < mClustersY; ++cy) {
+		for (int cx = clusterX0; cx <= clusterX1; ++cx) {
+			int cluster = cy * mClustersX + cx;
+			ClearBorder(cluster, cluster + mClustersX);
+			BuildBorder(cluster, cluster + mClustersX, false);
+		}
+	}
+
+	// Entrances may have moved, so the neighbours need their intra edges rebuilt as well.
+	// Clusters at the corners of the range share no border with it.
+	std::vector<int> affected;
+	for (int cy = std::max(clusterY0 - 1, 0); cy <= std::min(clusterY1 + 1, mClustersY - 1); ++cy) {
+		for (int cx = std::max(clusterX0 - 1, 0); cx <= std::min(clusterX1 + 1, mClustersX - 1); ++cx) {
+			bool insideX = cx >= clusterX0 && cx <= clusterX1;
+			bool insideY = cy >= clusterY0 && cy <= clusterY1;
+			if (insideX || insideY) {
+				affected.push_back(cy * mClustersX + cx);
+			}
+		}
+	}
+	for (int affectedCluster : affected) {
+		CollectNodes(affectedCluster);
+	}
+	for (int affectedCluster : affected) {
+		BuildIntraEdges(affectedCluster);
+	}
+}
+
+void ClusterGraph::OnRegionChanged(int x0, int y0, int x1, int y1, bool walkabilityChanged) {
+	if (!mGrid || !mGrid->IsInside(x0, y0) || !mGrid->IsInside(x1, y1)) {
+		return;
+	}
+	const Cluster& cluster = mClusters[GetClusterIndex(std::max(x0, 0), std::max(y0, 0))];
+	if (!walkabilityChanged && x0 > cluster.x0 && x1 < cluster.x1 && y0 > cluster.y0 && y1 < cluster.y1) {
+		// Edges between clusters cost the border cell they enter, inner cells only change
+		// the costs of the intra edges
+		BuildIntraEdges(GetClusterIndex(x0, y0));
+		return;
+	}
+	RebuildClusters(x0 / mClusterSize, y0 / mClusterSize, x1 / mClusterSize, y1 / mClusterSize);
+}
+
+bool ClusterGraph::IsInCluster(int index, const Cluster& cluster) const {
+	GridNode node = mGrid->GetNode(index);
+	return node.x >= cluster.x0 && node.x <= cluster.x1 && node.y >= cluster.y0 && node.y <= cluster.y1;
+}
+
+void ClusterGraph::BuildBorder(int clusterA, int clusterB, bool horizontal) {
+	// Cluster A is left of (horizontal) or above cluster B
+	const Cluster& a = mClusters[clusterA];
+	const Cluster& b = mClusters[clusterB];
+	int length = horizontal ? a.y1 - a.y0 + 1 : a.x1 - a.x0 + 1;
+	int step = horizontal ? mGrid->GetStride() : 1;
+	// First cells of the border on both sides, the first cell of B touches A
+	int cellA = horizontal ? mGrid->GetIndex(a.x1, a.y0) : mGrid->GetIndex(a.x0, a.y1);
+	int cellB = mGrid->GetIndex(b.x0, b.y0);
+
+	int runStart = -1;
+	for (int i = 0; i <= length; ++i) {
+		bool open = i < length && mGrid->IsWalkable(cellA + i * step) && mGrid->IsWalkable(cellB + i * step);
+		if (open && runStart < 0) {
+			runStart = i;
+		} else if (!open && runStart >= 0) {
+			int runEnd = i - 1;
+			if (runEnd - runStart + 1 < MAX_ENTRANCE_WIDTH) {
+				int middle = (runStart + runEnd) / 2;
+				AddTransition(cellA + middle * step, cellB + middle * step);
+			} else {
+				AddTransition(cellA + runStart * step, cellB + runStart * step);
+				AddTransition(cellA + runEnd * step, cellB + runEnd * step);
+			}
+			runStart = -1;
+		}
+	}
+}
+
+void ClusterGraph::ClearBorder(int clusterA, int clusterB) {
+	// Removes the edges crossing between the two clusters, the nodes left without any
+	// crossing edge are released by CollectNodes()
+	for (int cluster : { clusterA, clusterB }) {
+		int other = cluster == clusterA ? clusterB : clusterA;
+		for (int nodeIndex : mClusters[cluster].nodes) {
+			std::vector<Edge>& edges = mNodes[nodeIndex].edges;
+			edges.erase(std::remove_if(edges.begin(), edges.end(), [this, other](const Edge& edge) {
+				return !edge.intra && mNodes[edge.target].cluster == other;
+			}), edges.end());
+		}
+	}
+}
+
+void ClusterGraph::AddTransition(int cellA, int cellB) {
+	int nodeA = GetOrAddNode(cellA);
+	int nodeB = GetOrAddNode(cellB);
+	// Moving into a cell costs the cost of that cell
+	Edge edgeAB = { nodeB, mGrid->GetCost(cellB), false };
+	Edge edgeBA = { nodeA, mGrid->GetCost(cellA), false };
+	mNodes[nodeA].edges.push_back(edgeAB);
+	mNodes[nodeB].edges.push_back(edgeBA);
+}
+
+int ClusterGraph::GetOrAddNode(int cell) {
+	if (mCellNodes[cell] >= 0) {
+		return mCellNodes[cell];
+	}
+
+	int nodeIndex;
+	if (mFreeNodes.empty()) {
+		nodeIndex = static_cast<int>(mNodes.size());
+		mNodes.push_back(AbstractNode());
+	} else {
+		nodeIndex = mFreeNodes.back();
+		mFreeNodes.pop_back();
+	}
+
+	GridNode node = mGrid->GetNode(cell);
+	AbstractNode& abstractNode = mNodes[nodeIndex];
+	abstractNode.cell = cell;
+	abstractNode.cluster = GetClusterIndex(node.x, node.y);
+	abstractNode.edges.clear();
+	mCellNodes[cell] = nodeIndex;
+	mClusters[abstractNode.cluster].nodes.push_back(nodeIndex);
+	return nodeIndex;
+}
+
+void ClusterGraph::CollectNodes(int cluster) {
+	// Keeps the nodes that are still an entrance and releases the others
+	std::vector<int>& nodes = mClusters[cluster].nodes;
+	std::vector<int> kept;
+	for (int nodeIndex : nodes) {
+		AbstractNode& abstractNode = mNodes[nodeIndex];
+		if (abstractNode.cell < 0) {
+			continue;
+		}
+		bool isEntrance = std::any_of(abstractNode.edges.begin(), abstractNode.edges.end(), [](const Edge& edge) { return !edge.intra; });
+		if (isEntrance) {
+			kept.push_back(nodeIndex);
+		} else {
+			mCellNodes[abstractNode.cell] = -1;
+			abstractNode.cell = -1;
+			abstractNode.edges.clear();
+			mFreeNodes.push_back(nodeIndex);
+		}
+	}
+	// A node can be listed twice when it was created again after being kept
+	std::sort(kept.begin(), kept.end());
+	kept.erase(std::unique(kept.begin(), kept.end()), kept.end());
+	nodes.swap(kept);
+}
+
+void ClusterGraph::BuildIntraEdges(int clusterIndex) {
+	const Cluster& cluster = mClusters[clusterIndex];
+	for (int nodeIndex : cluster.nodes) {
+		std::vector<Edge>& edges = mNodes[nodeIndex].edges;
+		edges.erase(std::remove_if(edges.begin(), edges.end(), [](const Edge& edge) { return edge.intra; }), edges.end());
+	}
+
+	for (int nodeIndex : cluster.nodes) {
+		SearchCluster(mNodes[nodeIndex].cell, cluster, false, -1);
+		for (int otherIndex : cluster.nodes) {
+			int otherCell = mNodes[otherIndex].cell;
+			if (otherIndex != nodeIndex && mContext.IsClosed(otherCell)) {
+				Edge edge = { otherIndex, mContext.GetNode(otherCell).g, true };
+				mNodes[nodeIndex].edges.push_back(edge);
+			}
+		}
+	}
+}
+
+unsigned int ClusterGraph::SearchCluster(int source, const Cluster& cluster, bool reverse, int target) {
+	unsigned int expandedCount = 0;
+	mContext.Reset();
+	mContext.Visit(source);
+	mContext.PushOpen(source, 0);
+
+	int stride = mGrid->GetStride();
+	const int offsets[] = { 1, stride, -1, -stride };
+	while (!mContext.IsOpenListEmpty()) {
+		int index = mContext.PopOpen();
+		++expandedCount;
+		if (index == target) {
+			break;
+		}
+		int g = mContext.GetNode(index).g;
+		for (int offset : offsets) {
+			int next = index + offset;
+			if (!mGrid->IsWalkable(next) || !IsInCluster(next, cluster) || mContext.IsClosed(next)) {
+				continue;
+			}
+			// Reversed, the move goes from the neighbour into this cell
+			int cost = g + mGrid->GetCost(reverse ? index : next);
+			bool visited = mContext.IsVisited(next);
+			PathNode& nextNode = mContext.Visit(next);
+			if (!visited || cost < nextNode.g) {
+				nextNode.g = cost;
+				nextNode.parent = index;
+				if (mContext.IsOpen(next)) {
+					mContext.UpdateOpen(next, OpenList::MakeKey(cost, 0));
+				} else {
+					mContext.PushOpen(next, OpenList::MakeKey(cost, 0));
+				}
+			}
+		}
+	}
+	return expandedCount;
+}
+
+bool ClusterGraph::FindPath(const GridNode& start, const GridNode& end, std::vector<GridNode>& path) {
+	path.clear();
+	mExpandedCount = 0;
+	if (!mGrid || !mGrid->IsWalkable(start) || !mGrid->IsWalkable(end) || start.Compare(end)) {
+		return false;
+	}
+	if (mCellNodes.size() != static_cast<size_t>(mGrid->GetCellCount())) {
+		// The grid was resized after the graph was built
+		return false;
+	}
+
+	int startCell = mGrid->GetIndex(start);
+	int endCell = mGrid->GetIndex(end);
+	int startCluster = GetClusterIndex(start.x, start.y);
+	int endCluster = GetClusterIndex(end.x, end.y);
+	int numNodes = static_cast<int>(mNodes.size());
+	int startNode = numNodes;
+	int endNode = numNodes + 1;
+
+	// Temporary edges joining the start and end cells to the entrances of their clusters
+	mStartEdges.clear();
+	mExpandedCount += SearchCluster(startCell, mClusters[startCluster], false, -1);
+	for (int nodeIndex : mClusters[startCluster].nodes) {
+		if (mContext.IsClosed(mNodes[nodeIndex].cell)) {
+			Edge edge = { nodeIndex, mContext.GetNode(mNodes[nodeIndex].cell).g, true };
+			mStartEdges.push_back(edge);
+		}
+	}
+	if (startCluster == endCluster && mContext.IsClosed(endCell)) {
+		Edge edge = { endNode, mContext.GetNode(endCell).g, true };
+		mStartEdges.push_back(edge);
+	}
+
+	mEndEdges.clear();
+	mExpandedCount += SearchCluster(endCell, mClusters[endCluster], true, -1);
+	for (int nodeIndex : mClusters[endCluster].nodes) {
+		if (mContext.IsClosed(mNodes[nodeIndex].cell)) {
+			// The edge goes from the entrance to the end, target holds the entrance
+			Edge edge = { nodeIndex, mContext.GetNode(mNodes[nodeIndex].cell).g, true };
+			mEndEdges.push_back(edge);
+		}
+	}
+
+	// A* over the abstract graph
+	mAbstractG.assign(numNodes + 2, -1);
+	mAbstractParent.assign(numNodes + 2, -1);
+	mAbstractClosed.assign(numNodes + 2, false);
+	typedef std::pair<OpenList::Key, int> QueueEntry;
+	std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > openList;
+
+	mAbstractG[startNode] = 0;
+	openList.push(QueueEntry(0, startNode));
+	while (!openList.empty()) {
+		int current = openList.top().second;
+		openList.pop();
+		if (mAbstractClosed[current]) {
+			continue;
+		}
+		mAbstractClosed[current] = true;
+		++mExpandedCount;
+		if (current == endNode) {
+			break;
+		}
+
+		auto relax = [&](int next, int edgeCost) {
+			int cost = mAbstractG[current] + edgeCost;
+			if (!mAbstractClosed[next] && (mAbstractG[next] < 0 || cost < mAbstractG[next])) {
+				mAbstractG[next] = cost;
+				mAbstractParent[next] = current;
+				int h = next == endNode ? 0 : CalculateDistance(mNodes[next].cell, endCell);
+				openList.push(QueueEntry(OpenList::MakeKey(cost + h, h), next));
+			}
+		};
+
+		const std::vector<Edge>& edges = current == startNode ? mStartEdges : mNodes[current].edges;
+		for (const Edge& edge : edges) {
+			relax(edge.target, edge.cost);
+		}
+		if (current != startNode && mNodes[current].cluster == endCluster) {
+			for (const Edge& edge : mEndEdges) {
+				if (edge.target == current) {
+					relax(endNode, edge.cost);
+				}
+			}
+		}
+	}
+
+	if (!mAbstractClosed[endNode]) {
+		return false;
+	}
+
+	// Refines the abstract path, one cluster at a time
+	mAbstractPath.clear();
+	for (int nodeIndex = endNode; nodeIndex >= 0; nodeIndex = mAbstractParent[nodeIndex]) {
+		mAbstractPath.push_back(nodeIndex == startNode ? startCell : nodeIndex == endNode ? endCell : mNodes[nodeIndex].cell);
+	}
+	std::reverse(mAbstractPath.begin(), mAbstractPath.end());
+
+	path.push_back(start);
+	for (size_t i = 1; i < mAbstractPath.size(); ++i) {
+		if (!RefineEdge(mAbstractPath[i - 1], mAbstractPath[i], path)) {
+			path.clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+bool ClusterGraph::RefineEdge(int fromCell, int toCell, std::vector<GridNode>& path) {
+	// Appends the cells after fromCell up to toCell
+	GridNode from = mGrid->GetNode(fromCell);
+	GridNode to = mGrid->GetNode(toCell);
+	if (std::abs(from.x - to.x) + std::abs(from.y - to.y) == 1) {
+		path.push_back(to);
+		return true;
+	}
+
+	mExpandedCount += SearchCluster(fromCell, mClusters[GetClusterIndex(from.x, from.y)], false, toCell);
+	if (!mContext.IsClosed(toCell)) {
+		return false;
+	}
+
+	size_t first = path.size();
+	for (int index = toCell; index != fromCell; index = mContext.GetNode(index).parent) {
+		path.push_back(mGrid->GetNode(index));
+	}
+	std::reverse(path.begin() + first, path.end());
+	return true;
+}
+
+int ClusterGraph::CalculateDistance(int cellA, int cellB) const {
+	GridNode a = mGrid->GetNode(cellA);
+	GridNode b = mGrid->GetNode(cellB);
+	return GridTopology::GetDistance(GridTopology::CONNECTIVITY_4, a.x - b.x, a.y - b.y);
+}
@@ -0,0 +1,99 @@
+#ifndef __CLUSTERGRAPH_H__
+#define __CLUSTERGRAPH_H__
+
+#include <vector>
+#include "GridNode.h"
+#include "CostGrid.h"
+#include "SearchContext.h"
+
+// Abstract graph for hierarchical pathfinding (HPA*). The grid is split into square
+// clusters, entrances are placed on the walkable stretches of the cluster borders and
+// the entrances of a cluster are joined with edges holding the cost of the shortest
+// path between them inside the cluster. A query searches the small abstract graph
+// first and then refines only the clusters crossed by the abstract path. Paths are
+// close to optimal but, unlike A*, not guaranteed to be the shortest.
+class ClusterGraph {
+public:
+	ClusterGraph();
+
+	void Build(const CostGrid& grid, int clusterSize);
+	// Recomputes the entrances and edges that depend on the cells of one cluster, or of a
+	// range of clusters, rebuilding each border between them once
+	void RebuildCluster(int clusterX, int clusterY) { RebuildClusters(clusterX, clusterY, clusterX, clusterY); }
+	void RebuildClusters(int clusterX0, int clusterY0, int clusterX1, int clusterY1);
+	// Rebuilds the cluster holding a cell after its cost changed
+	void OnCostChanged(int x, int y) { RebuildCluster(x / mClusterSize, y / mClusterSize); }
+	// Repairs the graph after the costs of a rectangle of cells changed. When no cell became
+	// blocked or walkable and the rectangle is away from the cluster borders, the entrances
+	// are the same and only the edges inside the cluster are recomputed.
+	void OnRegionChanged(int x0, int y0, int x1, int y1, bool walkabilityChanged);
+
+	// Returns true and the cells from start to end when a path is found
+	bool FindPath(const GridNode& start, const GridNode& end, std::vector<GridNode>& path);
+
+	bool IsBuilt() const { return mGrid != nullptr; }
+	int GetClusterSize() const { return mClusterSize; }
+	int GetNodeCount() const { return static_cast<int>(mNodes.size() - mFreeNodes.size()); }
+	unsigned int GetExpandedCount() const { return mExpandedCount; }
+
+private:
+	struct Edge {
+		int target;
+		int cost;
+		bool intra;
+	};
+
+	struct AbstractNode {
+		int cell;
+		int cluster;
+		std::vector<Edge> edges;
+	};
+
+	struct Cluster {
+		int x0;
+		int y0;
+		int x1;
+		int y1;
+		std::vector<int> nodes;
+	};
+
+	int GetClusterIndex(int x, int y) const { return (y / mClusterSize) * mClustersX + x / mClusterSize; }
+	bool IsInCluster(int index, const Cluster& cluster) const;
+
+	void BuildBorder(int clusterA, int clusterB, bool horizontal);
+	void ClearBorder(int clusterA, int clusterB);
+	void AddTransition(int cellA, int cellB);
+	int GetOrAddNode(int cell);
+	void CollectNodes(int cluster);
+	void BuildIntraEdges(int cluster);
+
+	// Dijkstra restricted to a cluster. Forward it computes the cost from the source to
+	// every cell, reversed the cost from every cell to the source. Returns the cells expanded.
+	unsigned int SearchCluster(int source, const Cluster& cluster, bool reverse, int target);
+	bool RefineEdge(int fromCell, int toCell, std::vector<GridNode>& path);
+	int CalculateDistance(int cellA, int cellB) const;
+
+	static const int MAX_ENTRANCE_WIDTH;
+
+	const CostGrid* mGrid;
+	int mClusterSize;
+	int mClustersX;
+	int mClustersY;
+
+	std::vector<Cluster> mClusters;
+	std::vector<AbstractNode> mNodes;
+	std::vector<int> mFreeNodes;
+	std::vector<int> mCellNodes;
+
+	// Scratch memory of the cluster searches and the abstract search
+	SearchContext mContext;
+	std::vector<int> mAbstractG;
+	std::vector<int> mAbstractParent;
+	std::vector<bool> mAbstractClosed;
+	std::vector<Edge> mStartEdges;
+	std::vector<Edge> mEndEdges;
+	std::vector<int> mAbstractPath;
+	unsigned int mExpandedCount;
+};
+
+#endif
@@ -0,0 +1,278 @@
+#include <stdafx.h>
+
+#include "ConnectedComponents.h"
+#include <algorithm>
+
+const int ConnectedComponents::NO_COMPONENT = -1;
+
+namespace {
+
+// Splits and opened cells add labels, past this many per cell they are compacted by a build
+const size_t MAX_LABELS_PER_CELL = 2;
+
+}
+
+ConnectedComponents::ConnectedComponents() :
+	mComponentCount(0),
+	mConnectivity(GridTopology::CONNECTIVITY_4),
+	mCornerCutting(GridTopology::CUT_CORNERS_NEVER),
+	mDiagonals(false),
+	mVersion(0),
+	mCellCount(0)
+{
+}
+
+void ConnectedComponents::Clear() {
+	mLabels.clear();
+	mParents.clear();
+	mSizes.clear();
+	mFloodOwners.clear();
+	mComponentCount = 0;
+	mVersion = 0;
+	mCellCount = 0;
+}
+
+void ConnectedComponents::Build(const CostGrid& grid, GridTopology::Connectivity connectivity, GridTopology::CornerCutting cornerCutting) {
+	Clear();
+	mConnectivity = connectivity;
+	mCornerCutting = cornerCutting;
+	mDiagonals = GridTopology::CONNECTIVITY_8 == connectivity && GridTopology::CUT_CORNERS_ALWAYS == cornerCutting;
+	mVersion = grid.GetVersion();
+	mCellCount = grid.GetCellCount();
+	mLabels.assign(mCellCount, NO_COMPONENT);
+	mFloodOwners.assign(mCellCount, -1);
+	for (int cell = 0; cell < mCellCount; ++cell) {
+		if (grid.IsWalkable(cell) && NO_COMPONENT == mLabels[cell]) {
+			Label(grid, cell, AddLabel(0));
+		}
+	}
+}
+
+void ConnectedComponents::OnRegionChanged(const CostGrid& grid, unsigned int previousVersion, int x0, int y0, int x1, int y1) {
+	if (mCellCount != grid.GetCellCount() || mVersion != previousVersion || mParents.size() > MAX_LABELS_PER_CELL * mCellCount) {
+		Build(grid, mConnectivity, mCornerCutting);
+		return;
+	}
+
+	// Blocked cells leave their component
+	std::vector<int> blockedCells;
+	for (int y = y0; y <= y1; ++y) {
+		for (int x = x0; x <= x1; ++x) {
+			int cell = grid.GetIndex(x, y);
+			if (NO_COMPONENT != mLabels[cell] && !grid.IsWalkable(cell)) {
+				int root = Find(mLabels[cell]);
+				if (--mSizes[root] == 0) {
+					--mComponentCount;
+				}
+				mLabels[cell] = NO_COMPONENT;
+				blockedCells.push_back(cell);
+			}
+		}
+	}
+
+	// Opened cells join the components around them
+	int stride = grid.GetStride();
+	for (int y = y0; y <= y1; ++y) {
+		for (int x = x0; x <= x1; ++x) {
+			int cell = grid.GetIndex(x, y);
+			if (NO_COMPONENT != mLabels[cell] || !grid.IsWalkable(cell)) {
+				continue;
+			}
+			mLabels[cell] = AddLabel(1);
+			for (int i = 0; i < GetNeighbourCount(); ++i) {
+				int next = cell + GridTopology::GetOffset(i, stride);
+				if (NO_COMPONENT != mLabels[next]) {
+					Union(mLabels[cell], mLabels[next]);
+				}
+			}
+		}
+	}
+
+	// The cells around the blocked ones are checked for a split, component by component
+	std::vector<std::pair<int, int>> seeds;
+	for (int cell : blockedCells) {
+		for (int i = 0; i < GetNeighbourCount(); ++i) {
+			int next = cell + GridTopology::GetOffset(i, stride);
+			if (NO_COMPONENT != mLabels[next]) {
+				seeds.push_back(std::make_pair(GetComponent(next), next));
+			}
+		}
+	}
+	std::sort(seeds.begin(), seeds.end());
+	seeds.erase(std::unique(seeds.begin(), seeds.end()), seeds.end());
+	std::vector<int> componentSeeds;
+	for (size_t begin = 0, end = 0; begin < seeds.size(); begin = end) {
+		componentSeeds.clear();
+		for (end = begin; end < seeds.size() && seeds[end].first == seeds[begin].first; ++end) {
+			componentSeeds.push_back(seeds[end].second);
+		}
+		// A single cell next to the blocked ones has nothing to be cut from
+		if (componentSeeds.size() > 1) {
+			Split(grid, componentSeeds);
+		}
+	}
+	mVersion = grid.GetVersion();
+}
+
+int ConnectedComponents::FindNearest(const CostGrid& grid, int cell, int component) const {
+	GridNode origin = grid.GetNode(cell);
+	int nearest = -1;
+	int nearestDistance = 0;
+	int maxRadius = std::max(grid.GetCols(), grid.GetRows());
+	for (int radius = 0; radius <= maxRadius; ++radius) {
+		// Every cell of the ring is at least this far
+		if (nearest >= 0 && GridTopology::GetDistance(mConnectivity, radius, 0) >= nearestDistance) {
+			break;
+		}
+		for (int y = origin.y - radius; y <= origin.y + radius; ++y) {
+			int step = y == origin.y - radius || y == origin.y + radius ? 1 : std::max(2 * radius, 1);
+			for (int x = origin.x - radius; x <= origin.x + radius; x += step) {
+				if (!grid.IsInside(x, y) || GetComponent(grid.GetIndex(x, y)) != component) {
+					continue;
+				}
+				int distance = GridTopology::GetDistance(mConnectivity, x - origin.x, y - origin.y);
+				if (nearest < 0 || distance < nearestDistance) {
+					nearest = grid.GetIndex(x, y);
+					nearestDistance = distance;
+				}
+			}
+		}
+	}
+	return nearest;
+}
+
+int ConnectedComponents::AddLabel(int size) {
+	mParents.push_back(static_cast<int>(mParents.size()));
+	mSizes.push_back(size);
+	++mComponentCount;
+	return mParents.back();
+}
+
+int ConnectedComponents::Find(int label) const {
+	while (mParents[label] != label) {
+		label = mParents[label];
+	}
+	return label;
+}
+
+void ConnectedComponents::Union(int labelA, int labelB) {
+	int rootA = Find(labelA);
+	int rootB = Find(labelB);
+	if (rootA == rootB) {
+		return;
+	}
+	if (mSizes[rootA] < mSizes[rootB]) {
+		std::swap(rootA, rootB);
+	}
+	mParents[rootB] = rootA;
+	mSizes[rootA] += mSizes[rootB];
+	--mComponentCount;
+}
+
+void ConnectedComponents::Label(const CostGrid& grid, int cell, int label) {
+	int stride = grid.GetStride();
+	mLabels[cell] = label;
+	mStack.assign(1, cell);
+	while (!mStack.empty()) {
+		int current = mStack.back();
+		mStack.pop_back();
+		++mSizes[label];
+		for (int i = 0; i < GetNeighbourCount(); ++i) {
+			int next = current + GridTopology::GetOffset(i, stride);
+			if (grid.IsWalkable(next) && NO_COMPONENT == mLabels[next]) {
+				mLabels[next] = label;
+				mStack.push_back(next);
+			}
+		}
+	}
+}
+
+void ConnectedComponents::Split(const CostGrid& grid, const std::vector<int>& seeds) {
+	int stride = grid.GetStride();
+	int root = GetComponent(seeds[0]);
+	size_t floodCount = seeds.size();
+	mFloods.resize(std::max(mFloods.size(), floodCount));
+	mGroupParents.resize(floodCount);
+	for (size_t i = 0; i < floodCount; ++i) {
+		mFloods[i].cells.assign(1, seeds[i]);
+		mFloods[i].next = 0;
+		mGroupParents[i] = static_cast<int>(i);
+		mFloodOwners[seeds[i]] = static_cast<int>(i);
+	}
+
+	// Groups of joined floods that are still part of the component, and whether each one grew this turn
+	std::vector<bool> splitGroups(floodCount, false);
+	std::vector<bool> growingGroups(floodCount);
+	size_t groupCount = floodCount;
+	while (groupCount > 1) {
+		for (size_t i = 0; i < floodCount; ++i) {
+			Flood& flood = mFloods[i];
+			if (flood.next == flood.cells.size()) {
+				continue;
+			}
+			int cell = flood.cells[flood.next++];
+			for (int direction = 0; direction < GetNeighbourCount(); ++direction) {
+				int next = cell + GridTopology::GetOffset(direction, stride);
+				if (!grid.IsWalkable(next)) {
+					continue;
+				}
+				int owner = mFloodOwners[next];
+				if (owner < 0) {
+					mFloodOwners[next] = static_cast<int>(i);
+					flood.cells.push_back(next);
+					continue;
+				}
+				int group = FindGroup(static_cast<int>(i));
+				int ownerGroup = FindGroup(owner);
+				if (group != ownerGroup) {
+					mGroupParents[ownerGroup] = group;
+					--groupCount;
+				}
+			}
+		}
+
+		// A group that stopped growing holds all the cells it can reach, which makes it a component
+		std::fill(growingGroups.begin(), growingGroups.end(), false);
+		for (size_t i = 0; i < floodCount; ++i) {
+			if (mFloods[i].next < mFloods[i].cells.size()) {
+				growingGroups[FindGroup(static_cast<int>(i))] = true;
+			}
+		}
+		for (size_t group = 0; group < floodCount && groupCount > 1; ++group) {
+			if (mGroupParents[group] != static_cast<int>(group) || growingGroups[group] || splitGroups[group]) {
+				continue;
+			}
+			int size = 0;
+			for (size_t i = 0; i < floodCount; ++i) {
+				if (FindGroup(static_cast<int>(i)) == static_cast<int>(group)) {
+					size += static_cast<int>(mFloods[i].cells.size());
+				}
+			}
+			int label = AddLabel(size);
+			for (size_t i = 0; i < floodCount; ++i) {
+				if (FindGroup(static_cast<int>(i)) == static_cast<int>(group)) {
+					for (int cell : mFloods[i].cells) {
+						mLabels[cell] = label;
+					}
+				}
+			}
+			mSizes[root] -= size;
+			splitGroups[group] = true;
+			--groupCount;
+		}
+	}
+
+	for (size_t i = 0; i < floodCount; ++i) {
+		for (int cell : mFloods[i].cells) {
+			mFloodOwners[cell] = -1;
+		}
+	}
+}
+
+int ConnectedComponents::FindGroup(int flood) {
+	while (mGroupParents[flood] != flood) {
+		mGroupParents[flood] = mGroupParents[mGroupParents[flood]];
+		flood = mGroupParents[flood];
+	}
+	return flood;
+}
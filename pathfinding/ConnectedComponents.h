@@ -0,0 +1,83 @@
+#ifndef __CONNECTEDCOMPONENTS_H__
+#define __CONNECTEDCOMPONENTS_H__
+
+#include <vector>
+#include "GridNode.h"
+#include "CostGrid.h"
+#include "GridTopology.h"
+
+// Labels the walkable cells of a grid by connected component, so that a query between two
+// components is known to have no path without searching. Moves are symmetric: there is a
+// path from a to b exactly when there is one from b to a.
+//
+// A diagonal move that never or only partly cuts corners passes beside a walkable cell
+// that connects its two cells with straight moves, so these moves give the components of
+// 4 directions. Only diagonal moves that always cut corners connect cells by themselves.
+//
+// Edits are repaired locally. Opened cells merge the components around them with a
+// union-find over the labels. Blocked cells may split a component: floods from the cells
+// around them advance in turns and join when they meet, a group of floods that stops
+// growing is a new component. The floods stop as soon as a single group is left growing,
+// so a split costs the size of the smaller parts rather than of the whole component.
+class ConnectedComponents {
+public:
+	static const int NO_COMPONENT;
+
+	ConnectedComponents();
+
+	void Build(const CostGrid& grid, GridTopology::Connectivity connectivity, GridTopology::CornerCutting cornerCutting);
+	// Repairs the labels after cells of the rectangle changed, given the version of the grid
+	// before the changes. Labels that were not current for it are built again.
+	void OnRegionChanged(const CostGrid& grid, unsigned int previousVersion, int x0, int y0, int x1, int y1);
+	void Clear();
+
+	// True when the labels match the current version of the grid
+	bool IsCurrent(const CostGrid& grid) const { return mCellCount > 0 && mVersion == grid.GetVersion() && mCellCount == grid.GetCellCount(); }
+	// Component of a cell, NO_COMPONENT when it is blocked
+	int GetComponent(int cell) const { return NO_COMPONENT == mLabels[cell] ? NO_COMPONENT : Find(mLabels[cell]); }
+	bool AreConnected(int cellA, int cellB) const { return NO_COMPONENT != mLabels[cellA] && GetComponent(cellA) == GetComponent(cellB); }
+	int GetComponentSize(int cell) const { return NO_COMPONENT == mLabels[cell] ? 0 : mSizes[Find(mLabels[cell])]; }
+	int GetComponentCount() const { return mComponentCount; }
+	// Cell of a component nearest to a cell by the distance of the moves, -1 if there is none
+	int FindNearest(const CostGrid& grid, int cell, int component) const;
+
+private:
+	// Cells reached by one of the floods of a split
+	struct Flood {
+		std::vector<int> cells;
+		size_t next;
+	};
+
+	int AddLabel(int size);
+	// Root of a label, without path compression so that queries stay const. Union by
+	// size keeps the chains logarithmic.
+	int Find(int label) const;
+	void Union(int labelA, int labelB);
+	void Label(const CostGrid& grid, int cell, int label);
+	// Splits off the parts of a component that the floods from the seeds can not join
+	void Split(const CostGrid& grid, const std::vector<int>& seeds);
+	int FindGroup(int flood);
+	int GetNeighbourCount() const { return mDiagonals ? GridTopology::MAX_DIRECTIONS : 4; }
+
+	// Per cell, a label whose root is its component
+	std::vector<int> mLabels;
+	// Per label, its parent and for roots the number of cells of the component
+	std::vector<int> mParents;
+	std::vector<int> mSizes;
+	int mComponentCount;
+
+	GridTopology::Connectivity mConnectivity;
+	GridTopology::CornerCutting mCornerCutting;
+	// Diagonal moves connect cells by themselves
+	bool mDiagonals;
+	unsigned int mVersion;
+	int mCellCount;
+
+	// Scratch memory of the floods, the flood that reached each cell or -1
+	std::vector<int> mFloodOwners;
+	std::vector<Flood> mFloods;
+	std::vector<int> mGroupParents;
+	std::vector<int> mStack;
+};
+
+#endif
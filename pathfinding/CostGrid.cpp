@@ -0,0 +1,82 @@
+#include <stdafx.h>
+
+#include "CostGrid.h"
+
+const CostGrid::Cost CostGrid::BLOCKED = 0xFF;
+const CostGrid::Cost CostGrid::MAX_COST = 0xFE;
+const size_t CostGrid::MAX_CHANGE_LOG = 1 << 16;
+
+CostGrid::CostGrid() :
+	mCols(0),
+	mRows(0),
+	mStride(0),
+	mVersion(0),
+	mChangeLogVersion(0)
+{
+}
+
+void CostGrid::Resize(int cols, int rows) {
+	SetSize(cols, rows);
+	// Every cell starts unreachable, including the border that is never written
+	mCells.assign(static_cast<size_t>(mStride) * (mRows + 2), BLOCKED);
+	mCostCounts.assign(BLOCKED + 1, 0);
+	mCostCounts[BLOCKED] = GetCellCount();
+}
+
+void CostGrid::Assign(int cols, int rows, const Cost* cells) {
+	SetSize(cols, rows);
+	mCells.assign(cells, cells + static_cast<size_t>(mStride) * (mRows + 2));
+	mCostCounts.assign(BLOCKED + 1, 0);
+	for (Cost cost : mCells) {
+		++mCostCounts[cost];
+	}
+}
+
+void CostGrid::SetSize(int cols, int rows) {
+	mCols = cols > 0 ? cols : 0;
+	mRows = rows > 0 ? rows : 0;
+	mStride = mCols + 2;
+	++mVersion;
+	// Nothing built on an older version is valid after a resize
+	mChangeLog.clear();
+	mChangeLogVersion = mVersion;
+}
+
+void CostGrid::SetCost(int x, int y, Cost cost) {
+	if (IsInside(x, y) && mCells[GetIndex(x, y)] != cost) {
+		--mCostCounts[mCells[GetIndex(x, y)]];
+		++mCostCounts[cost];
+		mCells[GetIndex(x, y)] = cost;
+		++mVersion;
+		if (mChangeLog.size() == MAX_CHANGE_LOG) {
+			// Forgets the oldest half of the changes
+			mChangeLog.erase(mChangeLog.begin(), mChangeLog.begin() + MAX_CHANGE_LOG / 2);
+			mChangeLogVersion += MAX_CHANGE_LOG / 2;
+		}
+		mChangeLog.push_back(GetIndex(x, y));
+	}
+}
+
+CostGrid::Cost CostGrid::GetMinCost() const {
+	for (int cost = 0; cost < static_cast<int>(BLOCKED) && cost < static_cast<int>(mCostCounts.size()); ++cost) {
+		if (mCostCounts[cost] > 0) {
+			return static_cast<Cost>(cost);
+		}
+	}
+	return 0;
+}
+
+bool CostGrid::GetChangesSince(unsigned int version, std::vector<int>& cells) const {
+	if (version < mChangeLogVersion || version > mVersion) {
+		return false;
+	}
+	cells.insert(cells.end(), mChangeLog.begin() + (version - mChangeLogVersion), mChangeLog.end());
+	return true;
+}
+
+CostGrid::Cost CostGrid::ToCost(int value) {
+	if (value < 0) {
+		return BLOCKED;
+	}
+	return value > MAX_COST ? MAX_COST : static_cast<Cost>(value);
+}
@@ -0,0 +1,76 @@
+#ifndef __COSTGRID_H__
+#define __COSTGRID_H__
+
+#include <vector>
+#include "GridNode.h"
+
+// Dense row-major grid of terrain costs. The grid is surrounded by a one cell
+// border of blocked cells, so the neighbours of any cell inside the grid can be
+// read through its index without checking the grid limits.
+class CostGrid {
+public:
+	typedef unsigned char Cost;
+
+	static const Cost BLOCKED;
+	static const Cost MAX_COST;
+
+	CostGrid();
+
+	void Resize(int cols, int rows);
+	// Replaces the grid with cells in the layout of GetData(), border included
+	void Assign(int cols, int rows, const Cost* cells);
+	void Clear() { Resize(0, 0); }
+
+	int GetCols() const { return mCols; }
+	int GetRows() const { return mRows; }
+	int GetStride() const { return mStride; }
+	bool IsEmpty() const { return mCols == 0 || mRows == 0; }
+
+	// Number of cells including the border, valid indices are in [0, GetCellCount())
+	int GetCellCount() const { return static_cast<int>(mCells.size()); }
+
+	bool IsInside(int x, int y) const { return x >= 0 && y >= 0 && x < mCols && y < mRows; }
+	bool IsInside(const GridNode& node) const { return IsInside(node.x, node.y); }
+
+	int GetIndex(int x, int y) const { return (y + 1) * mStride + x + 1; }
+	int GetIndex(const GridNode& node) const { return GetIndex(node.x, node.y); }
+	GridNode GetNode(int index) const { return GridNode(index % mStride - 1, index / mStride - 1); }
+
+	Cost GetCost(int index) const { return mCells[index]; }
+	Cost GetCost(int x, int y) const { return mCells[GetIndex(x, y)]; }
+	bool IsWalkable(int index) const { return mCells[index] != BLOCKED; }
+	bool IsWalkable(const GridNode& node) const { return IsInside(node) && IsWalkable(GetIndex(node)); }
+
+	void SetCost(int x, int y, Cost cost);
+	// Lowest cost of a walkable cell, 0 when no cell is walkable. Heuristics scaled by it stay admissible.
+	Cost GetMinCost() const;
+
+	// Incremented every time a cost changes, data computed from the grid can store it to know when it is stale
+	unsigned int GetVersion() const { return mVersion; }
+	// Appends the cells changed after the given version, false if the changes are no longer
+	// known and data built on that version has to be rebuilt from scratch
+	bool GetChangesSince(unsigned int version, std::vector<int>& cells) const;
+
+	// Converts a cost read from the cost files, negative costs are unreachable
+	static Cost ToCost(int value);
+
+	const Cost* GetData() const { return mCells.data(); }
+
+private:
+	void SetSize(int cols, int rows);
+
+	int mCols;
+	int mRows;
+	int mStride;
+	unsigned int mVersion;
+	std::vector<Cost> mCells;
+	// Number of cells of each cost, border included
+	std::vector<int> mCostCounts;
+
+	// Cell changed by each version after mChangeLogVersion
+	static const size_t MAX_CHANGE_LOG;
+	std::vector<int> mChangeLog;
+	unsigned int mChangeLogVersion;
+};
+
+#endif
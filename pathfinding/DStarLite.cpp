@@ -0,0 +1,246 @@
+#include <stdafx.h>
+
+#include "DStarLite.h"
+#include "GridTopology.h"
+#include <algorithm>
+
+const int DStarLite::INFINITE_COST = 0x3FFFFFFF;
+
+namespace {
+
+const int NUM_DIRECTIONS = GridTopology::GetDirectionCount(GridTopology::CONNECTIVITY_4);
+
+}
+
+DStarLite::DStarLite(const CostGrid& grid) :
+	mGrid(grid),
+	mHasSearch(false),
+	mGoalIndex(-1),
+	mKeyModifier(0),
+	mHeuristicScale(1),
+	mVersion(0),
+	mRestarts(0),
+	mRepairs(0),
+	mWalk(0)
+{
+}
+
+bool DStarLite::FindPath(const GridNode& start, const GridNode& end, std::vector<GridNode>& path) {
+	path.clear();
+	mStats.Clear();
+	if (!mGrid.IsWalkable(start) || !mGrid.IsWalkable(end) || start.Compare(end)) {
+		return false;
+	}
+
+	size_t allocatedBytes = mContext.GetAllocatedBytes();
+	// Keys are only lower bounds while the heuristic is, a cheaper cell than any before needs
+	// a new search. Repairs need costs above zero too: neighbours of zero cost give each other
+	// their stale costs and would stay consistent after the path they came from got dearer.
+	bool zeroCosts = 0 == mHeuristicScale && mGrid.GetVersion() != mVersion;
+	if (!mHasSearch || mGrid.GetIndex(end) != mGoalIndex || mContext.GetCellCount() != mGrid.GetCellCount() || mGrid.GetMinCost() < mHeuristicScale || zeroCosts) {
+		mStart = start;
+		Restart(end);
+	} else {
+		// Keys queued before the move are lower bounds of their new keys, the difference is
+		// at most the distance the start moved
+		mKeyModifier += CalculateDistance(mGrid.GetIndex(mStart), mGrid.GetIndex(start));
+		mStart = start;
+		ApplyChanges();
+		++mRepairs;
+	}
+
+	ComputeShortestPath();
+	bool found = BuildPath(path);
+	mStats.allocatedBytes = mContext.GetAllocatedBytes() - allocatedBytes;
+	return found;
+}
+
+void DStarLite::Restart(const GridNode& end) {
+	mContext.Prepare(mGrid.GetCellCount());
+	mContext.ResizeBuffer(mRhs, mGrid.GetCellCount());
+	mContext.ResizeBuffer(mWalkCells, mGrid.GetCellCount());
+	mContext.ResizeBuffer(mWalkStamps, mGrid.GetCellCount());
+	mContext.Reset();
+	mGoalIndex = mGrid.GetIndex(end);
+	mKeyModifier = 0;
+	mHeuristicScale = mGrid.GetMinCost();
+	mVersion = mGrid.GetVersion();
+
+	Touch(mGoalIndex);
+	mRhs[mGoalIndex] = 0;
+	mContext.PushOpen(mGoalIndex, CalculateKey(mGoalIndex));
+	++mStats.generated;
+	mHasSearch = true;
+	++mRestarts;
+}
+
+void DStarLite::ApplyChanges() {
+	if (mGrid.GetVersion() == mVersion) {
+		return;
+	}
+	mChangedCells.clear();
+	if (!mGrid.GetChangesSince(mVersion, mChangedCells)) {
+		Restart(mGrid.GetNode(mGoalIndex));
+		return;
+	}
+	mVersion = mGrid.GetVersion();
+
+	int stride = mGrid.GetStride();
+	for (int cell : mChangedCells) {
+		// Entering the cell costs something else, which changes the lookahead of its
+		// neighbours, and a cell that became blocked or walkable changes its own
+		UpdateNode(cell);
+		for (int i = 0; i < NUM_DIRECTIONS; ++i) {
+			int neighbour = cell + GridTopology::GetOffset(i, stride);
+			if (mGrid.IsWalkable(neighbour)) {
+				UpdateNode(neighbour);
+			}
+		}
+	}
+}
+
+void DStarLite::ComputeShortestPath() {
+	int stride = mGrid.GetStride();
+	int startIndex = mGrid.GetIndex(mStart);
+	Touch(startIndex);
+	while (!mContext.IsOpenListEmpty()) {
+		if (mContext.GetTopKey() >= CalculateKey(startIndex) && GetRhs(startIndex) == GetG(startIndex)) {
+			break;
+		}
+
+		OpenList::Key oldKey = mContext.GetTopKey();
+		int index = mContext.PopOpen();
+		OpenList::Key newKey = CalculateKey(index);
+		if (oldKey < newKey) {
+			// Queued before the start moved
+			mContext.PushOpen(index, newKey);
+			continue;
+		}
+
+		++mStats.expanded;
+		PathNode& pathNode = mContext.GetNode(index);
+		if (pathNode.g > mRhs[index]) {
+			// Overconsistent, its cost is final until something changes
+			pathNode.g = mRhs[index];
+		} else {
+			// Underconsistent, its cost went up and everything that went through it is stale
+			pathNode.g = INFINITE_COST;
+			++mStats.reopened;
+			UpdateNode(index);
+		}
+		for (int i = 0; i < NUM_DIRECTIONS; ++i) {
+			int neighbour = index + GridTopology::GetOffset(i, stride);
+			if (mGrid.IsWalkable(neighbour)) {
+				UpdateNode(neighbour);
+			}
+		}
+		mStats.openListPeak = std::max(mStats.openListPeak, static_cast<unsigned int>(mContext.GetOpenListSize()));
+	}
+}
+
+void DStarLite::UpdateNode(int index) {
+	Touch(index);
+	if (index != mGoalIndex) {
+		// Moving to a neighbour costs the cost of the neighbour
+		int stride = mGrid.GetStride();
+		int rhs = INFINITE_COST;
+		if (mGrid.IsWalkable(index)) {
+			for (int i = 0; i < NUM_DIRECTIONS; ++i) {
+				int neighbour = index + GridTopology::GetOffset(i, stride);
+				int g = GetG(neighbour);
+				if (mGrid.IsWalkable(neighbour) && g < INFINITE_COST) {
+					rhs = std::min(rhs, g + mGrid.GetCost(neighbour));
+				}
+			}
+		}
+		mRhs[index] = rhs;
+	}
+
+	bool consistent = mContext.GetNode(index).g == mRhs[index];
+	if (mContext.IsOpen(index)) {
+		if (consistent) {
+			mContext.RemoveOpen(index);
+		} else {
+			mContext.UpdateOpen(index, CalculateKey(index));
+		}
+	} else if (!consistent) {
+		mContext.PushOpen(index, CalculateKey(index));
+		++mStats.generated;
+	}
+}
+
+bool DStarLite::BuildPath(std::vector<GridNode>& path) {
+	int startIndex = mGrid.GetIndex(mStart);
+	if (GetG(startIndex) >= INFINITE_COST) {
+		return false;
+	}
+
+	// Following the cheapest neighbour from the start is an optimal path once the search
+	// is done: every node that could be cheaper than the start has been made consistent.
+	// Zero cost cells cost the same as their neighbours and could be followed in circles,
+	// so the walk enters each cell once, stamped with the number of the walk, and backs
+	// up from cells whose cheapest neighbours were all entered.
+	++mWalk;
+	int stride = mGrid.GetStride();
+	size_t length = 0;
+	mWalkCells[length++] = startIndex;
+	mWalkStamps[startIndex] = mWalk;
+	while (length > 0 && mWalkCells[length - 1] != mGoalIndex) {
+		int index = mWalkCells[length - 1];
+		int cheapestCost = INFINITE_COST;
+		for (int i = 0; i < NUM_DIRECTIONS; ++i) {
+			int neighbour = index + GridTopology::GetOffset(i, stride);
+			int g = GetG(neighbour);
+			if (mGrid.IsWalkable(neighbour) && g < INFINITE_COST) {
+				cheapestCost = std::min(cheapestCost, g + mGrid.GetCost(neighbour));
+			}
+		}
+		int next = -1;
+		for (int i = 0; i < NUM_DIRECTIONS; ++i) {
+			int neighbour = index + GridTopology::GetOffset(i, stride);
+			int g = GetG(neighbour);
+			if (mGrid.IsWalkable(neighbour) && g < INFINITE_COST && g + mGrid.GetCost(neighbour) == cheapestCost
+				&& mWalkStamps[neighbour] != mWalk && (next < 0 || g < GetG(next))) {
+				next = neighbour;
+			}
+		}
+		if (next < 0) {
+			--length;
+			continue;
+		}
+		mWalkStamps[next] = mWalk;
+		mWalkCells[length++] = next;
+	}
+	if (length == 0) {
+		return false;
+	}
+
+	mContext.ResizeBuffer(path, length);
+	for (size_t i = 0; i < length; ++i) {
+		path[i] = mGrid.GetNode(mWalkCells[i]);
+	}
+	return true;
+}
+
+PathNode& DStarLite::Touch(int index) {
+	bool visited = mContext.IsVisited(index);
+	PathNode& pathNode = mContext.Visit(index);
+	if (!visited) {
+		pathNode.g = INFINITE_COST;
+		mRhs[index] = INFINITE_COST;
+	}
+	return pathNode;
+}
+
+OpenList::Key DStarLite::CalculateKey(int index) {
+	++mStats.heuristicEvaluations;
+	int cost = std::min(GetG(index), GetRhs(index));
+	unsigned long long f = static_cast<unsigned long long>(cost) + CalculateDistance(mGrid.GetIndex(mStart), index) + mKeyModifier;
+	return OpenList::MakeKey(static_cast<unsigned int>(std::min(f, 0xFFFFFFFFULL)), cost);
+}
+
+int DStarLite::CalculateDistance(int indexA, int indexB) const {
+	GridNode a = mGrid.GetNode(indexA);
+	GridNode b = mGrid.GetNode(indexB);
+	return GridTopology::GetDistance(GridTopology::CONNECTIVITY_4, a.x - b.x, a.y - b.y) * mHeuristicScale;
+}
@@ -0,0 +1,74 @@
+#ifndef __DSTARLITE_H__
+#define __DSTARLITE_H__
+
+#include <vector>
+#include "GridNode.h"
+#include "CostGrid.h"
+#include "SearchContext.h"
+#include "SearchStats.h"
+
+// D* Lite (Koenig and Likhachev) over a CostGrid. The search runs backwards from the goal
+// and keeps its nodes between queries, so when the start moves or cells change cost only
+// the nodes whose cost to the goal is affected are expanded again, and the paths cost the
+// same as those of a fresh A* search. Changed cells are read from the change log of the
+// grid. A new goal, or a grid whose changes are no longer known, starts a new search.
+class DStarLite {
+public:
+	static const int INFINITE_COST;
+
+	explicit DStarLite(const CostGrid& grid);
+
+	// Writes the cells from start to end, false if there is no path
+	bool FindPath(const GridNode& start, const GridNode& end, std::vector<GridNode>& path);
+	// Forgets the search, the next query starts from scratch
+	void Clear() { mHasSearch = false; }
+
+	unsigned int GetExpandedCount() const { return mStats.expanded; }
+	// Counters of the last query, without its time
+	const SearchStats& GetStats() const { return mStats; }
+	// Queries that started a new search and queries that repaired the previous one
+	unsigned int GetRestartCount() const { return mRestarts; }
+	unsigned int GetRepairCount() const { return mRepairs; }
+
+private:
+	void Restart(const GridNode& end);
+	void ApplyChanges();
+	void ComputeShortestPath();
+	void UpdateNode(int index);
+	bool BuildPath(std::vector<GridNode>& path);
+
+	int GetG(int index) const { return mContext.IsVisited(index) ? mContext.GetNode(index).g : INFINITE_COST; }
+	int GetRhs(int index) const { return mContext.IsVisited(index) ? mRhs[index] : INFINITE_COST; }
+	// Visits a node the search did not reach yet, with an infinite cost
+	PathNode& Touch(int index);
+	OpenList::Key CalculateKey(int index);
+	int CalculateDistance(int indexA, int indexB) const;
+
+	const CostGrid& mGrid;
+	SearchContext mContext;
+	// One-step lookahead cost of every visited node, the g cost is kept in its PathNode
+	std::vector<int> mRhs;
+
+	bool mHasSearch;
+	GridNode mStart;
+	int mGoalIndex;
+	// Sum of the heuristic distances the start moved, added to new keys instead of
+	// updating the keys already queued
+	unsigned int mKeyModifier;
+	// Lowest cell cost when the search started, the distances of the heuristic are scaled by it
+	int mHeuristicScale;
+	unsigned int mVersion;
+	std::vector<int> mChangedCells;
+
+	SearchStats mStats;
+	unsigned int mRestarts;
+	unsigned int mRepairs;
+
+	// Cells of the walk of BuildPath(), the number of the last walk that entered each cell,
+	// and the number of the current walk
+	std::vector<int> mWalkCells;
+	std::vector<int> mWalkStamps;
+	int mWalk;
+};
+
+#endif
@@ -0,0 +1,260 @@
+#include <stdafx.h>
+
+#include "FlowField.h"
+#include "GridTopology.h"
+#include <algorithm>
+#include <functional>
+
+const unsigned int FlowField::UNREACHABLE = 0xFFFFFFFF;
+const int FlowField::NO_DIRECTION = -1;
+
+namespace {
+
+// Straight moves of GridTopology, direction i is opposite to (i + NUM_DIRECTIONS / 2) % NUM_DIRECTIONS
+const int NUM_DIRECTIONS = GridTopology::GetDirectionCount(GridTopology::CONNECTIVITY_4);
+
+}
+
+FlowField::FlowField() :
+	mGrid(nullptr),
+	mVersion(0)
+{
+}
+
+void FlowField::Build(const CostGrid& grid, const GridNode& goal, IntegrationSweep* sweep) {
+	mGrid = &grid;
+	mGoal = goal;
+	mVersion = grid.GetVersion();
+	mDirections.assign(grid.GetCellCount(), static_cast<signed char>(NO_DIRECTION));
+	mAffected.assign(grid.GetCellCount(), false);
+
+	mIntegration.assign(grid.GetCellCount(), UNREACHABLE);
+	if (sweep) {
+		sweep->Compute(grid, &goal, 1, GridTopology::CONNECTIVITY_4);
+		BuildDirections(sweep->GetField());
+		return;
+	}
+
+	mQueue.clear();
+	if (grid.IsWalkable(goal)) {
+		Push(grid.GetIndex(goal), 0);
+	}
+	Propagate();
+}
+
+void FlowField::BuildDirections(const std::vector<int>& field) {
+	// Points every cell to the first neighbour its integration comes from
+	int stride = mGrid->GetStride();
+	for (int row = 0; row < mGrid->GetRows(); ++row) {
+		int cell = mGrid->GetIndex(0, row);
+		for (int end = cell + mGrid->GetCols(); cell < end; ++cell) {
+			if (field[cell] != IntegrationSweep::UNREACHABLE) {
+				mIntegration[cell] = field[cell];
+			}
+		}
+	}
+	// Cells of zero cost give their neighbours the same integration, two of them could point
+	// to each other. Cells only point to a neighbour of lower integration here, the rest are
+	// pointed breadth first to the cells of zero cost they are reached from. mAffectedCells
+	// is free outside of Repair() and holds the cells that lead to the goal.
+	int goalCell = mGrid->IsInside(mGoal) ? mGrid->GetIndex(mGoal) : -1;
+	mAffectedCells.clear();
+	for (int row = 0; row < mGrid->GetRows(); ++row) {
+		int cell = mGrid->GetIndex(0, row);
+		for (int end = cell + mGrid->GetCols(); cell < end; ++cell) {
+			if (mIntegration[cell] == UNREACHABLE) {
+				continue;
+			}
+			if (cell == goalCell) {
+				mAffectedCells.push_back(cell);
+				continue;
+			}
+			for (int i = 0; i < NUM_DIRECTIONS; ++i) {
+				int next = cell + GridTopology::GetOffset(i, stride);
+				if (mGrid->IsWalkable(next) && mIntegration[next] < mIntegration[cell] && mIntegration[next] + mGrid->GetCost(next) == mIntegration[cell]) {
+					mDirections[cell] = static_cast<signed char>(i);
+					mAffectedCells.push_back(cell);
+					break;
+				}
+			}
+		}
+	}
+	for (size_t i = 0; i < mAffectedCells.size(); ++i) {
+		int cell = mAffectedCells[i];
+		if (mGrid->GetCost(cell) != 0) {
+			continue;
+		}
+		for (int j = 0; j < NUM_DIRECTIONS; ++j) {
+			int next = cell + GridTopology::GetOffset(j, stride);
+			if (next != goalCell && mDirections[next] == NO_DIRECTION && mIntegration[next] == mIntegration[cell] && mGrid->IsWalkable(next)) {
+				mDirections[next] = static_cast<signed char>((j + NUM_DIRECTIONS / 2) % NUM_DIRECTIONS);
+				mAffectedCells.push_back(next);
+			}
+		}
+	}
+	mAffectedCells.clear();
+}
+
+bool FlowField::Update(IntegrationSweep* sweep) {
+	if (mVersion == mGrid->GetVersion()) {
+		return true;
+	}
+
+	mChangedCells.clear();
+	if (!mGrid->GetChangesSince(mVersion, mChangedCells) || mIntegration.size() != static_cast<size_t>(mGrid->GetCellCount())) {
+		Build(*mGrid, mGoal, sweep);
+		return false;
+	}
+	mVersion = mGrid->GetVersion();
+	Repair(mChangedCells);
+	return true;
+}
+
+void FlowField::Push(int cell, unsigned int integration) {
+	mIntegration[cell] = integration;
+	mQueue.push_back(QueueEntry(integration, cell));
+	std::push_heap(mQueue.begin(), mQueue.end(), std::greater<QueueEntry>());
+}
+
+void FlowField::Propagate() {
+	// Reverse Dijkstra: moving from a neighbour into the cell costs the cost of the cell
+	int stride = mGrid->GetStride();
+	while (!mQueue.empty()) {
+		std::pop_heap(mQueue.begin(), mQueue.end(), std::greater<QueueEntry>());
+		QueueEntry entry = mQueue.back();
+		mQueue.pop_back();
+		int cell = entry.second;
+		if (entry.first != mIntegration[cell]) {
+			// Stale entry, the cell was reached later with a smaller cost
+			continue;
+		}
+
+		unsigned int integration = entry.first + mGrid->GetCost(cell);
+		for (int i = 0; i < NUM_DIRECTIONS; ++i) {
+			int next = cell + GridTopology::GetOffset(i, stride);
+			if (mGrid->IsWalkable(next) && integration < mIntegration[next]) {
+				// The neighbour moves in the opposite direction to reach this cell
+				mDirections[next] = static_cast<signed char>((i + NUM_DIRECTIONS / 2) % NUM_DIRECTIONS);
+				Push(next, integration);
+			}
+		}
+	}
+}
+
+void FlowField::Repair(const std::vector<int>& changedCells) {
+	int stride = mGrid->GetStride();
+
+	// Cells whose path to the goal goes through a changed cell lose their value. They are
+	// found walking the direction field backwards from the changed cells.
+	mAffectedCells.clear();
+	for (int cell : changedCells) {
+		if (!mAffected[cell]) {
+			mAffected[cell] = true;
+			mAffectedCells.push_back(cell);
+		}
+	}
+	for (size_t i = 0; i < mAffectedCells.size(); ++i) {
+		int cell = mAffectedCells[i];
+		for (int j = 0; j < NUM_DIRECTIONS; ++j) {
+			int next = cell + GridTopology::GetOffset(j, stride);
+			if (!mAffected[next] && mDirections[next] == (j + NUM_DIRECTIONS / 2) % NUM_DIRECTIONS) {
+				mAffected[next] = true;
+				mAffectedCells.push_back(next);
+			}
+		}
+	}
+
+	int goalCell = mGrid->IsInside(mGoal) ? mGrid->GetIndex(mGoal) : -1;
+	for (int cell : mAffectedCells) {
+		mIntegration[cell] = UNREACHABLE;
+		mDirections[cell] = static_cast<signed char>(NO_DIRECTION);
+	}
+
+	// Seeds the search with the best value each affected cell gets from valid neighbours,
+	// and lets the changed cells offer their value to their neighbours for cost decreases
+	mQueue.clear();
+	if (goalCell >= 0 && mAffected[goalCell] && mGrid->IsWalkable(goalCell)) {
+		Push(goalCell, 0);
+	}
+	for (int cell : mAffectedCells) {
+		if (!mGrid->IsWalkable(cell) || cell == goalCell) {
+			continue;
+		}
+		for (int j = 0; j < NUM_DIRECTIONS; ++j) {
+			int next = cell + GridTopology::GetOffset(j, stride);
+			if (!mAffected[next] && mIntegration[next] != UNREACHABLE) {
+				unsigned int integration = mIntegration[next] + mGrid->GetCost(next);
+				if (integration < mIntegration[cell]) {
+					mDirections[cell] = static_cast<signed char>(j);
+					Push(cell, integration);
+				}
+			}
+		}
+	}
+	for (int cell : changedCells) {
+		if (mIntegration[cell] != UNREACHABLE) {
+			mQueue.push_back(QueueEntry(mIntegration[cell], cell));
+			std::push_heap(mQueue.begin(), mQueue.end(), std::greater<QueueEntry>());
+		}
+	}
+	Propagate();
+
+	for (int cell : mAffectedCells) {
+		mAffected[cell] = false;
+	}
+}
+
+bool FlowField::BuildPath(const GridNode& start, std::vector<GridNode>& path) const {
+	path.clear();
+	if (!mGrid->IsInside(start) || mIntegration[mGrid->GetIndex(start)] == UNREACHABLE) {
+		return false;
+	}
+
+	GridNode node = start;
+	path.push_back(node);
+	for (int direction = GetDirection(node); direction != NO_DIRECTION; direction = GetDirection(node)) {
+		node = GridNode(node.x + GridTopology::dirX[direction], node.y + GridTopology::dirY[direction]);
+		path.push_back(node);
+	}
+	return true;
+}
+
+FlowFieldCache::FlowFieldCache(size_t capacity) :
+	mCapacity(std::max<size_t>(capacity, 1)),
+	mBuildCount(0),
+	mRepairCount(0)
+{
+}
+
+void FlowFieldCache::SetCapacity(size_t capacity) {
+	mCapacity = std::max<size_t>(capacity, 1);
+	while (mFields.size() > mCapacity) {
+		mFields.pop_back();
+	}
+}
+
+const FlowField& FlowFieldCache::GetField(const CostGrid& grid, const GridNode& goal) {
+	for (auto field = mFields.begin(); field != mFields.end(); ++field) {
+		if (field->GetGoal().Compare(goal)) {
+			mFields.splice(mFields.begin(), mFields, field);
+			if (mFields.front().GetVersion() != grid.GetVersion()) {
+				if (mFields.front().Update(&mSweep)) {
+					++mRepairCount;
+				} else {
+					++mBuildCount;
+				}
+			}
+			return mFields.front();
+		}
+	}
+
+	// Reuses the memory of the least recently used field
+	if (mFields.size() >= mCapacity) {
+		mFields.splice(mFields.begin(), mFields, --mFields.end());
+	} else {
+		mFields.push_front(FlowField());
+	}
+	mFields.front().Build(grid, goal, &mSweep);
+	++mBuildCount;
+	return mFields.front();
+}
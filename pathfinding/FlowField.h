@@ -0,0 +1,83 @@
+#ifndef __FLOWFIELD_H__
+#define __FLOWFIELD_H__
+
+#include <list>
+#include <vector>
+#include "GridNode.h"
+#include "CostGrid.h"
+#include "IntegrationSweep.h"
+
+// Integration and direction fields towards one goal, computed with a single reverse
+// Dijkstra over the grid. The integration field holds the cost of the cheapest path
+// from every cell to the goal and the direction field the neighbour to move to, so
+// any number of agents can follow the field with O(1) work per step.
+class FlowField {
+public:
+	static const unsigned int UNREACHABLE;
+	static const int NO_DIRECTION;
+
+	FlowField();
+
+	// Builds the field with a priority queue, or with the sweep kernel when one is given
+	void Build(const CostGrid& grid, const GridNode& goal, IntegrationSweep* sweep = nullptr);
+	// Brings the field up to date with the grid, repairing only the cells affected by the
+	// costs changed since it was built. Returns false if it had to be rebuilt.
+	bool Update(IntegrationSweep* sweep = nullptr);
+
+	bool IsBuilt() const { return mGrid != nullptr; }
+	const GridNode& GetGoal() const { return mGoal; }
+	unsigned int GetVersion() const { return mVersion; }
+
+	unsigned int GetIntegration(int cell) const { return mIntegration[cell]; }
+	unsigned int GetIntegration(const GridNode& node) const { return mGrid->IsInside(node) ? mIntegration[mGrid->GetIndex(node)] : UNREACHABLE; }
+	// Index in GridTopology::dirX/dirY of the move towards the goal, NO_DIRECTION at the goal and unreachable cells
+	int GetDirection(const GridNode& node) const { return mGrid->IsInside(node) ? mDirections[mGrid->GetIndex(node)] : NO_DIRECTION; }
+	// Follows the field from a cell to the goal, false if the goal can not be reached
+	bool BuildPath(const GridNode& start, std::vector<GridNode>& path) const;
+
+	const std::vector<unsigned int>& GetIntegrationField() const { return mIntegration; }
+
+private:
+	typedef std::pair<unsigned int, int> QueueEntry;
+
+	void Propagate();
+	void BuildDirections(const std::vector<int>& field);
+	void Repair(const std::vector<int>& changedCells);
+	void Push(int cell, unsigned int integration);
+
+	const CostGrid* mGrid;
+	GridNode mGoal;
+	unsigned int mVersion;
+	std::vector<unsigned int> mIntegration;
+	std::vector<signed char> mDirections;
+
+	// Scratch memory of the searches
+	std::vector<QueueEntry> mQueue;
+	std::vector<int> mChangedCells;
+	std::vector<int> mAffectedCells;
+	std::vector<bool> mAffected;
+};
+
+// Flow fields of the most recent goals, brought up to date with the grid when requested
+class FlowFieldCache {
+public:
+	explicit FlowFieldCache(size_t capacity);
+
+	const FlowField& GetField(const CostGrid& grid, const GridNode& goal);
+	void Clear() { mFields.clear(); }
+	void SetCapacity(size_t capacity);
+
+	unsigned int GetBuildCount() const { return mBuildCount; }
+	unsigned int GetRepairCount() const { return mRepairCount; }
+
+private:
+	size_t mCapacity;
+	// Most recently used fields first
+	std::list<FlowField> mFields;
+	unsigned int mBuildCount;
+	unsigned int mRepairCount;
+	// Full builds share the scratch memory of one sweep
+	IntegrationSweep mSweep;
+};
+
+#endif
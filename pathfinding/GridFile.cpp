@@ -0,0 +1,333 @@
+#include <stdafx.h>
+
+#include "GridFile.h"
+#include <cstring>
+
+const unsigned int GridFile::FORMAT_VERSION = 1;
+
+namespace {
+
+const char MAGIC[4] = { 'P', 'F', 'G', 'R' };
+// Cells and sections start at multiples of this, so they can be read in place
+const size_t ALIGNMENT = 64;
+
+size_t Align(size_t offset) {
+	return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+bool ReadFile(const char* filename, std::string& content) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file.is_open()) {
+		return false;
+	}
+	file.seekg(0, std::ios::end);
+	content.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0, std::ios::beg);
+	file.read(&content[0], content.size());
+	return true;
+}
+
+void WritePadding(std::ofstream& file, size_t offset) {
+	static const char zeros[ALIGNMENT] = {};
+	file.write(zeros, Align(offset) - offset);
+}
+
+}
+
+// Every field has a fixed size and offset, files are little endian like every target platform
+struct GridFile::Header {
+	char magic[4];
+	unsigned int formatVersion;
+	unsigned int cols;
+	unsigned int rows;
+	unsigned int symbolCount;
+	unsigned int sectionCount;
+	unsigned long long cellsOffset;
+	unsigned long long cellsSize;
+	unsigned long long cellsChecksum;
+};
+
+struct GridFile::SymbolEntry {
+	int cost;
+	char symbol;
+	char padding[3];
+};
+
+struct GridFile::SectionEntry {
+	unsigned int type;
+	unsigned int padding;
+	unsigned long long offset;
+	unsigned long long size;
+	unsigned long long checksum;
+};
+
+static_assert(sizeof(unsigned int) == 4 && sizeof(unsigned long long) == 8, "Grid files need 32 and 64 bit integers");
+
+GridFile::GridFile() :
+	mHeader(nullptr),
+	mSections(nullptr)
+{
+}
+
+bool GridFile::Open(const char* filename, bool verifyChecksums) {
+	Close();
+	if (!mFile.Open(filename) || !Validate(verifyChecksums)) {
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void GridFile::Close() {
+	mFile.Close();
+	mHeader = nullptr;
+	mSections = nullptr;
+	mSymbols.clear();
+}
+
+bool GridFile::Validate(bool verifyChecksums) {
+	const unsigned char* data = mFile.GetData();
+	unsigned long long fileSize = mFile.GetSize();
+	if (fileSize < sizeof(Header)) {
+		return false;
+	}
+	const Header* header = reinterpret_cast<const Header*>(data);
+	if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 || header->formatVersion != FORMAT_VERSION) {
+		return false;
+	}
+
+	unsigned long long tablesSize = header->symbolCount * sizeof(SymbolEntry) + header->sectionCount * sizeof(SectionEntry);
+	unsigned long long stride = header->cols + 2ULL;
+	if (header->cols >= 0x8000 || header->rows >= 0x8000 || sizeof(Header) + tablesSize > fileSize) {
+		return false;
+	}
+	if (header->cellsSize != stride * (header->rows + 2ULL) || header->cellsOffset > fileSize || header->cellsSize > fileSize - header->cellsOffset) {
+		return false;
+	}
+
+	// Searches read the border without checking the grid limits, it has to be blocked
+	const CostGrid::Cost* cells = data + header->cellsOffset;
+	const CostGrid::Cost* lastRow = cells + header->cellsSize - stride;
+	for (unsigned long long x = 0; x < stride; ++x) {
+		if (cells[x] != CostGrid::BLOCKED || lastRow[x] != CostGrid::BLOCKED) {
+			return false;
+		}
+	}
+	for (unsigned long long row = 1; row <= header->rows; ++row) {
+		if (cells[row * stride] != CostGrid::BLOCKED || cells[row * stride + stride - 1] != CostGrid::BLOCKED) {
+			return false;
+		}
+	}
+
+	const SymbolEntry* symbols = reinterpret_cast<const SymbolEntry*>(data + sizeof(Header));
+	const SectionEntry* sections = reinterpret_cast<const SectionEntry*>(symbols + header->symbolCount);
+	for (unsigned int i = 0; i < header->sectionCount; ++i) {
+		if (sections[i].offset > fileSize || sections[i].size > fileSize - sections[i].offset) {
+			return false;
+		}
+	}
+
+	if (verifyChecksums) {
+		if (Checksum(cells, static_cast<size_t>(header->cellsSize)) != header->cellsChecksum) {
+			return false;
+		}
+		for (unsigned int i = 0; i < header->sectionCount; ++i) {
+			if (Checksum(data + sections[i].offset, static_cast<size_t>(sections[i].size)) != sections[i].checksum) {
+				return false;
+			}
+		}
+	}
+
+	mHeader = header;
+	mSections = sections;
+	mSymbols.resize(header->symbolCount);
+	for (unsigned int i = 0; i < header->symbolCount; ++i) {
+		mSymbols[i].symbol = symbols[i].symbol;
+		mSymbols[i].cost = symbols[i].cost;
+	}
+	return true;
+}
+
+int GridFile::GetCols() const {
+	return mHeader ? static_cast<int>(mHeader->cols) : 0;
+}
+
+int GridFile::GetRows() const {
+	return mHeader ? static_cast<int>(mHeader->rows) : 0;
+}
+
+unsigned int GridFile::GetCostSymbolCount() const {
+	return static_cast<unsigned int>(mSymbols.size());
+}
+
+const void* GridFile::GetSection(unsigned int type, size_t& size) const {
+	for (unsigned int i = 0; mHeader && i < mHeader->sectionCount; ++i) {
+		if (mSections[i].type == type) {
+			size = static_cast<size_t>(mSections[i].size);
+			return mFile.GetData() + mSections[i].offset;
+		}
+	}
+	size = 0;
+	return nullptr;
+}
+
+void GridFile::Load(CostGrid& grid) const {
+	if (mHeader) {
+		grid.Assign(GetCols(), GetRows(), mFile.GetData() + mHeader->cellsOffset);
+	}
+}
+
+bool GridFile::Write(const char* filename, const CostGrid& grid, const CostSymbol* symbols, size_t symbolCount, const Section* sections, size_t sectionCount) {
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	Header header = {};
+	memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.formatVersion = FORMAT_VERSION;
+	header.cols = grid.GetCols();
+	header.rows = grid.GetRows();
+	header.symbolCount = static_cast<unsigned int>(symbolCount);
+	header.sectionCount = static_cast<unsigned int>(sectionCount);
+	header.cellsOffset = Align(sizeof(Header) + symbolCount * sizeof(SymbolEntry) + sectionCount * sizeof(SectionEntry));
+	header.cellsSize = grid.GetCellCount();
+	header.cellsChecksum = Checksum(grid.GetData(), grid.GetCellCount());
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	for (size_t i = 0; i < symbolCount; ++i) {
+		SymbolEntry entry = {};
+		entry.symbol = symbols[i].symbol;
+		entry.cost = symbols[i].cost;
+		file.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+	}
+
+	size_t offset = Align(static_cast<size_t>(header.cellsOffset + header.cellsSize));
+	for (size_t i = 0; i < sectionCount; ++i) {
+		SectionEntry entry = {};
+		entry.type = sections[i].type;
+		entry.offset = offset;
+		entry.size = sections[i].size;
+		entry.checksum = Checksum(sections[i].data, sections[i].size);
+		file.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+		offset = Align(offset + sections[i].size);
+	}
+
+	WritePadding(file, sizeof(Header) + symbolCount * sizeof(SymbolEntry) + sectionCount * sizeof(SectionEntry));
+	file.write(reinterpret_cast<const char*>(grid.GetData()), grid.GetCellCount());
+	for (size_t i = 0; i < sectionCount; ++i) {
+		WritePadding(file, static_cast<size_t>(file.tellp()));
+		file.write(static_cast<const char*>(sections[i].data), sections[i].size);
+	}
+	return file.good();
+}
+
+bool GridFile::ReadText(const char* gridFilename, const char* costFilename, CostGrid& grid, std::vector<CostSymbol>* symbols) {
+	std::string costs;
+	std::string cells;
+	if (!ReadFile(costFilename, costs) || !ReadFile(gridFilename, cells)) {
+		return false;
+	}
+
+	// Assuming each cost is represented by only one char
+	CostGrid::Cost symbolCosts[256];
+	memset(symbolCosts, CostGrid::BLOCKED, sizeof(symbolCosts));
+	for (size_t begin = 0; begin < costs.size();) {
+		size_t end = std::min(costs.find('\n', begin), costs.size());
+		size_t separator = costs.find('=', begin);
+		if (separator < end && separator > begin) {
+			CostSymbol symbol;
+			symbol.symbol = costs[begin];
+			symbol.cost = atoi(costs.c_str() + separator + 1);
+			symbolCosts[static_cast<unsigned char>(symbol.symbol)] = CostGrid::ToCost(symbol.cost);
+			if (symbols) {
+				symbols->push_back(symbol);
+			}
+		}
+		begin = end + 1;
+	}
+
+	// Every line is a row, an empty line after the last newline included. Rows are as
+	// wide as the longest line, cells past the end of shorter lines are unreachable.
+	int cols = 0;
+	int rows = 1;
+	int lineLength = 0;
+	for (char cell : cells) {
+		if ('\n' == cell) {
+			++rows;
+			lineLength = 0;
+		} else if ('\r' != cell) {
+			cols = std::max(cols, ++lineLength);
+		}
+	}
+
+	int stride = cols + 2;
+	std::vector<CostGrid::Cost> gridCells(static_cast<size_t>(stride) * (rows + 2), CostGrid::BLOCKED);
+	int index = stride + 1;
+	int rowStart = index;
+	for (char cell : cells) {
+		if ('\n' == cell) {
+			rowStart += stride;
+			index = rowStart;
+		} else if ('\r' != cell) {
+			gridCells[index++] = symbolCosts[static_cast<unsigned char>(cell)];
+		}
+	}
+	grid.Assign(cols, rows, gridCells.data());
+	return true;
+}
+
+bool GridFile::ReadMovingAIMap(const char* filename, CostGrid& grid) {
+	std::ifstream file(filename);
+	if (!file.is_open()) {
+		return false;
+	}
+
+	// Header lines "type octile", "height H", "width W" and "map", then one line per row
+	int cols = -1;
+	int rows = -1;
+	std::string key;
+	while (file >> key && key != "map") {
+		if (key == "height") {
+			file >> rows;
+		} else if (key == "width") {
+			file >> cols;
+		} else {
+			file >> key;
+		}
+	}
+	if (key != "map" || cols < 0 || rows < 0) {
+		return false;
+	}
+
+	int stride = cols + 2;
+	std::vector<CostGrid::Cost> cells(static_cast<size_t>(stride) * (rows + 2), CostGrid::BLOCKED);
+	std::string line;
+	for (int y = 0; y < rows && file >> line; ++y) {
+		for (int x = 0; x < cols && x < static_cast<int>(line.size()); ++x) {
+			char cell = line[x];
+			if ('.' == cell || 'G' == cell || 'S' == cell) {
+				cells[(y + 1) * stride + x + 1] = 1;
+			}
+		}
+	}
+	grid.Assign(cols, rows, cells.data());
+	return true;
+}
+
+unsigned long long GridFile::Checksum(const void* data, size_t size) {
+	// FNV-1a over 64 bit words
+	const unsigned long long PRIME = 1099511628211ULL;
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	unsigned long long checksum = 14695981039346656037ULL ^ size;
+	size_t i = 0;
+	for (; i + sizeof(unsigned long long) <= size; i += sizeof(unsigned long long)) {
+		unsigned long long word;
+		memcpy(&word, bytes + i, sizeof(word));
+		checksum = (checksum ^ word) * PRIME;
+	}
+	for (; i < size; ++i) {
+		checksum = (checksum ^ bytes[i]) * PRIME;
+	}
+	return checksum;
+}
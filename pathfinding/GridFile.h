@@ -0,0 +1,76 @@
+#ifndef __GRIDFILE_H__
+#define __GRIDFILE_H__
+
+#include <vector>
+#include "CostGrid.h"
+#include "MappedFile.h"
+
+// Grid files in three formats:
+//
+// - The text pair read by the sample: a grid file with one character per cell and a cost
+//   file mapping characters to costs with lines like "A=1". Characters without a cost and
+//   negative costs are unreachable.
+// - Maps of the Moving AI benchmark sets (https://movingai.com/benchmarks), where '.', 'G'
+//   and 'S' are walkable cells of cost 1 and any other character is blocked.
+// - A binary format that is memory mapped and used as it is, without parsing. It holds a
+//   header, the cost table of the text files it came from, a table of optional sections
+//   with data precomputed from the grid, and the cost bytes of every cell in the row-major
+//   layout of CostGrid, border included, so loading them is a single copy. The cells and
+//   every section have a checksum.
+class GridFile {
+public:
+	static const unsigned int FORMAT_VERSION;
+
+	// Character of the text grid and its cost
+	struct CostSymbol {
+		char symbol;
+		int cost;
+	};
+
+	// Data stored with the grid, identified by a type known to the code reading it
+	struct Section {
+		unsigned int type;
+		const void* data;
+		size_t size;
+	};
+
+	GridFile();
+
+	// Maps a binary grid file and checks its header, false if the file is not valid
+	bool Open(const char* filename, bool verifyChecksums = true);
+	void Close();
+	bool IsOpen() const { return mHeader != nullptr; }
+
+	int GetCols() const;
+	int GetRows() const;
+	unsigned int GetCostSymbolCount() const;
+	const CostSymbol* GetCostSymbols() const { return mSymbols.data(); }
+	// Section data inside the mapping, nullptr if the file has no section of the type
+	const void* GetSection(unsigned int type, size_t& size) const;
+
+	// Copies the cells of the open file to a grid
+	void Load(CostGrid& grid) const;
+
+	static bool Write(const char* filename, const CostGrid& grid, const CostSymbol* symbols, size_t symbolCount, const Section* sections = nullptr, size_t sectionCount = 0);
+	// Reads the text pair, the symbols of the cost file are appended to the vector if given
+	static bool ReadText(const char* gridFilename, const char* costFilename, CostGrid& grid, std::vector<CostSymbol>* symbols = nullptr);
+
+	// Reads a .map file of the Moving AI benchmarks
+	static bool ReadMovingAIMap(const char* filename, CostGrid& grid);
+
+	static unsigned long long Checksum(const void* data, size_t size);
+
+private:
+	struct Header;
+	struct SymbolEntry;
+	struct SectionEntry;
+
+	bool Validate(bool verifyChecksums);
+
+	MappedFile mFile;
+	const Header* mHeader;
+	const SectionEntry* mSections;
+	std::vector<CostSymbol> mSymbols;
+};
+
+#endif
@@ -0,0 +1,9 @@
+#include <stdafx.h>
+
+#include "GridTopology.h"
+
+const int GridTopology::dirX[MAX_DIRECTIONS] = { 1, 0, -1,  0, 1, -1, -1,  1 };
+const int GridTopology::dirY[MAX_DIRECTIONS] = { 0, 1,  0, -1, 1,  1, -1, -1 };
+
+const int GridTopology::STRAIGHT_WEIGHT;
+const int GridTopology::DIAGONAL_WEIGHT;
@@ -0,0 +1,61 @@
+#ifndef __GRIDTOPOLOGY_H__
+#define __GRIDTOPOLOGY_H__
+
+#include <algorithm>
+#include <cstdlib>
+
+// Moves allowed between the cells of a grid and their weights. Move costs are the cost
+// of the entered cell times the weight of the move, in fixed point so that diagonal moves
+// cost about sqrt(2) straight moves without floating point: 99 / 70 = 1.4143.
+class GridTopology {
+public:
+	enum Connectivity {
+		CONNECTIVITY_4 = 4,
+		CONNECTIVITY_8 = 8
+	};
+
+	// When a diagonal move may pass beside blocked cells: never, when only one of the two
+	// cells beside it is blocked, or always, squeezing between two blocked cells
+	enum CornerCutting {
+		CUT_CORNERS_NEVER,
+		CUT_CORNERS_SINGLE,
+		CUT_CORNERS_ALWAYS
+	};
+
+	static const int MAX_DIRECTIONS = 8;
+	// Straight directions first, the diagonal direction i + 4 lies between straight directions i and (i + 1) % 4
+	static const int dirX[MAX_DIRECTIONS];
+	static const int dirY[MAX_DIRECTIONS];
+
+	// Known at compile time so that specialized searches fold them into the move costs
+	static const int STRAIGHT_WEIGHT = 70;
+	static const int DIAGONAL_WEIGHT = 99;
+
+	static int GetDirectionCount(Connectivity connectivity) { return connectivity; }
+	static bool IsDiagonal(int direction) { return direction >= 4; }
+	// Weight of a move, straight moves of a 4-connected grid cost exactly the cell cost
+	static int GetWeight(Connectivity connectivity, int direction) {
+		return CONNECTIVITY_4 == connectivity ? 1 : (IsDiagonal(direction) ? DIAGONAL_WEIGHT : STRAIGHT_WEIGHT);
+	}
+	// Offset of a direction in the index space of a grid
+	static int GetOffset(int direction, int stride) { return dirY[direction] * stride + dirX[direction]; }
+	// Straight directions on both sides of a diagonal direction
+	static int GetFirstSide(int direction) { return direction - 4; }
+	static int GetSecondSide(int direction) { return (direction - 3) % 4; }
+	static bool CanCutCorner(CornerCutting cornerCutting, bool firstWalkable, bool secondWalkable) {
+		return CUT_CORNERS_ALWAYS == cornerCutting || (firstWalkable && secondWalkable) || (CUT_CORNERS_SINGLE == cornerCutting && (firstWalkable || secondWalkable));
+	}
+	// Weight of the cheapest moves across a distance with every cell costing 1: Manhattan
+	// distance on a 4-connected grid and octile distance on an 8-connected grid
+	static int GetDistance(Connectivity connectivity, int distanceX, int distanceY) {
+		distanceX = std::abs(distanceX);
+		distanceY = std::abs(distanceY);
+		if (CONNECTIVITY_4 == connectivity) {
+			return distanceX + distanceY;
+		}
+		int diagonal = std::min(distanceX, distanceY);
+		return diagonal * DIAGONAL_WEIGHT + (std::max(distanceX, distanceY) - diagonal) * STRAIGHT_WEIGHT;
+	}
+};
+
+#endif
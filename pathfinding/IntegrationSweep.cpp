@@ -0,0 +1,225 @@
+#include <stdafx.h>
+
+#include "IntegrationSweep.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SWEEP_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+#define SWEEP_SSE2
+#endif
+
+// Values stay below 2^30 so the sum of two of them, or'ed with BLOCKED_BIT, never overflows
+const int IntegrationSweep::UNREACHABLE = 0x3FFFFFFF;
+
+namespace {
+
+const int BLOCKED_BIT = 0x40000000;
+
+#if defined(SWEEP_AVX2)
+
+typedef __m256i Lanes;
+const int LANE_COUNT = 8;
+inline Lanes Load(const int* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline void Store(int* p, Lanes value) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), value); }
+inline Lanes Add(Lanes a, Lanes b) { return _mm256_add_epi32(a, b); }
+inline Lanes Or(Lanes a, Lanes b) { return _mm256_or_si256(a, b); }
+inline Lanes Xor(Lanes a, Lanes b) { return _mm256_xor_si256(a, b); }
+inline Lanes Min(Lanes a, Lanes b) { return _mm256_min_epi32(a, b); }
+inline Lanes Zero() { return _mm256_setzero_si256(); }
+inline bool IsZero(Lanes value) { return _mm256_testz_si256(value, value) != 0; }
+
+#elif defined(SWEEP_SSE2)
+
+typedef __m128i Lanes;
+const int LANE_COUNT = 4;
+inline Lanes Load(const int* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline void Store(int* p, Lanes value) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), value); }
+inline Lanes Add(Lanes a, Lanes b) { return _mm_add_epi32(a, b); }
+inline Lanes Or(Lanes a, Lanes b) { return _mm_or_si128(a, b); }
+inline Lanes Xor(Lanes a, Lanes b) { return _mm_xor_si128(a, b); }
+inline Lanes Min(Lanes a, Lanes b) {
+#if defined(__SSE4_1__)
+	return _mm_min_epi32(a, b);
+#else
+	Lanes greater = _mm_cmpgt_epi32(a, b);
+	return _mm_or_si128(_mm_and_si128(greater, b), _mm_andnot_si128(greater, a));
+#endif
+}
+inline Lanes Zero() { return _mm_setzero_si128(); }
+inline bool IsZero(Lanes value) { return _mm_movemask_epi8(_mm_cmpeq_epi32(value, _mm_setzero_si128())) == 0xFFFF; }
+
+#endif
+
+}
+
+IntegrationSweep::IntegrationSweep() :
+	mCols(0),
+	mStride(0),
+	mDiagonals(false),
+	mTick(0)
+{
+}
+
+const char* IntegrationSweep::GetInstructionSet() {
+#if defined(SWEEP_AVX2)
+	return "avx2";
+#elif defined(SWEEP_SSE2)
+	return "sse2";
+#else
+	return "scalar";
+#endif
+}
+
+void IntegrationSweep::Prepare(const CostGrid& grid, GridTopology::Connectivity connectivity) {
+	mCols = grid.GetCols();
+	mStride = grid.GetStride();
+	mDiagonals = GridTopology::CONNECTIVITY_8 == connectivity;
+
+	int straightWeight = GridTopology::GetWeight(connectivity, 0);
+	int diagonalWeight = GridTopology::GetWeight(connectivity, GridTopology::MAX_DIRECTIONS - 1);
+	int cellCount = grid.GetCellCount();
+	mStraightCosts.resize(cellCount);
+	mDiagonalCosts.resize(cellCount);
+	mBlockedBits.resize(cellCount);
+	for (int i = 0; i < cellCount; ++i) {
+		bool walkable = grid.IsWalkable(i);
+		mStraightCosts[i] = walkable ? grid.GetCost(i) * straightWeight : UNREACHABLE;
+		mDiagonalCosts[i] = walkable ? grid.GetCost(i) * diagonalWeight : UNREACHABLE;
+		mBlockedBits[i] = walkable ? 0 : BLOCKED_BIT;
+	}
+}
+
+unsigned int IntegrationSweep::Compute(const CostGrid& grid, const GridNode* goals, size_t goalCount, GridTopology::Connectivity connectivity) {
+	Prepare(grid, connectivity);
+	mField.assign(grid.GetCellCount(), UNREACHABLE);
+	for (size_t i = 0; i < goalCount; ++i) {
+		if (grid.IsWalkable(goals[i])) {
+			mField[grid.GetIndex(goals[i])] = 0;
+		}
+	}
+
+	// Rows are only relaxed from a neighbour row that changed since they last read it, so
+	// late iterations only touch the few rows still changing
+	int rows = grid.GetRows();
+	mRowChanged.assign(rows + 2, 0);
+	mPulledFromAbove.assign(rows + 2, 0);
+	mPulledFromBelow.assign(rows + 2, 0);
+	mRelaxedAlong.assign(rows + 2, 0);
+	mTick = 1;
+	for (size_t i = 0; i < goalCount; ++i) {
+		if (grid.IsWalkable(goals[i])) {
+			mRowChanged[goals[i].y + 1] = mTick;
+		}
+	}
+
+	unsigned int iterations = 0;
+	bool changed = grid.GetCols() > 0;
+	while (changed) {
+		++iterations;
+		changed = false;
+		for (int row = 1; row <= rows; ++row) {
+			changed |= SweepRow(mField.data(), row, -1);
+		}
+		for (int row = rows; row >= 1; --row) {
+			changed |= SweepRow(mField.data(), row, 1);
+		}
+	}
+	return iterations;
+}
+
+bool IntegrationSweep::SweepRow(int* field, int row, int sourceRow) {
+	// Relaxes the row from the neighbour row and then along itself, so a downwards pass
+	// followed by an upwards one settles every path that does not turn back vertically
+	std::vector<unsigned int>& pulled = sourceRow < 0 ? mPulledFromAbove : mPulledFromBelow;
+	int source = row + sourceRow;
+	bool changed = false;
+	if (mRowChanged[source] > pulled[row]) {
+		if (RelaxRow(field, row, sourceRow * mStride)) {
+			mRowChanged[row] = ++mTick;
+			changed = true;
+		}
+		pulled[row] = mTick;
+	}
+	if (mRowChanged[row] > mRelaxedAlong[row]) {
+		bool rowChanged = RelaxAlongRow(field, row, 1);
+		rowChanged |= RelaxAlongRow(field, row, -1);
+		if (rowChanged) {
+			mRowChanged[row] = ++mTick;
+			changed = true;
+		}
+		mRelaxedAlong[row] = mTick;
+	}
+	return changed;
+}
+
+bool IntegrationSweep::RelaxRow(int* field, int row, int sourceOffset) const {
+	const int* straight = mStraightCosts.data();
+	const int* diagonal = mDiagonalCosts.data();
+	const int* blocked = mBlockedBits.data();
+	int begin = row * mStride + 1;
+	int end = begin + mCols;
+	int i = begin;
+
+#if defined(SWEEP_AVX2) || defined(SWEEP_SSE2)
+	Lanes changes = Zero();
+	for (; i + LANE_COUNT <= end; i += LANE_COUNT) {
+		int source = i + sourceOffset;
+		Lanes current = Load(field + i);
+		Lanes candidate = Add(Load(field + source), Load(straight + source));
+		if (mDiagonals) {
+			// A diagonal move needs both cells beside it walkable
+			Lanes sourceBlocked = Load(blocked + source);
+			Lanes left = Or(Add(Load(field + source - 1), Load(diagonal + source - 1)), Or(Load(blocked + i - 1), sourceBlocked));
+			Lanes right = Or(Add(Load(field + source + 1), Load(diagonal + source + 1)), Or(Load(blocked + i + 1), sourceBlocked));
+			candidate = Min(candidate, Min(left, right));
+		}
+		Lanes relaxed = Min(current, Or(candidate, Load(blocked + i)));
+		changes = Or(changes, Xor(current, relaxed));
+		Store(field + i, relaxed);
+	}
+	bool changed = !IsZero(changes);
+#else
+	bool changed = false;
+#endif
+
+	for (; i < end; ++i) {
+		int source = i + sourceOffset;
+		int candidate = field[source] + straight[source];
+		if (mDiagonals) {
+			candidate = std::min(candidate, (field[source - 1] + diagonal[source - 1]) | blocked[i - 1] | blocked[source]);
+			candidate = std::min(candidate, (field[source + 1] + diagonal[source + 1]) | blocked[i + 1] | blocked[source]);
+		}
+		candidate |= blocked[i];
+		if (candidate < field[i]) {
+			field[i] = candidate;
+			changed = true;
+		}
+	}
+	return changed;
+}
+
+bool IntegrationSweep::RelaxAlongRow(int* field, int row, int step) const {
+	// Each cell depends on the one just relaxed, this pass stays scalar
+	const int* straight = mStraightCosts.data();
+	const int* blocked = mBlockedBits.data();
+	int first = row * mStride + (step > 0 ? 2 : mCols - 1);
+	int end = row * mStride + (step > 0 ? mCols + 1 : 0);
+	bool changed = false;
+	int previous = field[first - step] + straight[first - step];
+	for (int i = first; i != end; i += step) {
+		int candidate = previous | blocked[i];
+		int value = field[i];
+		if (candidate < value) {
+			value = candidate;
+			field[i] = value;
+			changed = true;
+		}
+		previous = value + straight[i];
+	}
+	return changed;
+}
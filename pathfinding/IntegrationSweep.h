@@ -0,0 +1,59 @@
+#ifndef __INTEGRATIONSWEEP_H__
+#define __INTEGRATIONSWEEP_H__
+
+#include <vector>
+#include "GridNode.h"
+#include "CostGrid.h"
+#include "GridTopology.h"
+
+// Computes integration fields over the whole grid with row sweeps instead of a priority
+// queue. A downwards pass relaxes each row from the row above, with SSE2 or AVX2 lanes as
+// the cells of a row do not depend on each other, and then along the row in both
+// directions; an upwards pass does the same from the row below. Passes repeat until
+// nothing changes, which gives the same costs as Dijkstra with sequential memory accesses
+// and no heap. Each iteration settles the paths that do not turn back vertically, and
+// rows are skipped when the rows they read did not change since they last read them.
+//
+// Fields use the index layout of the grid. Values are the cost to reach the nearest goal
+// in the units of GridTopology::GetWeight(), costs that do not fit in UNREACHABLE are
+// treated as unreachable. Diagonal moves can not cut the corner of a blocked cell.
+class IntegrationSweep {
+public:
+	static const int UNREACHABLE;
+
+	IntegrationSweep();
+
+	// Computes the field of the nearest of the goals, returns the number of iterations needed to converge
+	unsigned int Compute(const CostGrid& grid, const GridNode* goals, size_t goalCount, GridTopology::Connectivity connectivity);
+	// Field of the last Compute(), overwritten by the next one
+	const std::vector<int>& GetField() const { return mField; }
+
+	// Instruction set the kernel was built with: "avx2", "sse2" or "scalar"
+	static const char* GetInstructionSet();
+
+private:
+	void Prepare(const CostGrid& grid, GridTopology::Connectivity connectivity);
+	bool SweepRow(int* field, int row, int sourceRow);
+	// Relaxes the interior cells of a row from the row at sourceOffset, true if any cell changed
+	bool RelaxRow(int* field, int row, int sourceOffset) const;
+	bool RelaxAlongRow(int* field, int row, int step) const;
+
+	std::vector<int> mField;
+	int mCols;
+	int mStride;
+	bool mDiagonals;
+	// Weighted cost of entering each cell with a straight and a diagonal move, UNREACHABLE if blocked
+	std::vector<int> mStraightCosts;
+	std::vector<int> mDiagonalCosts;
+	// BLOCKED_BIT for blocked cells, or'ed into the moves that would enter or cut them
+	std::vector<int> mBlockedBits;
+
+	// Per row, the tick of its last change and of its last reads of each neighbour row and itself
+	std::vector<unsigned int> mRowChanged;
+	std::vector<unsigned int> mPulledFromAbove;
+	std::vector<unsigned int> mPulledFromBelow;
+	std::vector<unsigned int> mRelaxedAlong;
+	unsigned int mTick;
+};
+
+#endif
@@ -0,0 +1,119 @@
+#include <stdafx.h>
+
+#include "JumpPointSearch.h"
+
+namespace {
+
+const int NUM_DIRECTIONS = GridTopology::GetDirectionCount(GridTopology::CONNECTIVITY_4);
+
+}
+
+JumpPointSearch::JumpPointSearch(const CostGrid& grid, SearchContext& context) :
+	AStarSearch(grid, context)
+{
+}
+
+int JumpPointSearch::GetSuccessors(int index, int* successors, int* costs) const {
+	if (GridTopology::CONNECTIVITY_4 != mConnectivity) {
+		return AStarSearch::GetSuccessors(index, successors, costs);
+	}
+
+	int numSuccessors = 0;
+	int parent = mContext.GetNode(index).parent;
+	if (parent < 0 || IsCostBoundary(index)) {
+		// The start node and the nodes next to a cost change are expanded in every direction
+		for (int i = 0; i < NUM_DIRECTIONS; ++i) {
+			int cost = 0;
+			int jumpPoint = Jump(index, GridTopology::dirX[i], GridTopology::dirY[i], cost);
+			if (jumpPoint >= 0) {
+				successors[numSuccessors] = jumpPoint;
+				costs[numSuccessors++] = cost;
+			}
+		}
+	} else {
+		// Only going back to the parent is pruned, forced neighbours are already covered
+		// by the two directions perpendicular to the movement
+		GridNode node = mGrid.GetNode(index);
+		GridNode parentNode = mGrid.GetNode(parent);
+		int moveX = (node.x > parentNode.x) - (node.x < parentNode.x);
+		int moveY = (node.y > parentNode.y) - (node.y < parentNode.y);
+		for (int i = 0; i < NUM_DIRECTIONS; ++i) {
+			if (GridTopology::dirX[i] == -moveX && GridTopology::dirY[i] == -moveY) {
+				continue;
+			}
+			int cost = 0;
+			int jumpPoint = Jump(index, GridTopology::dirX[i], GridTopology::dirY[i], cost);
+			if (jumpPoint >= 0) {
+				successors[numSuccessors] = jumpPoint;
+				costs[numSuccessors++] = cost;
+			}
+		}
+	}
+	return numSuccessors;
+}
+
+int JumpPointSearch::Jump(int index, int dirX, int dirY, int& cost) const {
+	// Returns the next jump point in the direction and the cost of the cells entered to reach it
+	int step = dirY * mGrid.GetStride() + dirX;
+	int next = index;
+	while (true) {
+		next += step;
+		if (!mGrid.IsWalkable(next)) {
+			return -1;
+		}
+		cost += mGrid.GetCost(next);
+
+		if (next == mEndIndex || IsCostBoundary(next)) {
+			return next;
+		}
+		if (dirX != 0) {
+			if (IsForcedHorizontal(next, dirX)) {
+				return next;
+			}
+		} else if (IsForcedVertical(next, dirY) || ScanHorizontal(next, 1) || ScanHorizontal(next, -1)) {
+			// When moving vertically, a jump point found horizontally makes this cell a jump point
+			return next;
+		}
+	}
+}
+
+bool JumpPointSearch::ScanHorizontal(int index, int dirX) const {
+	int next = index;
+	while (true) {
+		next += dirX;
+		if (!mGrid.IsWalkable(next)) {
+			return false;
+		}
+		if (next == mEndIndex || IsCostBoundary(next) || IsForcedHorizontal(next, dirX)) {
+			return true;
+		}
+	}
+}
+
+bool JumpPointSearch::IsForcedHorizontal(int index, int dirX) const {
+	// A neighbour above or below becomes reachable only through this cell when the cell
+	// behind it is not part of the same terrain. Cells with another cost count as obstacles.
+	CostGrid::Cost cost = mGrid.GetCost(index);
+	int stride = mGrid.GetStride();
+	return (HasCost(index - stride, cost) && !HasCost(index - stride - dirX, cost))
+		|| (HasCost(index + stride, cost) && !HasCost(index + stride - dirX, cost));
+}
+
+bool JumpPointSearch::IsForcedVertical(int index, int dirY) const {
+	CostGrid::Cost cost = mGrid.GetCost(index);
+	int back = -dirY * mGrid.GetStride();
+	return (HasCost(index - 1, cost) && !HasCost(index - 1 + back, cost))
+		|| (HasCost(index + 1, cost) && !HasCost(index + 1 + back, cost));
+}
+
+bool JumpPointSearch::IsCostBoundary(int index) const {
+	// True if a walkable neighbour has a different terrain cost
+	CostGrid::Cost cost = mGrid.GetCost(index);
+	for (int i = 0; i < NUM_DIRECTIONS; ++i) {
+		int next = index + GridTopology::GetOffset(i, mGrid.GetStride());
+		if (mGrid.IsWalkable(next) && !HasCost(next, cost)) {
+			return true;
+		}
+	}
+	return false;
+}
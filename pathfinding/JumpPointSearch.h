@@ -0,0 +1,28 @@
+#ifndef __JUMPPOINTSEARCH_H__
+#define __JUMPPOINTSEARCH_H__
+
+#include "AStarSearch.h"
+
+// Jump Point Search for the 4-connected grid. Instead of adding every neighbour to the
+// open list, the search jumps in straight lines over cells of the same terrain and only
+// stops at jump points: the goal, cells with forced neighbours and cells next to a
+// terrain cost change. Cells next to a cost change are expanded in every direction,
+// which keeps the paths optimal on weighted grids. The jumps only follow straight moves,
+// on an 8-connected grid every neighbour is a successor as in A*.
+class JumpPointSearch : public AStarSearch {
+public:
+	JumpPointSearch(const CostGrid& grid, SearchContext& context);
+
+protected:
+	virtual int GetSuccessors(int index, int* successors, int* costs) const;
+
+private:
+	int Jump(int index, int dirX, int dirY, int& cost) const;
+	bool ScanHorizontal(int index, int dirX) const;
+	bool IsForcedHorizontal(int index, int dirX) const;
+	bool IsForcedVertical(int index, int dirY) const;
+	bool IsCostBoundary(int index) const;
+	bool HasCost(int index, CostGrid::Cost cost) const { return mGrid.GetCost(index) == cost; }
+};
+
+#endif
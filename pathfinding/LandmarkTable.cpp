@@ -0,0 +1,237 @@
+#include <stdafx.h>
+
+#include "LandmarkTable.h"
+#include <algorithm>
+#include <random>
+
+const unsigned short LandmarkTable::UNREACHABLE;
+const int LandmarkTable::MAX_LANDMARKS;
+
+namespace {
+
+// Walkable cells tried as the seed of the selection, and as the root of an avoid tree
+const int SEED_TRIES = 4;
+const int ROOT_TRIES = 16;
+
+}
+
+LandmarkTable::LandmarkTable() :
+	mColumnCount(0),
+	mConnectivity(GridTopology::CONNECTIVITY_4),
+	mSelection(SELECT_FARTHEST),
+	mVersion(0),
+	mCellCount(0)
+{
+}
+
+void LandmarkTable::Clear() {
+	mLandmarks.clear();
+	mScales.clear();
+	mDistances.clear();
+	mColumnCount = 0;
+	mVersion = 0;
+	mCellCount = 0;
+}
+
+void LandmarkTable::Build(const CostGrid& grid, GridTopology::Connectivity connectivity, int landmarkCount, Selection selection, ThreadPool& threadPool) {
+	Clear();
+	mConnectivity = connectivity;
+	mSelection = selection;
+	mVersion = grid.GetVersion();
+	mCellCount = grid.GetCellCount();
+
+	std::vector<int> walkableCells;
+	for (int cell = 0; cell < mCellCount; ++cell) {
+		if (grid.IsWalkable(cell)) {
+			walkableCells.push_back(cell);
+		}
+	}
+	landmarkCount = std::min(landmarkCount, MAX_LANDMARKS);
+	if (walkableCells.empty() || landmarkCount <= 0) {
+		return;
+	}
+
+	// Landmarks are placed in the region reached from the seed, the largest one found. Cells
+	// out of it are left to the distance heuristic instead of spending landmarks on small
+	// enclosed pockets.
+	std::mt19937 random;
+	IntegrationSweep sweep;
+	std::vector<int> nearest;
+	size_t bestReached = 0;
+	for (int i = 0; i < SEED_TRIES && bestReached * 2 <= walkableCells.size(); ++i) {
+		GridNode seed = grid.GetNode(walkableCells[random() % walkableCells.size()]);
+		sweep.Compute(grid, &seed, 1, connectivity);
+		const std::vector<int>& field = sweep.GetField();
+		size_t reached = std::count_if(field.begin(), field.end(), [](int cost) { return cost < IntegrationSweep::UNREACHABLE; });
+		if (reached > bestReached) {
+			bestReached = reached;
+			nearest = field;
+		}
+	}
+
+	mColumnCount = landmarkCount;
+	mScales.assign(landmarkCount, 1);
+	mDistances.assign(static_cast<size_t>(mCellCount) * landmarkCount, UNREACHABLE);
+	IntegrationSweep rootSweep;
+	int root = -1;
+	for (int i = 0; i < landmarkCount; ++i) {
+		// The first landmark is the cell farthest from the seed
+		int landmark = root >= 0 ? SelectAvoid(grid, root, rootSweep.GetField()) : -1;
+		if (landmark < 0) {
+			landmark = SelectFarthest(grid, nearest);
+		}
+		if (landmark < 0) {
+			break;
+		}
+
+		// The tree of the next selection only depends on its root, it is swept while this
+		// landmark fills its column
+		mLandmarks.push_back(landmark);
+		root = SELECT_AVOID == selection && i + 1 < landmarkCount ? SelectRoot(grid, nearest, random) : -1;
+		threadPool.ParallelFor(root >= 0 ? 2 : 1, 1, [&](size_t begin, size_t end, unsigned int) {
+			for (size_t task = begin; task < end; ++task) {
+				if (task == 0) {
+					FillColumn(grid, i, sweep);
+				} else {
+					GridNode rootNode = grid.GetNode(root);
+					rootSweep.Compute(grid, &rootNode, 1, connectivity);
+				}
+			}
+		});
+		const std::vector<int>& field = sweep.GetField();
+		if (i == 0) {
+			nearest = field;
+		} else {
+			for (int cell = 0; cell < mCellCount; ++cell) {
+				nearest[cell] = std::min(nearest[cell], field[cell]);
+			}
+		}
+	}
+}
+
+void LandmarkTable::Refresh(const CostGrid& grid, ThreadPool& threadPool) {
+	bool landmarksWalkable = grid.GetCellCount() == mCellCount;
+	for (size_t i = 0; i < mLandmarks.size() && landmarksWalkable; ++i) {
+		landmarksWalkable = grid.IsWalkable(mLandmarks[i]);
+	}
+	if (!landmarksWalkable) {
+		Build(grid, mConnectivity, mColumnCount, mSelection, threadPool);
+		return;
+	}
+
+	// The costs to each landmark are independent of the others
+	std::vector<IntegrationSweep> sweeps(threadPool.GetThreadCount());
+	threadPool.ParallelFor(mLandmarks.size(), 1, [&](size_t begin, size_t end, unsigned int worker) {
+		for (size_t i = begin; i < end; ++i) {
+			FillColumn(grid, static_cast<int>(i), sweeps[worker]);
+		}
+	});
+	mVersion = grid.GetVersion();
+}
+
+int LandmarkTable::SelectFarthest(const CostGrid& grid, const std::vector<int>& nearest) const {
+	int farthest = -1;
+	int farthestCost = 0;
+	for (int cell = 0; cell < mCellCount; ++cell) {
+		if (grid.IsWalkable(cell) && nearest[cell] > farthestCost && nearest[cell] < IntegrationSweep::UNREACHABLE) {
+			farthest = cell;
+			farthestCost = nearest[cell];
+		}
+	}
+	return farthest;
+}
+
+int LandmarkTable::SelectRoot(const CostGrid& grid, const std::vector<int>& nearest, std::mt19937& random) const {
+	for (int i = 0; i < ROOT_TRIES; ++i) {
+		int cell = random() % mCellCount;
+		if (grid.IsWalkable(cell) && nearest[cell] < IntegrationSweep::UNREACHABLE) {
+			return cell;
+		}
+	}
+	return -1;
+}
+
+int LandmarkTable::SelectAvoid(const CostGrid& grid, int root, const std::vector<int>& field) const {
+	// Shortest path tree towards the root, children are processed before their parent
+	std::vector<int> order;
+	for (int cell = 0; cell < mCellCount; ++cell) {
+		if (field[cell] < IntegrationSweep::UNREACHABLE) {
+			order.push_back(cell);
+		}
+	}
+	std::sort(order.begin(), order.end(), [&](int a, int b) { return field[a] > field[b]; });
+
+	// The weight of a cell is how much the current landmarks underestimate its cost to the
+	// root, a subtree holding a landmark is already covered and weighs nothing
+	std::vector<int> parents(mCellCount, -1);
+	std::vector<long long> sizes(mCellCount, 0);
+	std::vector<bool> covered(mCellCount, false);
+	for (int landmark : mLandmarks) {
+		covered[landmark] = true;
+	}
+	const unsigned short* rootDistances = GetDistances(root);
+	int rootCost = grid.GetCost(root);
+	int stride = grid.GetStride();
+	for (int cell : order) {
+		if (cell == root) {
+			continue;
+		}
+		sizes[cell] += field[cell] - GetLowerBound(grid, cell, rootDistances, rootCost);
+		for (int i = 0; i < GridTopology::GetDirectionCount(mConnectivity); ++i) {
+			int next = cell + GridTopology::GetOffset(i, stride);
+			if (!grid.IsWalkable(next) || field[next] >= field[cell] || field[next] + grid.GetCost(next) * GridTopology::GetWeight(mConnectivity, i) != field[cell]) {
+				continue;
+			}
+			if (GridTopology::IsDiagonal(i) && (!grid.IsWalkable(cell + GridTopology::GetOffset(GridTopology::GetFirstSide(i), stride))
+				|| !grid.IsWalkable(cell + GridTopology::GetOffset(GridTopology::GetSecondSide(i), stride)))) {
+				continue;
+			}
+			parents[cell] = next;
+			break;
+		}
+		if (parents[cell] >= 0) {
+			if (covered[cell]) {
+				covered[parents[cell]] = true;
+			} else {
+				sizes[parents[cell]] += sizes[cell];
+			}
+		}
+	}
+
+	// Follows the heaviest uncovered child down to a leaf
+	int cell = root;
+	while (true) {
+		int heaviest = -1;
+		for (int i = 0; i < GridTopology::GetDirectionCount(mConnectivity); ++i) {
+			int next = cell + GridTopology::GetOffset(i, stride);
+			if (grid.IsWalkable(next) && parents[next] == cell && !covered[next] && (heaviest < 0 || sizes[next] > sizes[heaviest])) {
+				heaviest = next;
+			}
+		}
+		if (heaviest < 0) {
+			break;
+		}
+		cell = heaviest;
+	}
+	return cell != root && !covered[cell] ? cell : -1;
+}
+
+void LandmarkTable::FillColumn(const CostGrid& grid, int landmark, IntegrationSweep& sweep) {
+	GridNode node = grid.GetNode(mLandmarks[landmark]);
+	sweep.Compute(grid, &node, 1, mConnectivity);
+	const std::vector<int>& field = sweep.GetField();
+
+	// The smallest scale that fits the highest cost below UNREACHABLE
+	int maxCost = 0;
+	for (int cost : field) {
+		if (cost < IntegrationSweep::UNREACHABLE) {
+			maxCost = std::max(maxCost, cost);
+		}
+	}
+	int scale = maxCost / UNREACHABLE + 1;
+	mScales[landmark] = scale;
+	unsigned short* column = &mDistances[landmark];
+	for (int cell = 0; cell < mCellCount; ++cell) {
+		column[static_cast<size_t>(cell) * mColumnCount] = field[cell] < IntegrationSweep::UNREACHABLE ? static_cast<unsigned short>(field[cell] / scale) : UNREACHABLE;
+	}
+}
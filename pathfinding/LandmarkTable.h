@@ -0,0 +1,152 @@
+#ifndef __LANDMARKTABLE_H__
+#define __LANDMARKTABLE_H__
+
+#include <vector>
+#include <random>
+#include "GridNode.h"
+#include "CostGrid.h"
+#include "GridTopology.h"
+#include "IntegrationSweep.h"
+#include "SpecializedAStar.h"
+#include "ThreadPool.h"
+
+// Landmarks for the ALT heuristic (A*, landmarks and triangle inequality). For a few
+// landmark cells the table holds the cost from every cell to the landmark, and by the
+// triangle inequality the cost from a cell v to a goal t is at least d(v, L) - d(t, L).
+// Unlike the distance heuristics it knows about walls.
+//
+// A 4-connected move costs the entered cell, so reversing a path changes its cost by the
+// costs of its two ends only: d(L, v) = d(v, L) + cost(v) - cost(L). The table of costs
+// to the landmarks gives the costs from the landmarks as well, and the second bound
+// d(L, t) - d(L, v) without storing them. 8-connected moves are weighted and only use the
+// first bound.
+//
+// Costs are stored in 16 bits, as multiples of a per landmark scale rounded down, and the
+// bounds subtract the rounding error so that they never overestimate. Only the moves of
+// IntegrationSweep are supported: 4-connected, or 8-connected without cutting corners.
+class LandmarkTable {
+public:
+	enum Selection {
+		// Each landmark is the cell farthest from the landmarks chosen before
+		SELECT_FARTHEST,
+		// Each landmark is at the end of the branch of a shortest path tree, from a random
+		// root, where the current landmarks give the worst bounds (Goldberg and Werneck)
+		SELECT_AVOID
+	};
+
+	static const unsigned short UNREACHABLE = 0xFFFF;
+	static const int MAX_LANDMARKS = 32;
+
+	LandmarkTable();
+
+	// Selects the landmarks and fills their tables. Each selection depends on the landmarks
+	// before it, the costs to a landmark are computed once for both its table and the
+	// selection of the next one. With SELECT_AVOID a worker of the thread pool fills the
+	// table of a landmark while another sweeps the tree the next one is selected from.
+	void Build(const CostGrid& grid, GridTopology::Connectivity connectivity, int landmarkCount, Selection selection, ThreadPool& threadPool);
+	// Recomputes the tables of the same landmarks after costs changed, one landmark per
+	// worker of the thread pool. Selects new landmarks when one of them got blocked.
+	void Refresh(const CostGrid& grid, ThreadPool& threadPool);
+	void Clear();
+
+	// True when the table was built for the current version of the grid and these moves
+	bool IsCurrent(const CostGrid& grid, GridTopology::Connectivity connectivity) const {
+		return !mLandmarks.empty() && mVersion == grid.GetVersion() && mCellCount == grid.GetCellCount() && mConnectivity == connectivity;
+	}
+	bool IsBuilt() const { return !mLandmarks.empty(); }
+
+	int GetLandmarkCount() const { return static_cast<int>(mLandmarks.size()); }
+	int GetLandmark(int landmark) const { return mLandmarks[landmark]; }
+	GridTopology::Connectivity GetConnectivity() const { return mConnectivity; }
+	Selection GetSelection() const { return mSelection; }
+	// Scaled costs from a cell to every landmark, UNREACHABLE when there is no path
+	const unsigned short* GetDistances(int cell) const { return &mDistances[static_cast<size_t>(cell) * mColumnCount]; }
+	int GetScale(int landmark) const { return mScales[landmark]; }
+	size_t GetMemoryBytes() const { return mDistances.capacity() * sizeof(unsigned short); }
+
+	// Lower bound of the cost from a cell to the goal, from the entries of the goal
+	int GetLowerBound(const CostGrid& grid, int cell, const unsigned short* goalDistances, int goalCost) const;
+
+private:
+	// Both return -1 when no cell qualifies. nearest holds the cost from every cell to the
+	// nearest landmark, or to the seed before the first one.
+	int SelectFarthest(const CostGrid& grid, const std::vector<int>& nearest) const;
+	// Random walkable cell of the region of the landmarks, the root of an avoid tree
+	int SelectRoot(const CostGrid& grid, const std::vector<int>& nearest, std::mt19937& random) const;
+	// field holds the costs from every cell to the root
+	int SelectAvoid(const CostGrid& grid, int root, const std::vector<int>& field) const;
+	// Computes the costs to a landmark and stores them scaled in its column of the table
+	void FillColumn(const CostGrid& grid, int landmark, IntegrationSweep& sweep);
+
+	std::vector<int> mLandmarks;
+	std::vector<int> mScales;
+	// For every cell, the scaled costs to each landmark
+	std::vector<unsigned short> mDistances;
+	// Landmarks requested, a selection may stop before and leave columns unused
+	int mColumnCount;
+
+	GridTopology::Connectivity mConnectivity;
+	Selection mSelection;
+	unsigned int mVersion;
+	int mCellCount;
+};
+
+inline int LandmarkTable::GetLowerBound(const CostGrid& grid, int cell, const unsigned short* goalDistances, int goalCost) const {
+	const unsigned short* distances = GetDistances(cell);
+	int costDifference = goalCost - grid.GetCost(cell);
+	int bound = 0;
+	for (size_t i = 0; i < mLandmarks.size(); ++i) {
+		if (UNREACHABLE == distances[i] || UNREACHABLE == goalDistances[i]) {
+			continue;
+		}
+		// Both costs may be rounded down by up to scale - 1
+		int scale = mScales[i];
+		int difference = (distances[i] - goalDistances[i]) * scale;
+		bound = std::max(bound, difference - (scale - 1));
+		if (GridTopology::CONNECTIVITY_4 == mConnectivity) {
+			bound = std::max(bound, -difference - (scale - 1) + costDifference);
+		}
+	}
+	return bound;
+}
+
+// Heuristic policy of SpecializedAStar: the best of the distance heuristic and of the
+// landmark bounds. Without a table that is current for the grid, only the distance.
+template <GridTopology::Connectivity CONNECTIVITY>
+class LandmarkHeuristic {
+public:
+	LandmarkHeuristic() : mTable(nullptr), mGrid(nullptr), mUseTable(false), mGoalCost(0) {}
+
+	void SetTable(const LandmarkTable* table) { mTable = table; }
+
+	void Begin(const CostGrid& grid, int endIndex) {
+		mDistance.Begin(grid, endIndex);
+		mGrid = &grid;
+		mUseTable = mTable && mTable->IsCurrent(grid, CONNECTIVITY);
+		if (mUseTable) {
+			const unsigned short* distances = mTable->GetDistances(endIndex);
+			mGoalDistances.assign(distances, distances + mTable->GetLandmarkCount());
+			mGoalCost = grid.GetCost(endIndex);
+		}
+	}
+	int GetDistance(int index) const {
+		int distance = mDistance.GetDistance(index);
+		if (mUseTable) {
+			distance = std::max(distance, mTable->GetLowerBound(*mGrid, index, mGoalDistances.data(), mGoalCost));
+		}
+		return distance;
+	}
+
+private:
+	GridDistanceHeuristic<CONNECTIVITY> mDistance;
+	const LandmarkTable* mTable;
+	const CostGrid* mGrid;
+	bool mUseTable;
+	std::vector<unsigned short> mGoalDistances;
+	int mGoalCost;
+};
+
+typedef SpecializedAStar<GridNeighbours<GridTopology::CONNECTIVITY_4, GridTopology::CUT_CORNERS_NEVER>, LandmarkHeuristic<GridTopology::CONNECTIVITY_4>> LandmarkSearch4;
+typedef SpecializedAStar<GridNeighbours<GridTopology::CONNECTIVITY_8, GridTopology::CUT_CORNERS_NEVER>, LandmarkHeuristic<GridTopology::CONNECTIVITY_8>> LandmarkSearch8;
+
+#endif
@@ -0,0 +1,118 @@
+#include <stdafx.h>
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() :
+	mData(nullptr),
+	mSize(0)
+#ifdef _WIN32
+	, mFile(INVALID_HANDLE_VALUE),
+	mMapping(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const char* filename) {
+	Close();
+	mFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (INVALID_HANDLE_VALUE == mFile) {
+		return false;
+	}
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(mFile, &size) || size.QuadPart == 0) {
+		Close();
+		return false;
+	}
+	mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mMapping) {
+		Close();
+		return false;
+	}
+	mData = static_cast<const unsigned char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+	if (!mData) {
+		Close();
+		return false;
+	}
+	mSize = static_cast<size_t>(size.QuadPart);
+	return true;
+}
+
+void MappedFile::Prefetch(size_t offset, size_t size) const {
+#if _WIN32_WINNT >= 0x0602
+	WIN32_MEMORY_RANGE_ENTRY range = { const_cast<unsigned char*>(mData) + offset, size };
+	PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+#endif
+}
+
+void MappedFile::Close() {
+	if (mData) {
+		UnmapViewOfFile(mData);
+	}
+	if (mMapping) {
+		CloseHandle(mMapping);
+	}
+	if (INVALID_HANDLE_VALUE != mFile) {
+		CloseHandle(mFile);
+	}
+	mData = nullptr;
+	mSize = 0;
+	mMapping = nullptr;
+	mFile = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::Open(const char* filename) {
+	Close();
+	int file = open(filename, O_RDONLY);
+	if (file < 0) {
+		return false;
+	}
+	struct stat status;
+	if (fstat(file, &status) != 0 || status.st_size == 0) {
+		close(file);
+		return false;
+	}
+	// The mapping keeps the file alive, the descriptor is not needed after mmap
+	void* data = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (MAP_FAILED == data) {
+		return false;
+	}
+	mData = static_cast<const unsigned char*>(data);
+	mSize = static_cast<size_t>(status.st_size);
+	return true;
+}
+
+void MappedFile::Prefetch(size_t offset, size_t size) const {
+	// madvise needs a page aligned address
+	size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+	size_t begin = offset / pageSize * pageSize;
+	madvise(const_cast<unsigned char*>(mData) + begin, offset + size - begin, MADV_WILLNEED);
+}
+
+void MappedFile::Close() {
+	if (mData) {
+		munmap(const_cast<unsigned char*>(mData), mSize);
+	}
+	mData = nullptr;
+	mSize = 0;
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef __MAPPEDFILE_H__
+#define __MAPPEDFILE_H__
+
+#include <cstddef>
+
+// Read only view of a whole file mapped in memory. Pages are loaded by the OS on first
+// access, so opening a file costs the same whatever its size.
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool Open(const char* filename);
+	void Close();
+
+	bool IsOpen() const { return mData != nullptr; }
+	const unsigned char* GetData() const { return mData; }
+	size_t GetSize() const { return mSize; }
+	// Asks the OS to start reading a range of the file in the background
+	void Prefetch(size_t offset, size_t size) const;
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	const unsigned char* mData;
+	size_t mSize;
+#ifdef _WIN32
+	void* mFile;
+	void* mMapping;
+#endif
+};
+
+#endif
@@ -0,0 +1,88 @@
+#include <stdafx.h>
+
+#include "OpenList.h"
+
+void OpenList::Push(int index, Key key) {
+	Entry entry = { key, index };
+	mHeap.push_back(entry);
+	mNodes[index].heapIndex = static_cast<int>(mHeap.size() - 1);
+	SiftUp(mHeap.size() - 1);
+}
+
+void OpenList::Update(int index, Key key) {
+	size_t position = mNodes[index].heapIndex;
+	Key oldKey = mHeap[position].key;
+	mHeap[position].key = key;
+	if (key < oldKey) {
+		SiftUp(position);
+	} else {
+		SiftDown(position);
+	}
+}
+
+void OpenList::Remove(int index) {
+	size_t position = mNodes[index].heapIndex;
+	Key removedKey = mHeap[position].key;
+	mNodes[index].heapIndex = -1;
+	Entry last = mHeap.back();
+	mHeap.pop_back();
+	if (position < mHeap.size()) {
+		// The last entry fills the hole and moves to its place from there
+		Place(position, last);
+		if (last.key < removedKey) {
+			SiftUp(position);
+		} else {
+			SiftDown(position);
+		}
+	}
+}
+
+int OpenList::Pop() {
+	int index = mHeap.front().index;
+	mNodes[index].heapIndex = -1;
+	Entry last = mHeap.back();
+	mHeap.pop_back();
+	if (!mHeap.empty()) {
+		Place(0, last);
+		SiftDown(0);
+	}
+	return index;
+}
+
+void OpenList::SiftUp(size_t position) {
+	Entry entry = mHeap[position];
+	while (position > 0) {
+		size_t parent = (position - 1) / 2;
+		if (mHeap[parent].key <= entry.key) {
+			break;
+		}
+		Place(position, mHeap[parent]);
+		position = parent;
+	}
+	Place(position, entry);
+}
+
+void OpenList::SiftDown(size_t position) {
+	Entry entry = mHeap[position];
+	size_t size = mHeap.size();
+	while (true) {
+		size_t child = position * 2 + 1;
+		if (child >= size) {
+			break;
+		}
+		if (child + 1 < size && mHeap[child + 1].key < mHeap[child].key) {
+			++child;
+		}
+		if (entry.key <= mHeap[child].key) {
+			break;
+		}
+		Place(position, mHeap[child]);
+		position = child;
+	}
+	Place(position, entry);
+}
+
+void OpenList::Place(size_t position, const Entry& entry) {
+	mHeap[position] = entry;
+	mNodes[entry.index].heapIndex = static_cast<int>(position);
+}
@@ -0,0 +1,48 @@
+#ifndef __OPENLIST_H__
+#define __OPENLIST_H__
+
+#include <vector>
+#include "PathNode.h"
+
+// Indexed binary min-heap of grid cell indices. The position of every queued cell is
+// kept in its PathNode record, so the key of a queued cell can be changed in O(log n)
+// without searching for it, and emptying the list does not touch the records.
+class OpenList {
+public:
+	typedef unsigned long long Key;
+
+	// Builds a key ordered first by f and then by h, preferring nodes closer to the goal on ties
+	static Key MakeKey(unsigned int f, unsigned int h) { return (static_cast<Key>(f) << 32) | h; }
+
+	OpenList() : mNodes(nullptr) {}
+
+	void SetNodes(PathNode* nodes) { mNodes = nodes; }
+	void Clear() { mHeap.clear(); }
+
+	bool IsEmpty() const { return mHeap.empty(); }
+	size_t GetSize() const { return mHeap.size(); }
+	size_t GetCapacity() const { return mHeap.capacity(); }
+	static size_t GetEntrySize() { return sizeof(Entry); }
+
+	void Push(int index, Key key);
+	void Update(int index, Key key);
+	void Remove(int index);
+	int Pop();
+	int Top() const { return mHeap.front().index; }
+	Key GetTopKey() const { return mHeap.front().key; }
+
+private:
+	struct Entry {
+		Key key;
+		int index;
+	};
+
+	void SiftUp(size_t position);
+	void SiftDown(size_t position);
+	void Place(size_t position, const Entry& entry);
+
+	std::vector<Entry> mHeap;
+	PathNode* mNodes;
+};
+
+#endif
@@ -0,0 +1,154 @@
+#include <stdafx.h>
+
+#include "PathBuffer.h"
+#include "pathfinder.h"
+#include <new>
+
+const char* const PathBuffer::METATABLE = "PathBuffer";
+
+PathBuffer::PathBuffer(const Pathfinder* pathfinder, bool view) :
+	mPathfinder(pathfinder),
+	mView(view)
+{
+}
+
+PathBuffer* PathBuffer::PushView(lua_State* L, int pathfinderIndex, const Pathfinder* pathfinder)
+{
+	return Push(L, pathfinderIndex, pathfinder, true);
+}
+
+PathBuffer* PathBuffer::PushBatch(lua_State* L, int pathfinderIndex, const Pathfinder* pathfinder)
+{
+	return Push(L, pathfinderIndex, pathfinder, false);
+}
+
+PathBuffer* PathBuffer::Push(lua_State* L, int pathfinderIndex, const Pathfinder* pathfinder, bool view)
+{
+	if (pathfinderIndex < 0) {
+		pathfinderIndex = lua_gettop(L) + pathfinderIndex + 1;
+	}
+	PathBuffer* buffer = new (lua_newuserdata(L, sizeof(PathBuffer))) PathBuffer(pathfinder, view);
+
+	// The metatable is made by the first buffer
+	if (luaL_newmetatable(L, METATABLE)) {
+		lua_pushcfunction(L, _gc);
+		lua_setfield(L, -2, "__gc");
+		lua_pushcfunction(L, _len);
+		lua_setfield(L, -2, "__len");
+		lua_createtable(L, 0, 4);
+		lua_pushcfunction(L, _getPathCount);
+		lua_setfield(L, -2, "getPathCount");
+		lua_pushcfunction(L, _getLength);
+		lua_setfield(L, -2, "getLength");
+		lua_pushcfunction(L, _getPosition);
+		lua_setfield(L, -2, "getPosition");
+		lua_pushcfunction(L, _getCell);
+		lua_setfield(L, -2, "getCell");
+		lua_setfield(L, -2, "__index");
+	}
+	lua_setmetatable(L, -2);
+
+	// The environment of the userdata references the Pathfinder
+	lua_createtable(L, 1, 0);
+	lua_pushvalue(L, pathfinderIndex);
+	lua_rawseti(L, -2, 1);
+	lua_setfenv(L, -2);
+	return buffer;
+}
+
+PathBuffer* PathBuffer::Get(lua_State* L, int index)
+{
+	void* data = lua_touserdata(L, index);
+	if (!data || !lua_getmetatable(L, index)) {
+		return nullptr;
+	}
+	luaL_getmetatable(L, METATABLE);
+	bool isBuffer = lua_rawequal(L, -1, -2) != 0;
+	lua_pop(L, 2);
+	return isBuffer ? static_cast<PathBuffer*>(data) : nullptr;
+}
+
+PathBuffer* PathBuffer::Check(lua_State* L)
+{
+	return static_cast<PathBuffer*>(luaL_checkudata(L, 1, METATABLE));
+}
+
+size_t PathBuffer::GetPathCount() const
+{
+	return mView ? 1 : mBatch.GetPathCount();
+}
+
+size_t PathBuffer::GetPathLength(size_t path) const
+{
+	return mView ? mPathfinder->GetPath().size() : mBatch.GetPathLength(path);
+}
+
+const GridNode* PathBuffer::GetPath(size_t path) const
+{
+	return mView ? mPathfinder->GetPath().data() : mBatch.GetPath(path);
+}
+
+const GridNode* PathBuffer::GetCell(lua_State* L) const
+{
+	long cell = luaL_checkinteger(L, 2) - 1;
+	long path = lua_isnumber(L, 3) ? static_cast<long>(lua_tonumber(L, 3)) - 1 : 0;
+	if (path < 0 || path >= static_cast<long>(GetPathCount()) || cell < 0 || cell >= static_cast<long>(GetPathLength(path))) {
+		return nullptr;
+	}
+	return GetPath(path) + cell;
+}
+
+int PathBuffer::_gc(lua_State* L)
+{
+	Check(L)->~PathBuffer();
+	return 0;
+}
+
+int PathBuffer::_len(lua_State* L)
+{
+	PathBuffer* buffer = Check(L);
+	lua_pushinteger(L, buffer->GetPathCount() > 0 ? static_cast<long>(buffer->GetPathLength(0)) : 0);
+	return 1;
+}
+
+int PathBuffer::_getPathCount(lua_State* L)
+{
+	lua_pushinteger(L, static_cast<long>(Check(L)->GetPathCount()));
+	return 1;
+}
+
+int PathBuffer::_getLength(lua_State* L)
+{
+	// Cells of a path, 0 when it was not found
+	PathBuffer* buffer = Check(L);
+	long path = lua_isnumber(L, 2) ? static_cast<long>(lua_tonumber(L, 2)) - 1 : 0;
+	bool valid = path >= 0 && path < static_cast<long>(buffer->GetPathCount());
+	lua_pushinteger(L, valid ? static_cast<long>(buffer->GetPathLength(path)) : 0);
+	return 1;
+}
+
+int PathBuffer::_getPosition(lua_State* L)
+{
+	// Screen position of the center of a cell, nothing past the last one
+	PathBuffer* buffer = Check(L);
+	const GridNode* cell = buffer->GetCell(L);
+	if (!cell) {
+		return 0;
+	}
+	USVec2D position = buffer->mPathfinder->GetScreenPositionFromNode(*cell);
+	lua_pushnumber(L, position.mX);
+	lua_pushnumber(L, position.mY);
+	return 2;
+}
+
+int PathBuffer::_getCell(lua_State* L)
+{
+	// Grid coordinates of a cell, nothing past the last one
+	const GridNode* cell = Check(L)->GetCell(L);
+	if (!cell) {
+		return 0;
+	}
+	lua_pushinteger(L, cell->x);
+	lua_pushinteger(L, cell->y);
+	return 2;
+}
@@ -0,0 +1,58 @@
+#ifndef __PATHBUFFER_H__
+#define __PATHBUFFER_H__
+
+#include <moaicore/MOAILuaState.h>
+#include "GridNode.h"
+#include "BatchPathfinder.h"
+
+class Pathfinder;
+
+// Paths read from Lua without copying them into tables. A buffer is a userdata that is
+// either a view of the current path of a Pathfinder, always reading the path as it is now,
+// or the owner of the paths of a batch of queries or of a path across the streamed world.
+// Cells are converted to screen positions only when Lua reads them. A buffer keeps its
+// Pathfinder alive.
+//
+// Lua methods, paths and cells counted from 1, the path defaulting to the first one:
+// getPathCount(), getLength([path]), getPosition(cell[, path]) and getCell(cell[, path]).
+// The length operator gives the length of the first path.
+class PathBuffer {
+public:
+	// Pushes a new buffer, the Pathfinder being the userdata at pathfinderIndex of the stack
+	static PathBuffer* PushView(lua_State* L, int pathfinderIndex, const Pathfinder* pathfinder);
+	static PathBuffer* PushBatch(lua_State* L, int pathfinderIndex, const Pathfinder* pathfinder);
+	// The buffer at index of the stack, nullptr for any other value
+	static PathBuffer* Get(lua_State* L, int index);
+
+	const Pathfinder* GetPathfinder() const { return mPathfinder; }
+	bool IsView() const { return mView; }
+	// Paths of a batch buffer, to be filled by BatchPathfinder::FindPaths()
+	PathBatch& GetBatch() { return mBatch; }
+
+	size_t GetPathCount() const;
+	size_t GetPathLength(size_t path) const;
+	const GridNode* GetPath(size_t path) const;
+
+private:
+	static const char* const METATABLE;
+
+	PathBuffer(const Pathfinder* pathfinder, bool view);
+	static PathBuffer* Push(lua_State* L, int pathfinderIndex, const Pathfinder* pathfinder, bool view);
+	// Buffer of a method, raises a Lua error for any other value
+	static PathBuffer* Check(lua_State* L);
+	// Cell given by the arguments of a getter, nullptr when they are out of the paths
+	const GridNode* GetCell(lua_State* L) const;
+
+	static int _gc(lua_State* L);
+	static int _len(lua_State* L);
+	static int _getPathCount(lua_State* L);
+	static int _getLength(lua_State* L);
+	static int _getPosition(lua_State* L);
+	static int _getCell(lua_State* L);
+
+	const Pathfinder* mPathfinder;
+	bool mView;
+	PathBatch mBatch;
+};
+
+#endif
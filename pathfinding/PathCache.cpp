@@ -0,0 +1,132 @@
+#include <stdafx.h>
+
+#include "PathCache.h"
+#include <algorithm>
+#include <cstdlib>
+
+PathCache::PathCache(size_t capacity) :
+	mCapacity(capacity),
+	mHits(0),
+	mSuffixHits(0),
+	mMisses(0)
+{
+}
+
+void PathCache::SetCapacity(size_t capacity) {
+	mCapacity = capacity;
+	while (mEntries.size() > mCapacity) {
+		Erase(--mEntries.end());
+	}
+}
+
+void PathCache::Clear() {
+	mEntries.clear();
+	mIndex.clear();
+}
+
+bool PathCache::Find(int startCell, int endCell, int mode, unsigned int version, const GridNode& start, std::vector<GridNode>& path) {
+	Key key = { startCell, endCell, mode };
+	auto found = mIndex.find(key);
+	if (mIndex.end() != found) {
+		EntryList::iterator entry = found->second;
+		if (entry->version == version) {
+			mEntries.splice(mEntries.begin(), mEntries, entry);
+			path = entry->path;
+			++mHits;
+			return true;
+		}
+		Erase(entry);
+	}
+
+	// Looks for the start on a cached path going to the same end
+	for (EntryList::iterator entry = mEntries.begin(); entry != mEntries.end(); ++entry) {
+		if (entry->key.endCell != endCell || entry->key.mode != mode || entry->version != version) {
+			continue;
+		}
+		const std::vector<GridNode>& cachedPath = entry->path;
+		for (size_t i = 1; i + 1 < cachedPath.size(); ++i) {
+			if (cachedPath[i].Compare(start)) {
+				mEntries.splice(mEntries.begin(), mEntries, entry);
+				path.assign(cachedPath.begin() + i, cachedPath.end());
+				++mSuffixHits;
+				return true;
+			}
+		}
+	}
+
+	++mMisses;
+	return false;
+}
+
+void PathCache::Store(int startCell, int endCell, int mode, unsigned int version, const std::vector<GridNode>& path) {
+	if (mCapacity == 0) {
+		return;
+	}
+
+	Key key = { startCell, endCell, mode };
+	auto found = mIndex.find(key);
+	if (mIndex.end() != found) {
+		Erase(found->second);
+	}
+	while (mEntries.size() >= mCapacity) {
+		Erase(--mEntries.end());
+	}
+
+	Entry entry = { key, version, path };
+	mEntries.push_front(entry);
+	mIndex[key] = mEntries.begin();
+}
+
+void PathCache::Revalidate(const CostGrid& grid, unsigned int version, int x0, int y0, int x1, int y1, bool costsIncreased,
+	GridTopology::Connectivity connectivity) {
+	int minCost = grid.GetMinCost();
+	for (Entry& entry : mEntries) {
+		if (entry.version != version) {
+			continue;
+		}
+		if (entry.path.empty()) {
+			// Only cells that became walkable can join two cells without a path
+			if (costsIncreased) {
+				entry.version = grid.GetVersion();
+			}
+			continue;
+		}
+
+		bool crosses = false;
+		int cost = 0;
+		for (size_t i = 0; i < entry.path.size() && !crosses; ++i) {
+			const GridNode& node = entry.path[i];
+			crosses = IsInRect(node.x, node.y, x0, y0, x1, y1);
+			if (i > 0) {
+				const GridNode& previous = entry.path[i - 1];
+				// A diagonal move depends on the two cells beside it, which the corner
+				// cutting rule may forbid it to pass once they are blocked
+				if (node.x != previous.x && node.y != previous.y) {
+					crosses |= IsInRect(previous.x, node.y, x0, y0, x1, y1) || IsInRect(node.x, previous.y, x0, y0, x1, y1);
+				}
+				int distance = GridTopology::GetDistance(connectivity, node.x - previous.x, node.y - previous.y);
+				cost += grid.GetCost(node.x, node.y) * distance;
+			}
+		}
+		if (crosses) {
+			continue;
+		}
+		const GridNode& start = entry.path.front();
+		const GridNode& end = entry.path.back();
+		int distanceThrough = GridTopology::GetDistance(connectivity, GetDistanceThrough(start.x, end.x, x0, x1), GetDistanceThrough(start.y, end.y, y0, y1));
+		if (costsIncreased || distanceThrough * minCost >= cost) {
+			entry.version = grid.GetVersion();
+		}
+	}
+}
+
+int PathCache::GetDistanceThrough(int a, int b, int low, int high) {
+	// Steps along one axis from a to b visiting the range [low, high]
+	int detour = std::max(0, std::max(low - std::max(a, b), std::min(a, b) - high));
+	return std::abs(a - b) + 2 * detour;
+}
+
+void PathCache::Erase(EntryList::iterator entry) {
+	mIndex.erase(entry->key);
+	mEntries.erase(entry);
+}
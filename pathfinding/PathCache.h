@@ -0,0 +1,78 @@
+#ifndef __PATHCACHE_H__
+#define __PATHCACHE_H__
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "GridNode.h"
+#include "CostGrid.h"
+#include "GridTopology.h"
+
+// LRU cache of computed paths keyed by start cell, end cell and search mode. Every
+// entry remembers the grid version it was computed with and is dropped when the grid
+// changed. When the start of a query lies on a cached path to the same end, the tail
+// of that path is returned, as any part of an optimal path is optimal too.
+class PathCache {
+public:
+	explicit PathCache(size_t capacity);
+
+	void SetCapacity(size_t capacity);
+	size_t GetCapacity() const { return mCapacity; }
+	size_t GetSize() const { return mEntries.size(); }
+	void Clear();
+
+	// Returns true on a hit. An empty path is a cached query without path.
+	bool Find(int startCell, int endCell, int mode, unsigned int version, const GridNode& start, std::vector<GridNode>& path);
+	void Store(int startCell, int endCell, int mode, unsigned int version, const std::vector<GridNode>& path);
+	// Moves the entries of a grid version to the current version of the grid after the cells
+	// of a rectangle changed, for the paths that stay out of the rectangle, without diagonal
+	// moves beside it, and are still the cheapest: when the cells only got more expensive, or
+	// when any path through the rectangle costs at least as much as the path, with every cell
+	// at the lowest cost of the grid. Costs are measured with the moves of the connectivity, the moves of any
+	// 4-connected path cached meanwhile are valid 8-connected moves too.
+	void Revalidate(const CostGrid& grid, unsigned int version, int x0, int y0, int x1, int y1, bool costsIncreased,
+		GridTopology::Connectivity connectivity = GridTopology::CONNECTIVITY_4);
+
+	unsigned int GetHits() const { return mHits; }
+	unsigned int GetSuffixHits() const { return mSuffixHits; }
+	unsigned int GetMisses() const { return mMisses; }
+	void ResetCounters() { mHits = mSuffixHits = mMisses = 0; }
+
+private:
+	struct Key {
+		int startCell;
+		int endCell;
+		int mode;
+
+		bool operator==(const Key& other) const { return startCell == other.startCell && endCell == other.endCell && mode == other.mode; }
+	};
+
+	struct KeyHash {
+		size_t operator()(const Key& key) const {
+			return std::hash<unsigned long long>()((static_cast<unsigned long long>(key.startCell) << 32) ^ (static_cast<unsigned long long>(key.endCell) << 3) ^ key.mode);
+		}
+	};
+
+	struct Entry {
+		Key key;
+		unsigned int version;
+		std::vector<GridNode> path;
+	};
+
+	typedef std::list<Entry> EntryList;
+
+	void Erase(EntryList::iterator entry);
+	static int GetDistanceThrough(int a, int b, int low, int high);
+	static bool IsInRect(int x, int y, int x0, int y0, int x1, int y1) { return x >= x0 && x <= x1 && y >= y0 && y <= y1; }
+
+	size_t mCapacity;
+	// Most recently used entries first
+	EntryList mEntries;
+	std::unordered_map<Key, EntryList::iterator, KeyHash> mIndex;
+
+	unsigned int mHits;
+	unsigned int mSuffixHits;
+	unsigned int mMisses;
+};
+
+#endif
@@ -0,0 +1,209 @@
+#include <stdafx.h>
+
+#include "PathJobQueue.h"
+#include <algorithm>
+
+const unsigned int PathJobQueue::NO_JOB = 0;
+// Expansions between two checks of the cancellation of the running job
+const unsigned int PathJobQueue::CANCEL_CHECK_EXPANSIONS = 1024;
+
+PathJobQueue::PathJobQueue(unsigned int threadCount) :
+	mNextId(NO_JOB + 1),
+	mStopping(false),
+	mConnectivity(GridTopology::CONNECTIVITY_4),
+	mCornerCutting(GridTopology::CUT_CORNERS_NEVER),
+	mAnyAngle(false),
+	mStats(),
+	mTotalMicroseconds(0.0)
+{
+	if (threadCount == 0) {
+		threadCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+	}
+	for (unsigned int i = 0; i < threadCount; ++i) {
+		mWorkers.push_back(new Worker());
+	}
+	for (unsigned int i = 0; i < threadCount; ++i) {
+		mThreads.push_back(std::thread(&PathJobQueue::WorkerLoop, this, i));
+	}
+}
+
+PathJobQueue::~PathJobQueue() {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+		mJobs.clear();
+		for (Worker* worker : mWorkers) {
+			worker->cancelled = true;
+		}
+	}
+	mJobReady.notify_all();
+	for (std::thread& thread : mThreads) {
+		thread.join();
+	}
+	for (Worker* worker : mWorkers) {
+		delete worker;
+	}
+}
+
+void PathJobQueue::SetMovement(GridTopology::Connectivity connectivity, GridTopology::CornerCutting cornerCutting) {
+	mConnectivity = connectivity;
+	mCornerCutting = cornerCutting;
+}
+
+unsigned int PathJobQueue::Submit(const CostGrid& grid, const GridNode& start, const GridNode& end, int priority) {
+	// Jobs of the same version of the grid share its copy
+	if (!mGrid || mGrid->GetVersion() != grid.GetVersion() || mGrid->GetCellCount() != grid.GetCellCount()) {
+		mGrid = std::make_shared<const CostGrid>(grid);
+	}
+
+	Job job;
+	job.priority = priority;
+	job.start = start;
+	job.end = end;
+	job.connectivity = mConnectivity;
+	job.cornerCutting = mCornerCutting;
+	job.anyAngle = mAnyAngle;
+	job.grid = mGrid;
+	job.submitTime = std::chrono::steady_clock::now();
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		job.id = mNextId++;
+		mJobs.push_back(job);
+		std::push_heap(mJobs.begin(), mJobs.end());
+		++mStats.submitted;
+		mStats.peakPending = std::max(mStats.peakPending, mJobs.size());
+	}
+	mJobReady.notify_one();
+	return job.id;
+}
+
+unsigned int PathJobQueue::SubmitFailed() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	PathJobResult result;
+	result.id = mNextId++;
+	result.found = false;
+	result.expanded = 0;
+	++mStats.submitted;
+	AddResult(result, std::chrono::steady_clock::now());
+	return result.id;
+}
+
+bool PathJobQueue::Cancel(unsigned int id) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (size_t i = 0; i < mJobs.size(); ++i) {
+		if (mJobs[i].id == id) {
+			mJobs.erase(mJobs.begin() + i);
+			std::make_heap(mJobs.begin(), mJobs.end());
+			++mStats.cancelled;
+			return true;
+		}
+	}
+	// A running job stops at its next check and drops its result
+	for (Worker* worker : mWorkers) {
+		if (worker->runningId == id && !worker->cancelled) {
+			worker->cancelled = true;
+			++mStats.cancelled;
+			return true;
+		}
+	}
+	return false;
+}
+
+void PathJobQueue::CancelAll() {
+	std::lock_guard<std::mutex> lock(mMutex);
+	mStats.cancelled += static_cast<unsigned int>(mJobs.size());
+	mJobs.clear();
+	for (Worker* worker : mWorkers) {
+		if (worker->runningId != NO_JOB && !worker->cancelled) {
+			worker->cancelled = true;
+			++mStats.cancelled;
+		}
+	}
+	mResults.clear();
+}
+
+void PathJobQueue::PollResults(std::vector<PathJobResult>& results) {
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (PathJobResult& result : mResults) {
+		results.push_back(std::move(result));
+	}
+	mResults.clear();
+}
+
+PathJobStats PathJobQueue::GetStats() const {
+	std::lock_guard<std::mutex> lock(mMutex);
+	PathJobStats stats = mStats;
+	stats.pending = mJobs.size();
+	stats.running = 0;
+	for (const Worker* worker : mWorkers) {
+		stats.running += worker->runningId != NO_JOB ? 1 : 0;
+	}
+	stats.meanMicroseconds = stats.completed > 0 ? mTotalMicroseconds / stats.completed : 0.0;
+	return stats;
+}
+
+void PathJobQueue::WorkerLoop(unsigned int workerIndex) {
+	Worker& worker = *mWorkers[workerIndex];
+	PathJobResult result;
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mJobReady.wait(lock, [this]() { return mStopping || !mJobs.empty(); });
+			if (mStopping) {
+				return;
+			}
+			std::pop_heap(mJobs.begin(), mJobs.end());
+			job = mJobs.back();
+			mJobs.pop_back();
+			worker.runningId = job.id;
+			worker.cancelled = false;
+		}
+
+		RunJob(worker, job, result);
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (!worker.cancelled) {
+			AddResult(result, job.submitTime);
+		}
+		worker.runningId = NO_JOB;
+	}
+}
+
+void PathJobQueue::RunJob(Worker& worker, Job& job, PathJobResult& result) {
+	if (worker.grid != job.grid) {
+		// The searches keep a reference to the grid they were created for
+		delete worker.astar;
+		worker.astar = nullptr;
+		worker.grid = job.grid;
+		worker.astar = new AStarVariants(*worker.grid, worker.context);
+	}
+
+	result.id = job.id;
+	result.found = false;
+	result.waypoints.clear();
+	AStarSearch& search = worker.astar->Get(job.connectivity, job.cornerCutting);
+	search.Begin(job.start, job.end);
+	while (search.IsRunning() && !worker.cancelled) {
+		search.Step(CANCEL_CHECK_EXPANSIONS);
+	}
+	result.expanded = search.GetExpandedCount();
+	if (AStarSearch::SEARCH_FOUND == search.GetStatus()) {
+		search.BuildPath(worker.path);
+		if (job.anyAngle) {
+			worker.smoother.Smooth(*worker.grid, worker.path, result.waypoints);
+		} else {
+			PathSmoother::Compress(worker.path, result.waypoints);
+		}
+		result.found = true;
+	}
+	search.Cancel();
+}
+
+void PathJobQueue::AddResult(PathJobResult& result, const std::chrono::steady_clock::time_point& submitTime) {
+	result.microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - submitTime).count();
+	++mStats.completed;
+	mTotalMicroseconds += result.microseconds;
+	mStats.maxMicroseconds = std::max(mStats.maxMicroseconds, result.microseconds);
+	mResults.push_back(std::move(result));
+}
@@ -0,0 +1,132 @@
+#ifndef __PATHJOBQUEUE_H__
+#define __PATHJOBQUEUE_H__
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "GridNode.h"
+#include "CostGrid.h"
+#include "GridTopology.h"
+#include "SearchContext.h"
+#include "SpecializedAStar.h"
+#include "PathSmoother.h"
+
+// Path found by a job, or the reason there is none
+struct PathJobResult {
+	unsigned int id;
+	bool found;
+	// Waypoints of the path, see PathSmoother
+	std::vector<GridNode> waypoints;
+	unsigned int expanded;
+	// From the submission of the job to its end
+	double microseconds;
+};
+
+// Counters of the queue since it was created
+struct PathJobStats {
+	size_t pending;
+	size_t peakPending;
+	unsigned int running;
+	unsigned int submitted;
+	unsigned int completed;
+	unsigned int cancelled;
+	double meanMicroseconds;
+	double maxMicroseconds;
+};
+
+// Runs path queries on background threads while the caller goes on. Jobs are searched
+// with A* on a snapshot of the grid taken when they are submitted: a copy of the grid is
+// made once per version of the grid and shared by the jobs of that version, so editing the
+// grid never races with the workers. The highest priority job runs first, jobs of equal
+// priority in the order they were submitted. Results are collected by PollResults(),
+// typically once per frame on the main thread.
+class PathJobQueue {
+public:
+	static const unsigned int NO_JOB;
+
+	// A thread count of 0 leaves one hardware thread to the caller
+	explicit PathJobQueue(unsigned int threadCount = 0);
+	// Drops the pending jobs and waits for the running ones
+	~PathJobQueue();
+
+	// Moves of the jobs submitted from now on
+	void SetMovement(GridTopology::Connectivity connectivity, GridTopology::CornerCutting cornerCutting);
+	// Whether the waypoints of the jobs submitted from now on are pulled taut
+	void SetAnyAngle(bool anyAngle) { mAnyAngle = anyAngle; }
+
+	// Returns the id of the job, never NO_JOB
+	unsigned int Submit(const CostGrid& grid, const GridNode& start, const GridNode& end, int priority);
+	// A job known to have no path, its result is returned by the next poll without a search
+	unsigned int SubmitFailed();
+	// True when the job was pending or running, it then has no result
+	bool Cancel(unsigned int id);
+	void CancelAll();
+
+	// Appends the results of the jobs done since the last poll, in the order they ended
+	void PollResults(std::vector<PathJobResult>& results);
+
+	PathJobStats GetStats() const;
+	unsigned int GetThreadCount() const { return static_cast<unsigned int>(mThreads.size()); }
+
+private:
+	static const unsigned int CANCEL_CHECK_EXPANSIONS;
+
+	struct Job {
+		unsigned int id;
+		int priority;
+		GridNode start;
+		GridNode end;
+		GridTopology::Connectivity connectivity;
+		GridTopology::CornerCutting cornerCutting;
+		bool anyAngle;
+		std::shared_ptr<const CostGrid> grid;
+		std::chrono::steady_clock::time_point submitTime;
+
+		// Heap order, the top is the highest priority and the oldest id among equals
+		bool operator<(const Job& other) const { return priority < other.priority || (priority == other.priority && id > other.id); }
+	};
+
+	// Search memory of one thread, the searches are bound to the snapshot of its last job
+	struct Worker {
+		Worker() : astar(nullptr), runningId(NO_JOB), cancelled(false) {}
+		~Worker() { delete astar; }
+
+		std::shared_ptr<const CostGrid> grid;
+		SearchContext context;
+		AStarVariants* astar;
+		PathSmoother smoother;
+		std::vector<GridNode> path;
+		// Job being searched, read by Cancel() under the queue mutex
+		unsigned int runningId;
+		std::atomic<bool> cancelled;
+	};
+
+	void WorkerLoop(unsigned int worker);
+	void RunJob(Worker& worker, Job& job, PathJobResult& result);
+	void AddResult(PathJobResult& result, const std::chrono::steady_clock::time_point& submitTime);
+
+	std::vector<Worker*> mWorkers;
+	std::vector<std::thread> mThreads;
+
+	mutable std::mutex mMutex;
+	std::condition_variable mJobReady;
+	std::vector<Job> mJobs;
+	std::vector<PathJobResult> mResults;
+	unsigned int mNextId;
+	bool mStopping;
+
+	// Snapshot of the grid for the next submissions, owned by the submitting thread
+	std::shared_ptr<const CostGrid> mGrid;
+	GridTopology::Connectivity mConnectivity;
+	GridTopology::CornerCutting mCornerCutting;
+	bool mAnyAngle;
+
+	PathJobStats mStats;
+	double mTotalMicroseconds;
+};
+
+#endif
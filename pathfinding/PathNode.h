@@ -1,21 +1,25 @@
 #ifndef __PATHNODE_H__
 #define __PATHNODE_H__
 
-#include "GridNode.h"
-
+// Search state of one grid cell. The records are stored per cell and reused between
+// queries: a record only belongs to the current query when its generation matches.
 class PathNode {
 public:
-	PathNode(GridNode node, int g = 0, int h = 0, const PathNode* parent = nullptr) : node(node), g(g), h(h), parent(parent) {}
+	enum State {
+		NODE_OPEN,
+		NODE_CLOSED
+	};
 
-	static bool CompareNode(const PathNode& pathNode1, const PathNode& pathNode2);
-	static bool CompareNodePointer(const PathNode* pathNode1, const PathNode* pathNode2);
+	PathNode() : g(0), h(0), parent(-1), heapIndex(-1), generation(0), state(NODE_OPEN) {}
 
-	bool operator<(const PathNode& other) const;
+	bool IsVisited(unsigned int currentGeneration) const { return generation == currentGeneration; }
 
-	GridNode node;
 	int g;
 	int h;
-	const PathNode* parent;
+	int parent;
+	int heapIndex;
+	unsigned int generation;
+	State state;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,102 @@
+#include <stdafx.h>
+
+#include "PathSmoother.h"
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+// Rounding of the sums of the line and path costs, a line costing as much as the path is kept
+const double COST_TOLERANCE = 1e-9;
+
+}
+
+void PathSmoother::Compress(const std::vector<GridNode>& path, std::vector<GridNode>& waypoints) {
+	waypoints.clear();
+	for (size_t i = 0; i < path.size(); ++i) {
+		if (i > 0 && i + 1 < path.size()
+			&& path[i].x - path[i - 1].x == path[i + 1].x - path[i].x && path[i].y - path[i - 1].y == path[i + 1].y - path[i].y) {
+			continue;
+		}
+		waypoints.push_back(path[i]);
+	}
+}
+
+void PathSmoother::Smooth(const CostGrid& grid, const std::vector<GridNode>& path, std::vector<GridNode>& waypoints) {
+	waypoints.clear();
+	if (path.size() <= 2) {
+		waypoints = path;
+		return;
+	}
+
+	// A step of the path costs half of each of its two cells
+	mPathCosts.resize(path.size());
+	mPathCosts[0] = 0.0;
+	for (size_t i = 1; i < path.size(); ++i) {
+		int dx = path[i].x - path[i - 1].x;
+		int dy = path[i].y - path[i - 1].y;
+		double length = std::sqrt(static_cast<double>(dx * dx + dy * dy));
+		mPathCosts[i] = mPathCosts[i - 1] + 0.5 * (grid.GetCost(path[i - 1].x, path[i - 1].y) + grid.GetCost(path[i].x, path[i].y)) * length;
+	}
+
+	size_t anchor = 0;
+	waypoints.push_back(path[0]);
+	for (size_t i = 2; i < path.size(); ++i) {
+		double lineCost;
+		double pathCost = mPathCosts[i] - mPathCosts[anchor];
+		if (!GetLineCost(grid, path[anchor], path[i], lineCost) || lineCost > pathCost * (1.0 + COST_TOLERANCE) + COST_TOLERANCE) {
+			anchor = i - 1;
+			waypoints.push_back(path[anchor]);
+		}
+	}
+	waypoints.push_back(path.back());
+}
+
+bool PathSmoother::GetLineCost(const CostGrid& grid, const GridNode& a, const GridNode& b, double& cost) {
+	// Walks the cells crossed by the line in order. The line leaves a cell through a
+	// vertical side at t = (2i + 1) / 2dx and through a horizontal side at t = (2j + 1) / 2dy,
+	// both are compared exactly in integers and a tie crosses a corner.
+	int dx = std::abs(b.x - a.x);
+	int dy = std::abs(b.y - a.y);
+	int stepX = b.x > a.x ? 1 : -1;
+	int stepY = b.y > a.y ? 1 : -1;
+	double length = std::sqrt(static_cast<double>(dx * dx + dy * dy));
+	int x = a.x;
+	int y = a.y;
+	double t = 0.0;
+	cost = 0.0;
+	for (int i = 0, j = 0; i < dx || j < dy;) {
+		long long crossX = i < dx ? static_cast<long long>(2 * i + 1) * dy : -1;
+		long long crossY = j < dy ? static_cast<long long>(2 * j + 1) * dx : -1;
+		double nextT;
+		int nextX = x;
+		int nextY = y;
+		if (crossY < 0 || (crossX >= 0 && crossX < crossY)) {
+			nextT = (2 * i + 1) / (2.0 * dx);
+			nextX += stepX;
+			++i;
+		} else if (crossX < 0 || crossY < crossX) {
+			nextT = (2 * j + 1) / (2.0 * dy);
+			nextY += stepY;
+			++j;
+		} else {
+			if (!grid.IsWalkable(GridNode(x + stepX, y)) || !grid.IsWalkable(GridNode(x, y + stepY))) {
+				return false;
+			}
+			nextT = (2 * i + 1) / (2.0 * dx);
+			nextX += stepX;
+			nextY += stepY;
+			++i;
+			++j;
+		}
+		if (!grid.IsWalkable(GridNode(nextX, nextY))) {
+			return false;
+		}
+		cost += grid.GetCost(x, y) * (nextT - t) * length;
+		x = nextX;
+		y = nextY;
+		t = nextT;
+	}
+	cost += grid.GetCost(x, y) * (1.0 - t) * length;
+	return true;
+}
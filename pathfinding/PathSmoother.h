@@ -0,0 +1,31 @@
+#ifndef __PATHSMOOTHER_H__
+#define __PATHSMOOTHER_H__
+
+#include <vector>
+#include "GridNode.h"
+#include "CostGrid.h"
+
+// Reduces the cells of a path to the waypoints an agent steers through.
+//
+// Costs are measured along the segments between the centers of cells: a segment costs
+// the length it runs inside each cell times the cost of the cell. A straight line
+// replaces a part of the path when every cell it crosses is walkable, it does not pass
+// between two cells touching at a corner unless both are walkable, and it costs no more
+// than that part of the path. The waypoints never cost more than the cells they replace,
+// and a line through cheap cells is not pulled through expensive ones.
+class PathSmoother {
+public:
+	// Keeps the ends of the path and the cells where its direction changes
+	static void Compress(const std::vector<GridNode>& path, std::vector<GridNode>& waypoints);
+	// String pulling: each waypoint is the last cell of the path seen from the one before
+	void Smooth(const CostGrid& grid, const std::vector<GridNode>& path, std::vector<GridNode>& waypoints);
+
+	// Cost of the line between the centers of two cells, false if it crosses a blocked cell
+	static bool GetLineCost(const CostGrid& grid, const GridNode& a, const GridNode& b, double& cost);
+
+private:
+	// Cost of the path from its first cell to each of its cells
+	std::vector<double> mPathCosts;
+};
+
+#endif
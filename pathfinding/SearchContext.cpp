@@ -0,0 +1,58 @@
+#include <stdafx.h>
+
+#include "SearchContext.h"
+
+SearchContext::SearchContext() :
+	mGeneration(0),
+	mAllocationCount(0),
+	mAllocatedBytes(0)
+{
+}
+
+void SearchContext::Prepare(int cellCount) {
+	if (mNodes.size() != static_cast<size_t>(cellCount)) {
+		std::vector<PathNode>().swap(mNodes);
+		mNodes.resize(cellCount);
+		CountAllocation(cellCount * sizeof(PathNode));
+		mOpenList.SetNodes(mNodes.data());
+		mOpenList.Clear();
+		mGeneration = 0;
+	}
+}
+
+void SearchContext::Reset() {
+	mOpenList.Clear();
+
+	// Bumping the generation invalidates every record of the previous query at once
+	++mGeneration;
+	if (mGeneration == 0) {
+		for (PathNode& pathNode : mNodes) {
+			pathNode.generation = 0;
+		}
+		mGeneration = 1;
+	}
+}
+
+PathNode& SearchContext::Visit(int index) {
+	PathNode& pathNode = mNodes[index];
+	if (!pathNode.IsVisited(mGeneration)) {
+		pathNode = PathNode();
+		pathNode.generation = mGeneration;
+	}
+	return pathNode;
+}
+
+void SearchContext::PushOpen(int index, OpenList::Key key) {
+	size_t capacity = mOpenList.GetCapacity();
+	mNodes[index].state = PathNode::NODE_OPEN;
+	mOpenList.Push(index, key);
+	if (mOpenList.GetCapacity() != capacity) {
+		CountAllocation((mOpenList.GetCapacity() - capacity) * OpenList::GetEntrySize());
+	}
+}
+
+int SearchContext::PopOpen() {
+	int index = mOpenList.Pop();
+	mNodes[index].state = PathNode::NODE_CLOSED;
+	return index;
+}
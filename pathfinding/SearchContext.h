@@ -0,0 +1,68 @@
+#ifndef __SEARCHCONTEXT_H__
+#define __SEARCHCONTEXT_H__
+
+#include <vector>
+#include "PathNode.h"
+#include "OpenList.h"
+
+// Arena holding the scratch memory of a grid search: a preallocated table with one
+// PathNode per grid cell and the open list. The table is allocated once per grid size
+// and Reset() starts a new query in O(1), so queries on a warm context do not touch the
+// heap. Every allocation made by the context is counted to be able to check it.
+class SearchContext {
+public:
+	SearchContext();
+
+	// Sizes the node table for a grid, only allocates when the cell count changes
+	void Prepare(int cellCount);
+	// Starts a new query, invalidating every node of the previous one
+	void Reset();
+
+	int GetCellCount() const { return static_cast<int>(mNodes.size()); }
+
+	bool IsVisited(int index) const { return mNodes[index].IsVisited(mGeneration); }
+	bool IsOpen(int index) const { return IsVisited(index) && mNodes[index].heapIndex >= 0; }
+	bool IsClosed(int index) const { return IsVisited(index) && mNodes[index].state == PathNode::NODE_CLOSED; }
+
+	// Returns the record of a cell, initializing it if it was not visited in this query
+	PathNode& Visit(int index);
+	PathNode& GetNode(int index) { return mNodes[index]; }
+	const PathNode& GetNode(int index) const { return mNodes[index]; }
+
+	// Open list operations, the node must have been visited in this query
+	bool IsOpenListEmpty() const { return mOpenList.IsEmpty(); }
+	size_t GetOpenListSize() const { return mOpenList.GetSize(); }
+	void PushOpen(int index, OpenList::Key key);
+	void UpdateOpen(int index, OpenList::Key key) { mOpenList.Update(index, key); }
+	void RemoveOpen(int index) { mOpenList.Remove(index); }
+	OpenList::Key GetTopKey() const { return mOpenList.GetTopKey(); }
+	int PopOpen();
+
+	// Grows a buffer owned by the caller, counting the allocation if it needs more memory
+	template <typename T>
+	void ResizeBuffer(std::vector<T>& buffer, size_t size);
+
+	unsigned int GetGeneration() const { return mGeneration; }
+	size_t GetAllocationCount() const { return mAllocationCount; }
+	size_t GetAllocatedBytes() const { return mAllocatedBytes; }
+
+private:
+	void CountAllocation(size_t bytes) { ++mAllocationCount; mAllocatedBytes += bytes; }
+
+	std::vector<PathNode> mNodes;
+	OpenList mOpenList;
+	unsigned int mGeneration;
+
+	size_t mAllocationCount;
+	size_t mAllocatedBytes;
+};
+
+template <typename T>
+void SearchContext::ResizeBuffer(std::vector<T>& buffer, size_t size) {
+	if (buffer.capacity() < size) {
+		CountAllocation((size - buffer.capacity()) * sizeof(T));
+	}
+	buffer.resize(size);
+}
+
+#endif
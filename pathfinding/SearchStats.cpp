@@ -0,0 +1,88 @@
+#include <stdafx.h>
+
+#include "SearchStats.h"
+#include <algorithm>
+
+const size_t SearchStatsHistory::DEFAULT_WINDOW = 64;
+
+void SearchStats::Clear() {
+	expanded = 0;
+	generated = 0;
+	reopened = 0;
+	heuristicEvaluations = 0;
+	openListPeak = 0;
+	microseconds = 0.0;
+	allocatedBytes = 0;
+}
+
+void SearchStats::Add(const SearchStats& other) {
+	expanded += other.expanded;
+	generated += other.generated;
+	reopened += other.reopened;
+	heuristicEvaluations += other.heuristicEvaluations;
+	openListPeak += other.openListPeak;
+	microseconds += other.microseconds;
+	allocatedBytes += other.allocatedBytes;
+}
+
+void SearchStats::Max(const SearchStats& other) {
+	expanded = std::max(expanded, other.expanded);
+	generated = std::max(generated, other.generated);
+	reopened = std::max(reopened, other.reopened);
+	heuristicEvaluations = std::max(heuristicEvaluations, other.heuristicEvaluations);
+	openListPeak = std::max(openListPeak, other.openListPeak);
+	microseconds = std::max(microseconds, other.microseconds);
+	allocatedBytes = std::max(allocatedBytes, other.allocatedBytes);
+}
+
+SearchStatsHistory::SearchStatsHistory(size_t window) :
+	mWindow(std::max<size_t>(window, 1)),
+	mNext(0),
+	mTotalCount(0)
+{
+	mQueries.reserve(mWindow);
+}
+
+void SearchStatsHistory::Add(const SearchStats& stats) {
+	if (mQueries.size() < mWindow) {
+		mQueries.push_back(stats);
+	} else {
+		// Overwrites the oldest query
+		mQueries[mNext] = stats;
+	}
+	mNext = (mNext + 1) % mWindow;
+	++mTotalCount;
+}
+
+void SearchStatsHistory::Clear() {
+	mQueries.clear();
+	mNext = 0;
+	mTotalCount = 0;
+}
+
+SearchStats SearchStatsHistory::GetMean() const {
+	SearchStats sum;
+	for (const SearchStats& stats : mQueries) {
+		sum.Add(stats);
+	}
+	SearchStats mean;
+	if (!mQueries.empty()) {
+		unsigned int count = static_cast<unsigned int>(mQueries.size());
+		mean.expanded = sum.expanded / count;
+		mean.generated = sum.generated / count;
+		mean.reopened = sum.reopened / count;
+		mean.heuristicEvaluations = sum.heuristicEvaluations / count;
+		mean.openListPeak = sum.openListPeak / count;
+		mean.microseconds = sum.microseconds / count;
+		mean.allocatedBytes = sum.allocatedBytes / count;
+	}
+	return mean;
+}
+
+SearchStats SearchStatsHistory::GetMax() const {
+	SearchStats max;
+	for (const SearchStats& stats : mQueries) {
+		max.Max(stats);
+	}
+	return max;
+}
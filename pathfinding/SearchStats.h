@@ -0,0 +1,49 @@
+#ifndef __SEARCHSTATS_H__
+#define __SEARCHSTATS_H__
+
+#include <vector>
+
+// Counters of one query, to tell why it was slow
+struct SearchStats {
+	unsigned int expanded;
+	// Nodes pushed to the open list, reopened ones included
+	unsigned int generated;
+	// Closed nodes reached again with a smaller cost
+	unsigned int reopened;
+	unsigned int heuristicEvaluations;
+	unsigned int openListPeak;
+	// Time spent in the search, over every step it took
+	double microseconds;
+	// Bytes allocated by the search context during the query
+	size_t allocatedBytes;
+
+	SearchStats() { Clear(); }
+	void Clear();
+	void Add(const SearchStats& other);
+	void Max(const SearchStats& other);
+};
+
+// Rolling aggregates of the last queries, kept in a ring of fixed size
+class SearchStatsHistory {
+public:
+	static const size_t DEFAULT_WINDOW;
+
+	explicit SearchStatsHistory(size_t window = DEFAULT_WINDOW);
+
+	void Add(const SearchStats& stats);
+	void Clear();
+
+	// Queries in the window and queries added since the last Clear()
+	size_t GetCount() const { return mQueries.size(); }
+	unsigned long long GetTotalCount() const { return mTotalCount; }
+	SearchStats GetMean() const;
+	SearchStats GetMax() const;
+
+private:
+	size_t mWindow;
+	std::vector<SearchStats> mQueries;
+	size_t mNext;
+	unsigned long long mTotalCount;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#include <stdafx.h>
+
+#include "SpecializedAStar.h"
+
+AStarVariants::AStarVariants(const CostGrid& grid, SearchContext& context) :
+	mAstar4(grid, context),
+	mAstar8(grid, context),
+	mAstar8Single(grid, context),
+	mAstar8Always(grid, context)
+{
+}
+
+AStarSearch& AStarVariants::Get(GridTopology::Connectivity connectivity, GridTopology::CornerCutting cornerCutting) {
+	return const_cast<AStarSearch&>(static_cast<const AStarVariants*>(this)->Get(connectivity, cornerCutting));
+}
+
+const AStarSearch& AStarVariants::Get(GridTopology::Connectivity connectivity, GridTopology::CornerCutting cornerCutting) const {
+	if (GridTopology::CONNECTIVITY_4 == connectivity) {
+		return mAstar4;
+	}
+	if (GridTopology::CUT_CORNERS_SINGLE == cornerCutting) {
+		return mAstar8Single;
+	}
+	if (GridTopology::CUT_CORNERS_ALWAYS == cornerCutting) {
+		return mAstar8Always;
+	}
+	return mAstar8;
+}
@@ -0,0 +1,179 @@
+#ifndef __SPECIALIZEDASTAR_H__
+#define __SPECIALIZEDASTAR_H__
+
+#include "AStarSearch.h"
+
+// Neighbour policy of a grid with the movement fixed at compile time. The moves are
+// written out one by one in the order of GridTopology, so there is no direction loop
+// and no weight lookup left, and the diagonal moves vanish from 4-connected searches.
+template <GridTopology::Connectivity CONNECTIVITY, GridTopology::CornerCutting CORNER_CUTTING>
+struct GridNeighbours {
+	static GridTopology::Connectivity GetConnectivity() { return CONNECTIVITY; }
+	static GridTopology::CornerCutting GetCornerCutting() { return CORNER_CUTTING; }
+	static const int STRAIGHT_WEIGHT = GridTopology::CONNECTIVITY_4 == CONNECTIVITY ? 1 : GridTopology::STRAIGHT_WEIGHT;
+
+	// Calls visitor(index, weight) for every walkable neighbour of a cell inside the grid
+	template <class Visitor>
+	static void Visit(const CostGrid& grid, int index, Visitor& visitor) {
+		int stride = grid.GetStride();
+		bool right = grid.IsWalkable(index + 1);
+		bool down = grid.IsWalkable(index + stride);
+		bool left = grid.IsWalkable(index - 1);
+		bool up = grid.IsWalkable(index - stride);
+		if (right) {
+			visitor(index + 1, STRAIGHT_WEIGHT);
+		}
+		if (down) {
+			visitor(index + stride, STRAIGHT_WEIGHT);
+		}
+		if (left) {
+			visitor(index - 1, STRAIGHT_WEIGHT);
+		}
+		if (up) {
+			visitor(index - stride, STRAIGHT_WEIGHT);
+		}
+		if (GridTopology::CONNECTIVITY_8 == CONNECTIVITY) {
+			VisitDiagonal(grid, index + stride + 1, right, down, visitor);
+			VisitDiagonal(grid, index + stride - 1, down, left, visitor);
+			VisitDiagonal(grid, index - stride - 1, left, up, visitor);
+			VisitDiagonal(grid, index - stride + 1, up, right, visitor);
+		}
+	}
+
+private:
+	template <class Visitor>
+	static void VisitDiagonal(const CostGrid& grid, int next, bool firstWalkable, bool secondWalkable, Visitor& visitor) {
+		if (GridTopology::CanCutCorner(CORNER_CUTTING, firstWalkable, secondWalkable) && grid.IsWalkable(next)) {
+			visitor(next, GridTopology::DIAGONAL_WEIGHT);
+		}
+	}
+};
+
+// Heuristic policy: Manhattan or octile distance to the end, scaled by the lowest cost
+// of the grid. Heuristics are objects so that they can keep data of the query.
+template <GridTopology::Connectivity CONNECTIVITY>
+class GridDistanceHeuristic {
+public:
+	GridDistanceHeuristic() : mGrid(nullptr), mScale(1) {}
+
+	void Begin(const CostGrid& grid, int endIndex) {
+		mGrid = &grid;
+		mEnd = grid.GetNode(endIndex);
+		mScale = grid.GetMinCost();
+	}
+	int GetDistance(int index) const {
+		GridNode node = mGrid->GetNode(index);
+		return GridTopology::GetDistance(CONNECTIVITY, mEnd.x - node.x, mEnd.y - node.y) * mScale;
+	}
+
+private:
+	const CostGrid* mGrid;
+	GridNode mEnd;
+	int mScale;
+};
+
+// AStarSearch with the neighbours and the heuristic given at compile time. The inner loop
+// of Step() calls no virtual function and reads no movement settings, the compiler can
+// inline the whole expansion of a node. Queries return the same paths as an AStarSearch
+// with the same movement, SetMovement() must not be called on it.
+template <class Neighbours, class Heuristic>
+class SpecializedAStar : public AStarSearch {
+public:
+	SpecializedAStar(const CostGrid& grid, SearchContext& context) : AStarSearch(grid, context) {
+		SetMovement(Neighbours::GetConnectivity(), Neighbours::GetCornerCutting());
+	}
+
+	virtual void Begin(const GridNode& start, const GridNode& end);
+	virtual Status Step(unsigned int maxExpansions);
+
+	Heuristic& GetHeuristic() { return mHeuristic; }
+
+private:
+	Heuristic mHeuristic;
+};
+
+template <class Neighbours, class Heuristic>
+void SpecializedAStar<Neighbours, Heuristic>::Begin(const GridNode& start, const GridNode& end) {
+	AStarSearch::Begin(start, end);
+	if (!IsRunning()) {
+		return;
+	}
+	// The start node is alone on the open list, its key is replaced with the one of the heuristic
+	mHeuristic.Begin(mGrid, mEndIndex);
+	int startIndex = mGrid.GetIndex(start);
+	PathNode& startNode = mContext.GetNode(startIndex);
+	startNode.h = mHeuristic.GetDistance(startIndex);
+	mContext.UpdateOpen(startIndex, OpenList::MakeKey(startNode.g + startNode.h, startNode.h));
+}
+
+template <class Neighbours, class Heuristic>
+AStarSearch::Status SpecializedAStar<Neighbours, Heuristic>::Step(unsigned int maxExpansions) {
+	int index = -1;
+	int g = 0;
+	auto relax = [&](int nextIndex, int weight) {
+		int cost = g + mGrid.GetCost(nextIndex) * weight;
+		bool visited = mContext.IsVisited(nextIndex);
+		PathNode& nextPathNode = mContext.Visit(nextIndex);
+		if (visited) {
+			if (cost >= nextPathNode.g) {
+				return;
+			}
+		} else {
+			nextPathNode.h = mHeuristic.GetDistance(nextIndex);
+			++mStats.heuristicEvaluations;
+		}
+
+		nextPathNode.g = cost;
+		nextPathNode.parent = index;
+		OpenList::Key key = OpenList::MakeKey(nextPathNode.g + nextPathNode.h, nextPathNode.h);
+		if (mContext.IsOpen(nextIndex)) {
+			mContext.UpdateOpen(nextIndex, key);
+		} else {
+			mStats.reopened += visited;
+			mContext.PushOpen(nextIndex, key);
+			++mStats.generated;
+		}
+	};
+
+	for (unsigned int expansions = 0; mStatus == SEARCH_RUNNING && expansions < maxExpansions; ++expansions) {
+		if (mContext.IsOpenListEmpty()) {
+			mStatus = SEARCH_FAILED;
+			break;
+		}
+
+		index = mContext.PopOpen();
+		++mStats.expanded;
+		if (index == mEndIndex) {
+			mStatus = SEARCH_FOUND;
+			break;
+		}
+
+		g = mContext.GetNode(index).g;
+		Neighbours::Visit(mGrid, index, relax);
+		mStats.openListPeak = std::max(mStats.openListPeak, static_cast<unsigned int>(mContext.GetOpenListSize()));
+	}
+	return mStatus;
+}
+
+typedef SpecializedAStar<GridNeighbours<GridTopology::CONNECTIVITY_4, GridTopology::CUT_CORNERS_NEVER>, GridDistanceHeuristic<GridTopology::CONNECTIVITY_4>> AStarSearch4;
+typedef SpecializedAStar<GridNeighbours<GridTopology::CONNECTIVITY_8, GridTopology::CUT_CORNERS_NEVER>, GridDistanceHeuristic<GridTopology::CONNECTIVITY_8>> AStarSearch8;
+typedef SpecializedAStar<GridNeighbours<GridTopology::CONNECTIVITY_8, GridTopology::CUT_CORNERS_SINGLE>, GridDistanceHeuristic<GridTopology::CONNECTIVITY_8>> AStarSearch8Single;
+typedef SpecializedAStar<GridNeighbours<GridTopology::CONNECTIVITY_8, GridTopology::CUT_CORNERS_ALWAYS>, GridDistanceHeuristic<GridTopology::CONNECTIVITY_8>> AStarSearch8Always;
+
+// One specialized A* for every movement of GridTopology, sharing a search context, so the
+// movement can still be chosen at runtime
+class AStarVariants {
+public:
+	AStarVariants(const CostGrid& grid, SearchContext& context);
+
+	AStarSearch& Get(GridTopology::Connectivity connectivity, GridTopology::CornerCutting cornerCutting);
+	const AStarSearch& Get(GridTopology::Connectivity connectivity, GridTopology::CornerCutting cornerCutting) const;
+
+private:
+	AStarSearch4 mAstar4;
+	AStarSearch8 mAstar8;
+	AStarSearch8Single mAstar8Single;
+	AStarSearch8Always mAstar8Always;
+};
+
+#endif
@@ -0,0 +1,123 @@
+#include <stdafx.h>
+
+#include "ThreadPool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(unsigned int threadCount) :
+	mFunction(nullptr),
+	mJob(0),
+	mPendingChunks(0),
+	mBusyWorkers(0),
+	mStopping(false)
+{
+	if (threadCount == 0) {
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	for (unsigned int i = 0; i < threadCount; ++i) {
+		mQueues.push_back(new WorkQueue());
+	}
+	// Worker 0 is the thread calling ParallelFor()
+	for (unsigned int i = 1; i < threadCount; ++i) {
+		mThreads.push_back(std::thread(&ThreadPool::WorkerLoop, this, i));
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mWorkReady.notify_all();
+	for (std::thread& thread : mThreads) {
+		thread.join();
+	}
+	for (WorkQueue* queue : mQueues) {
+		delete queue;
+	}
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grainSize, const RangeFunction& function) {
+	if (count == 0) {
+		return;
+	}
+	grainSize = std::max<size_t>(grainSize, 1);
+
+	// Deals the chunks round robin so every worker starts with local work
+	size_t numChunks = 0;
+	for (size_t begin = 0; begin < count; begin += grainSize, ++numChunks) {
+		Chunk chunk = { begin, std::min(begin + grainSize, count) };
+		WorkQueue& queue = *mQueues[numChunks % mQueues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.chunks.push_back(chunk);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mFunction = &function;
+		mPendingChunks = numChunks;
+		mBusyWorkers = static_cast<unsigned int>(mThreads.size());
+		++mJob;
+	}
+	mWorkReady.notify_all();
+
+	RunChunks(0);
+
+	// Waits for the other workers to leave the job before the function goes out of scope
+	std::unique_lock<std::mutex> lock(mMutex);
+	mWorkDone.wait(lock, [this]() { return mBusyWorkers == 0; });
+	mFunction = nullptr;
+}
+
+void ThreadPool::WorkerLoop(unsigned int worker) {
+	unsigned int lastJob = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mWorkReady.wait(lock, [this, lastJob]() { return mStopping || mJob != lastJob; });
+			if (mStopping) {
+				return;
+			}
+			lastJob = mJob;
+		}
+
+		RunChunks(worker);
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (--mBusyWorkers == 0) {
+			mWorkDone.notify_all();
+		}
+	}
+}
+
+void ThreadPool::RunChunks(unsigned int worker) {
+	Chunk chunk;
+	while (mPendingChunks > 0 && PopChunk(worker, chunk)) {
+		(*mFunction)(chunk.begin, chunk.end, worker);
+		--mPendingChunks;
+	}
+}
+
+bool ThreadPool::PopChunk(unsigned int worker, Chunk& chunk) {
+	// Own queue first, from the back
+	{
+		WorkQueue& queue = *mQueues[worker];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.chunks.empty()) {
+			chunk = queue.chunks.back();
+			queue.chunks.pop_back();
+			return true;
+		}
+	}
+	// Then steals from the front of the other queues
+	size_t numQueues = mQueues.size();
+	for (size_t i = 1; i < numQueues; ++i) {
+		WorkQueue& queue = *mQueues[(worker + i) % numQueues];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (!queue.chunks.empty()) {
+			chunk = queue.chunks.front();
+			queue.chunks.pop_front();
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,58 @@
+#ifndef __THREADPOOL_H__
+#define __THREADPOOL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool for data parallel loops. ParallelFor() splits a range in
+// chunks dealt to per-worker queues; a worker takes chunks from the back of its own
+// queue and, once empty, steals from the front of the others. The calling thread works
+// as worker 0, so a pool of one thread runs everything inline.
+class ThreadPool {
+public:
+	// Receives the chunk [begin, end) and the index of the worker running it
+	typedef std::function<void(size_t begin, size_t end, unsigned int worker)> RangeFunction;
+
+	// A thread count of 0 uses one thread per hardware thread
+	explicit ThreadPool(unsigned int threadCount = 0);
+	~ThreadPool();
+
+	unsigned int GetThreadCount() const { return static_cast<unsigned int>(mQueues.size()); }
+
+	// Runs the function over [0, count) in chunks of grainSize and waits for all of them
+	void ParallelFor(size_t count, size_t grainSize, const RangeFunction& function);
+
+private:
+	struct Chunk {
+		size_t begin;
+		size_t end;
+	};
+
+	struct WorkQueue {
+		std::mutex mutex;
+		std::deque<Chunk> chunks;
+	};
+
+	void WorkerLoop(unsigned int worker);
+	void RunChunks(unsigned int worker);
+	bool PopChunk(unsigned int worker, Chunk& chunk);
+
+	std::vector<WorkQueue*> mQueues;
+	std::vector<std::thread> mThreads;
+
+	std::mutex mMutex;
+	std::condition_variable mWorkReady;
+	std::condition_variable mWorkDone;
+	const RangeFunction* mFunction;
+	unsigned int mJob;
+	std::atomic<size_t> mPendingChunks;
+	unsigned int mBusyWorkers;
+	bool mStopping;
+};
+
+#endif
@@ -1,223 +1,583 @@
 #include <stdafx.h>
 
 #include "pathfinder.h"
+#include "PathBuffer.h"
+#include <moaicore/MOAILuaRuntime.h>
 #include <algorithm>
-#include <functional>
+#include <chrono>
 
-const int Pathfinder::NUM_DIRECTIONS = 4;
-const int Pathfinder::dirX[NUM_DIRECTIONS] = { 1, 0, -1,  0 };
-const int Pathfinder::dirY[NUM_DIRECTIONS] = { 0, 1,  0, -1 };
+// Expansions done between two reads of the clock when a step has a time budget
+const unsigned int Pathfinder::TIME_CHECK_EXPANSIONS = 64;
+const int Pathfinder::DEFAULT_CLUSTER_SIZE = 16;
+const size_t Pathfinder::DEFAULT_CACHE_SIZE = 64;
+const size_t Pathfinder::DEFAULT_FLOW_FIELDS = 4;
+const int Pathfinder::DEFAULT_LANDMARKS = 8;
 
 Pathfinder::Pathfinder() : MOAIEntity2D(),
-	mGridRows(0),
-	mGridCols(0)
-
+	mAstar(mGrid, mSearch),
+	mJps(mGrid, mSearch),
+	mBidirectional(mGrid, mSearch, mReverseSearch),
+	mLandmarkCount(DEFAULT_LANDMARKS),
+	mLandmarkSelection(LandmarkTable::SELECT_AVOID),
+	mAlt4(mGrid, mSearch),
+	mAlt8(mGrid, mSearch),
+	mSearchMode(SEARCH_ASTAR),
+	mConnectivity(GridTopology::CONNECTIVITY_4),
+	mCornerCutting(GridTopology::CUT_CORNERS_NEVER),
+	mClusterSize(DEFAULT_CLUSTER_SIZE),
+	mRetarget(false),
+	mAnyAngle(false),
+	mFlowFields(DEFAULT_FLOW_FIELDS),
+	mDStar(mGrid),
+	mWorldSearch(mWorld),
+	mBatchPathfinder(nullptr),
+	mJobQueue(nullptr),
+	mPathCache(DEFAULT_CACHE_SIZE),
+	mHasQuery(false),
+	mQueryStartCell(-1),
+	mQueryEndCell(-1),
+	mQueryMode(SEARCH_ASTAR),
+	mQueryVersion(0),
+	mPathRequested(false),
+	mStepNodeBudget(256),
+	mStepTimeBudget(0),
+	mQueryAllocatedBytes(0),
+	mDrawExpanded(false)
 {
 	RTTI_BEGIN
 		RTTI_EXTEND(MOAIEntity2D)
 	RTTI_END
 
-	ReadPath("grid.txt", "pathcost.txt");
+	mAlt4.GetHeuristic().SetTable(&mLandmarks);
+	mAlt8.GetHeuristic().SetTable(&mLandmarks);
+	LoadTextGrid("grid.txt", "pathcost.txt");
 }
 
 Pathfinder::~Pathfinder()
 {
-
+	delete mBatchPathfinder;
+	CancelAllRequests();
+	delete mJobQueue;
 }
 
 void Pathfinder::UpdatePath()
 {
+	bool inside = mGrid.IsInside(mStartNode) && mGrid.IsInside(mEndNode);
+	int startCell = inside ? mGrid.GetIndex(mStartNode) : -1;
+	int endCell = inside ? mGrid.GetIndex(mEndNode) : -1;
+	if (mHasQuery && startCell == mQueryStartCell && endCell == mQueryEndCell && mSearchMode == mQueryMode && mGrid.GetVersion() == mQueryVersion) {
+		// Same cells as the current query, its path or pending search is still valid
+		return;
+	}
+
+	mHasQuery = true;
+	mQueryStartCell = startCell;
+	mQueryEndCell = endCell;
+	mQueryMode = mSearchMode;
+	mQueryVersion = mGrid.GetVersion();
+
+	GetSearch().Cancel();
+	mPathRequested = false;
+	mTargetNode = mEndNode;
+	int targetCell = endCell;
+	if (inside) {
+		targetCell = FindTargetCell(startCell, endCell);
+		if (targetCell < 0) {
+			mPath.clear();
+			mWaypoints.clear();
+			return;
+		}
+		mTargetNode = mGrid.GetNode(targetCell);
+	}
+	if (inside && mPathCache.Find(startCell, targetCell, mSearchMode, mQueryVersion, mStartNode, mPath)) {
+		BuildWaypoints();
+		return;
+	}
+
+	// The search is only queued, PathfindStep() runs it
 	mPath.clear();
-	Astar();
+	mWaypoints.clear();
+	mPathRequested = true;
 }
 
-void Pathfinder::ReadPath(const char* gridFilename, const char* pathCostFilename)
+int Pathfinder::FindTargetCell(int startCell, int endCell)
 {
-	std::ifstream pathCostFile(pathCostFilename, std::ios::binary);
-	if (pathCostFile.is_open()) {
+	// An end out of the component of the start has no path, the query is answered without
+	// searching or retargeted to the cell of that component nearest to the end
+	if (!mComponents.IsCurrent(mGrid)) {
+		mComponents.Build(mGrid, mConnectivity, mCornerCutting);
+	}
+	if (mComponents.AreConnected(startCell, endCell)) {
+		return endCell;
+	}
+	return mRetarget && mGrid.IsWalkable(startCell) ? mComponents.FindNearest(mGrid, endCell, mComponents.GetComponent(startCell)) : -1;
+}
 
-		std::map<char, int> pathCosts;
+void Pathfinder::StorePath()
+{
+	if (mQueryStartCell >= 0 && mQueryVersion == mGrid.GetVersion()) {
+		mPathCache.Store(mQueryStartCell, mGrid.GetIndex(mTargetNode), mQueryMode, mQueryVersion, mPath);
+	}
+}
 
-		std::string line;
-		char key;
-		std::string value;
-		while (!pathCostFile.eof()) {
-			std::getline(pathCostFile, line);
-			int index = line.find('=', 0);
-			// Assuming each cost is represented by only one char
-			key = line.substr(0, index)[0];
-			value = line.substr(index + 1);
-			value.erase(std::remove(value.begin(), value.end(), '\r'), value.end());
-			value.erase(std::remove(value.begin(), value.end(), '\n'), value.end());
-			pathCosts[key] = std::stoi(value);
-		}
+void Pathfinder::BuildWaypoints()
+{
+	if (mAnyAngle) {
+		mSmoother.Smooth(mGrid, mPath, mWaypointCells);
+	} else {
+		PathSmoother::Compress(mPath, mWaypointCells);
+	}
+	mWaypoints.clear();
+	for (const GridNode& node : mWaypointCells) {
+		mWaypoints.push_back(GetScreenPositionFromNode(node));
+	}
+}
 
-		std::ifstream pathFile(gridFilename, std::ios::binary);
-		if (pathFile.is_open()) {
-			std::string line;
-			size_t lineIndex = 0;
-			while (!pathFile.eof()) {
-				std::getline(pathFile, line);
-				line.erase(std::remove(line.begin(), line.end(), '\r'), line.end());
-				line.erase(std::remove(line.begin(), line.end(), '\n'), line.end());
-				size_t lineLength = line.length();
-				if (mGridCols != lineLength) {
-					mGridCols = lineLength;
-				}
-				for (size_t i = 0; i < lineLength; ++i) {
-					if (pathCosts.end() != pathCosts.find(line[i])) {
-						mGrid[GridNode(i, lineIndex)] = pathCosts[line[i]];
-					} else {
-						// Unreachable position
-						mGrid[GridNode(i, lineIndex)] = -1;
-					}
-				}
-				++lineIndex;
-				mGridRows = lineIndex;
-			}
-		}
+void Pathfinder::SetAnyAngle(bool anyAngle)
+{
+	mAnyAngle = anyAngle;
+	if (mJobQueue) {
+		mJobQueue->SetAnyAngle(anyAngle);
 	}
+	BuildWaypoints();
 }
 
-void Pathfinder::Astar()
+void Pathfinder::SetSearchMode(SearchMode searchMode)
 {
-	if (IsGridNodeValid(mStartNode) && IsGridNodeValid(mEndNode) && !mStartNode.Compare(mEndNode)) {
-		std::vector<PathNode*> openList;
-		std::vector<PathNode*> closedList;
+	if (mSearchMode != searchMode) {
+		GetSearch().Cancel();
+		mSearchMode = searchMode;
+		UpdateLandmarks();
+		UpdatePath();
+	}
+}
+
+void Pathfinder::SetMovement(GridTopology::Connectivity connectivity, GridTopology::CornerCutting cornerCutting)
+{
+	GetSearch().Cancel();
+	mConnectivity = connectivity;
+	mCornerCutting = cornerCutting;
+	mJps.SetMovement(connectivity, cornerCutting);
+	mBidirectional.SetMovement(connectivity, cornerCutting);
+	mComponents.Build(mGrid, connectivity, cornerCutting);
+	if (mBatchPathfinder) {
+		mBatchPathfinder->SetMovement(connectivity, cornerCutting);
+	}
+	if (mJobQueue) {
+		mJobQueue->SetMovement(connectivity, cornerCutting);
+	}
+	// Cached paths were searched with the previous moves
+	mPathCache.Clear();
+	UpdateLandmarks();
+	mHasQuery = false;
+	UpdatePath();
+}
 
-		PathNode* pathNode = new PathNode(mStartNode, 0, CalculateDistance(mStartNode));
-		openList.push_back(pathNode);
-		bool existPath = false;
-		while (!openList.empty()) {
-			std::sort(openList.begin(), openList.end(), &Pathfinder::PathNodeSort);
+void Pathfinder::SetRetarget(bool retarget)
+{
+	mRetarget = retarget;
+	mHasQuery = false;
+	UpdatePath();
+}
 
-			pathNode = openList.front();
-			openList.erase(openList.begin());
-			closedList.push_back(pathNode);
+void Pathfinder::SetClusterSize(int clusterSize)
+{
+	mClusterSize = clusterSize;
+	mClusterGraph.Build(mGrid, mClusterSize);
+	// Hierarchical paths depend on the clusters
+	mPathCache.Clear();
+	if (SEARCH_HIERARCHICAL == mSearchMode) {
+		mHasQuery = false;
+		UpdatePath();
+	}
+}
 
-			if (mEndNode.Compare(pathNode->node)) {
-				// Node is the end node
-				BuildPath(*pathNode);
-				return;
-			} else {
-				// Node is not the end node
-				std::vector<PathNode*> connections;
-				GetNodeConnections(*pathNode, connections);
-				for (PathNode* nextPathNode : connections) {
-					auto& closedListNodeFound = std::find_if(closedList.begin(), closedList.end(), std::bind(&PathNode::CompareNodePointer, std::placeholders::_1, nextPathNode));
-					if (closedList.end() != closedListNodeFound) {
-						// Node already on closedList. Checking if cost is smaller to remove it and add to open list.
-						if (nextPathNode->g + nextPathNode->h < (*closedListNodeFound)->g + (*closedListNodeFound)->h) {
-							// Removing node from closedList
-							closedList.erase(closedListNodeFound);
-							// Adding the pathNode to openList
-							openList.push_back(nextPathNode);
-						}
-						else {
-							continue;
-						}
-					} else {
-
-						auto& openListNodeFound = std::find_if(openList.begin(), openList.end(), std::bind(&PathNode::CompareNodePointer, std::placeholders::_1, nextPathNode));
-						if (openList.end() != openListNodeFound) {
-							// Change cost and parent if cost is smaller
-							if (nextPathNode->g + nextPathNode->h < (*openListNodeFound)->g + (*openListNodeFound)->h) {
-								(*openListNodeFound)->g = nextPathNode->g;
-								(*openListNodeFound)->h = nextPathNode->h;
-								(*openListNodeFound)->parent = nextPathNode->parent;
-							}
-
-							// Releasing the node memory as it is nor in openList neither in closedList
-							delete nextPathNode;
-						} else {
-							// Adding the pathNode to openList
-							openList.push_back(nextPathNode);
-						}
-					}
-				}
-			}
+void Pathfinder::SetLandmarks(int landmarkCount, LandmarkTable::Selection selection)
+{
+	GetSearch().Cancel();
+	mLandmarkCount = std::max(1, std::min(landmarkCount, LandmarkTable::MAX_LANDMARKS));
+	mLandmarkSelection = selection;
+	mLandmarks.Clear();
+	UpdateLandmarks();
+	if (SEARCH_LANDMARKS == mSearchMode) {
+		mHasQuery = false;
+		UpdatePath();
+	}
+}
+
+void Pathfinder::UpdateLandmarks()
+{
+	if (SEARCH_LANDMARKS != mSearchMode || mGrid.IsEmpty() || (GridTopology::CONNECTIVITY_8 == mConnectivity && GridTopology::CUT_CORNERS_NEVER != mCornerCutting)) {
+		return;
+	}
+	if (mLandmarks.IsCurrent(mGrid, mConnectivity)) {
+		return;
+	}
+	// Edits keep the landmarks and only recompute their costs, the table is built again for
+	// another grid or other moves
+	if (mLandmarks.IsBuilt() && mLandmarks.GetConnectivity() == mConnectivity) {
+		mLandmarks.Refresh(mGrid, GetBatchPathfinder().GetThreadPool());
+	} else {
+		mLandmarks.Build(mGrid, mConnectivity, mLandmarkCount, mLandmarkSelection, GetBatchPathfinder().GetThreadPool());
+	}
+}
+
+BatchPathfinder& Pathfinder::GetBatchPathfinder()
+{
+	if (!mBatchPathfinder) {
+		mBatchPathfinder = new BatchPathfinder(mGrid);
+		mBatchPathfinder->SetMovement(mConnectivity, mCornerCutting);
+	}
+	return *mBatchPathfinder;
+}
+
+void Pathfinder::FindPaths(const PathQuery* queries, size_t count, PathBatch& batch)
+{
+	BatchPathfinder::Algorithm algorithm = SEARCH_JPS == mSearchMode ? BatchPathfinder::ALGORITHM_JPS : BatchPathfinder::ALGORITHM_ASTAR;
+	GetBatchPathfinder().FindPaths(queries, count, batch, algorithm);
+}
+
+PathJobQueue& Pathfinder::GetJobQueue()
+{
+	if (!mJobQueue) {
+		mJobQueue = new PathJobQueue();
+		mJobQueue->SetMovement(mConnectivity, mCornerCutting);
+		mJobQueue->SetAnyAngle(mAnyAngle);
+	}
+	return *mJobQueue;
+}
+
+unsigned int Pathfinder::RequestPath(const USVec2D& startPosition, const USVec2D& endPosition, int priority)
+{
+	// Ends that can not be reached are known on the main thread, their result needs no search
+	GridNode start = GetNodeFromScreenPosition(startPosition);
+	GridNode end = GetNodeFromScreenPosition(endPosition);
+	if (!mGrid.IsInside(start) || !mGrid.IsInside(end)) {
+		return GetJobQueue().SubmitFailed();
+	}
+	int targetCell = FindTargetCell(mGrid.GetIndex(start), mGrid.GetIndex(end));
+	if (targetCell < 0) {
+		return GetJobQueue().SubmitFailed();
+	}
+	return GetJobQueue().Submit(mGrid, start, mGrid.GetNode(targetCell), priority);
+}
+
+bool Pathfinder::CancelRequest(unsigned int id)
+{
+	if (!mJobQueue || !mJobQueue->Cancel(id)) {
+		return false;
+	}
+	auto callback = mRequestCallbacks.find(id);
+	if (callback != mRequestCallbacks.end()) {
+		MOAIScopedLuaState state = MOAILuaRuntime::Get().State();
+		luaL_unref(state, LUA_REGISTRYINDEX, callback->second);
+		mRequestCallbacks.erase(callback);
+	}
+	return true;
+}
+
+void Pathfinder::CancelAllRequests()
+{
+	if (mJobQueue) {
+		mJobQueue->CancelAll();
+	}
+	if (mRequestCallbacks.empty()) {
+		return;
+	}
+	MOAIScopedLuaState state = MOAILuaRuntime::Get().State();
+	for (const auto& callback : mRequestCallbacks) {
+		luaL_unref(state, LUA_REGISTRYINDEX, callback.second);
+	}
+	mRequestCallbacks.clear();
+}
+
+PathJobStats Pathfinder::GetRequestStats() const
+{
+	return mJobQueue ? mJobQueue->GetStats() : PathJobStats();
+}
+
+void Pathfinder::DeliverRequests()
+{
+	if (!mJobQueue) {
+		return;
+	}
+	mRequestResults.clear();
+	mJobQueue->PollResults(mRequestResults);
+	if (mRequestResults.empty()) {
+		return;
+	}
+
+	// Each callback gets the id of its request, whether a path was found, the waypoints as a
+	// flat list of screen coordinates and the nodes expanded
+	MOAIScopedLuaState state = MOAILuaRuntime::Get().State();
+	for (const PathJobResult& result : mRequestResults) {
+		auto callback = mRequestCallbacks.find(result.id);
+		if (callback == mRequestCallbacks.end()) {
+			continue;
 		}
-		
-		// Releasing memory for stored nodes
-		for (PathNode* toDelete : openList) {
-			delete toDelete;
+		lua_rawgeti(state, LUA_REGISTRYINDEX, callback->second);
+		luaL_unref(state, LUA_REGISTRYINDEX, callback->second);
+		mRequestCallbacks.erase(callback);
+
+		state.Push(result.id);
+		state.Push(result.found);
+		lua_createtable(state, static_cast<int>(result.waypoints.size() * 2), 0);
+		int index = 1;
+		for (const GridNode& waypoint : result.waypoints) {
+			USVec2D position = GetScreenPositionFromNode(waypoint);
+			lua_pushnumber(state, position.mX);
+			lua_rawseti(state, -2, index++);
+			lua_pushnumber(state, position.mY);
+			lua_rawseti(state, -2, index++);
 		}
-		for (PathNode* toDelete : closedList) {
-			delete toDelete;
+		state.Push(result.expanded);
+		if (lua_pcall(state, 4, 0, 0) != 0) {
+			printf("requestPath callback: %s\n", lua_tostring(state, -1));
+			lua_pop(state, 1);
 		}
 	}
 }
 
-void Pathfinder::GetNodeConnections(const PathNode& pathNode, std::vector<PathNode*>& connections) {
-	connections.clear();
+bool Pathfinder::GetFlowDirection(const USVec2D& goalPosition, const USVec2D& position, USVec2D& direction)
+{
+	direction = USVec2D(0.0f, 0.0f);
+	GridNode goal = GetNodeFromScreenPosition(goalPosition);
+	GridNode node = GetNodeFromScreenPosition(position);
+	if (!mGrid.IsInside(goal) || !mGrid.IsInside(node)) {
+		return false;
+	}
 
-	for (int i = 0; i < NUM_DIRECTIONS; ++i) {
-		GridNode nextNode(pathNode.node.x + dirX[i], pathNode.node.y + dirY[i]);
-		if (IsGridNodeValid(nextNode)) {
-			int cost = pathNode.g + mGrid[nextNode];
-			connections.push_back(new PathNode(nextNode, cost, CalculateDistance(nextNode), &pathNode));
+	const FlowField& field = mFlowFields.GetField(mGrid, goal);
+	int flowDirection = field.GetDirection(node);
+	if (FlowField::NO_DIRECTION != flowDirection) {
+		direction = USVec2D(static_cast<float>(GridTopology::dirX[flowDirection]), static_cast<float>(GridTopology::dirY[flowDirection]));
+	}
+	return field.GetIntegration(node) != FlowField::UNREACHABLE;
+}
+
+void Pathfinder::GetFlowDirections(const USVec2D& goalPosition, const USVec2D* positions, size_t count, USVec2D* directions)
+{
+	std::fill(directions, directions + count, USVec2D(0.0f, 0.0f));
+	GridNode goal = GetNodeFromScreenPosition(goalPosition);
+	if (!mGrid.IsInside(goal)) {
+		return;
+	}
+
+	const FlowField& field = mFlowFields.GetField(mGrid, goal);
+	for (size_t i = 0; i < count; ++i) {
+		int flowDirection = field.GetDirection(GetNodeFromScreenPosition(positions[i]));
+		if (FlowField::NO_DIRECTION != flowDirection) {
+			directions[i] = USVec2D(static_cast<float>(GridTopology::dirX[flowDirection]), static_cast<float>(GridTopology::dirY[flowDirection]));
 		}
 	}
 }
 
-bool Pathfinder::IsGridNodeValid(const GridNode& node) const {
-	// Returns true if the node is within the limits of the grid and has a valid cost (reachable node)
-	return node.x >= 0 && node.y >= 0 && node.x < static_cast<int>(mGridCols) && node.y < static_cast<int>(mGridRows) && mGrid.end() != mGrid.find(node) && mGrid.at(node) >= 0;
+unsigned int Pathfinder::GetExpandedCount() const
+{
+	if (SEARCH_HIERARCHICAL == mSearchMode) {
+		return mClusterGraph.GetExpandedCount();
+	}
+	return SEARCH_DSTAR == mSearchMode ? mDStar.GetExpandedCount() : GetSearch().GetExpandedCount();
 }
 
-void Pathfinder::BuildPath(const PathNode& lastNode) {
-	mPath.clear();
-	mPath.push_back(lastNode.node);
-	const PathNode* parentNode = lastNode.parent;
-	while (parentNode) {
-		mPath.push_back(parentNode->node);
-		parentNode = parentNode->parent;
+bool Pathfinder::IsGridSearchMode() const
+{
+	return SEARCH_ASTAR == mSearchMode || SEARCH_JPS == mSearchMode || SEARCH_BIDIRECTIONAL == mSearchMode || SEARCH_LANDMARKS == mSearchMode;
+}
+
+AStarSearch& Pathfinder::GetSearch()
+{
+	if (SEARCH_BIDIRECTIONAL == mSearchMode) {
+		return mBidirectional;
+	}
+	if (SEARCH_LANDMARKS == mSearchMode && GridTopology::CONNECTIVITY_4 == mConnectivity) {
+		return mAlt4;
+	}
+	if (SEARCH_LANDMARKS == mSearchMode && GridTopology::CUT_CORNERS_NEVER == mCornerCutting) {
+		return mAlt8;
+	}
+	return SEARCH_JPS == mSearchMode ? static_cast<AStarSearch&>(mJps) : mAstar.Get(mConnectivity, mCornerCutting);
+}
+
+const AStarSearch& Pathfinder::GetSearch() const
+{
+	if (SEARCH_BIDIRECTIONAL == mSearchMode) {
+		return mBidirectional;
+	}
+	if (SEARCH_LANDMARKS == mSearchMode && GridTopology::CONNECTIVITY_4 == mConnectivity) {
+		return mAlt4;
+	}
+	if (SEARCH_LANDMARKS == mSearchMode && GridTopology::CUT_CORNERS_NEVER == mCornerCutting) {
+		return mAlt8;
+	}
+	return SEARCH_JPS == mSearchMode ? static_cast<const AStarSearch&>(mJps) : mAstar.Get(mConnectivity, mCornerCutting);
+}
+
+void Pathfinder::OnUpdate(float step)
+{
+	PathfindStep();
+	DeliverRequests();
+}
+
+void Pathfinder::OnStop()
+{
+	// Callbacks are only called by OnUpdate(), the requests would wait forever
+	CancelAllRequests();
+}
+
+void Pathfinder::SetRegionCost(int x, int y, int width, int height, int cost)
+{
+	int x0 = std::max(x, 0);
+	int y0 = std::max(y, 0);
+	int x1 = std::min(x + width, mGrid.GetCols()) - 1;
+	int y1 = std::min(y + height, mGrid.GetRows()) - 1;
+	if (x0 > x1 || y0 > y1) {
+		return;
+	}
+
+	unsigned int version = mGrid.GetVersion();
+	CostGrid::Cost newCost = CostGrid::ToCost(cost);
+	// Blocking a cell is an increase too, BLOCKED is the highest cost
+	bool costsIncreased = true;
+	bool walkabilityChanged = false;
+	for (int cellY = y0; cellY <= y1; ++cellY) {
+		for (int cellX = x0; cellX <= x1; ++cellX) {
+			CostGrid::Cost oldCost = mGrid.GetCost(cellX, cellY);
+			if (oldCost != newCost) {
+				costsIncreased &= newCost > oldCost;
+				walkabilityChanged |= (CostGrid::BLOCKED == oldCost) != (CostGrid::BLOCKED == newCost);
+				mGrid.SetCost(cellX, cellY, newCost);
+			}
+		}
+	}
+	if (mGrid.GetVersion() == version) {
+		return;
+	}
+
+	mClusterGraph.OnRegionChanged(x0, y0, x1, y1, walkabilityChanged);
+	mComponents.OnRegionChanged(mGrid, version, x0, y0, x1, y1);
+	mPathCache.Revalidate(mGrid, version, x0, y0, x1, y1, costsIncreased, GetConnectivity());
+	UpdateLandmarks();
+	if (mHasQuery) {
+		// The current path is kept when it is still valid, otherwise its query runs again
+		UpdatePath();
+	}
+}
+
+bool Pathfinder::LoadTextGrid(const char* gridFilename, const char* pathCostFilename)
+{
+	if (!GridFile::ReadText(gridFilename, pathCostFilename, mGrid)) {
+		return false;
+	}
+	OnGridLoaded();
+	return true;
+}
+
+bool Pathfinder::LoadGrid(const char* filename)
+{
+	GridFile gridFile;
+	if (!gridFile.Open(filename)) {
+		return false;
+	}
+	gridFile.Load(mGrid);
+	OnGridLoaded();
+	return true;
+}
+
+bool Pathfinder::OpenWorld(const char* filename, size_t memoryBudget)
+{
+	mWorldSearch.Clear();
+	if (!mWorld.Open(filename)) {
+		return false;
+	}
+	mWorld.SetMemoryBudget(memoryBudget);
+	return true;
+}
+
+void Pathfinder::OnGridLoaded()
+{
+	mSearch.Prepare(mGrid.GetCellCount());
+	mClusterGraph.Build(mGrid, mClusterSize);
+	mComponents.Build(mGrid, mConnectivity, mCornerCutting);
+	mPathCache.Clear();
+	mFlowFields.Clear();
+	mLandmarks.Clear();
+	UpdateLandmarks();
+	if (mHasQuery) {
+		mHasQuery = false;
+		UpdatePath();
+	}
+}
+
+void Pathfinder::Astar()
+{
+	// Runs the whole search at once
+	if (SEARCH_HIERARCHICAL == mSearchMode) {
+		mClusterGraph.FindPath(mStartNode, mTargetNode, mPath);
+		return;
+	}
+	if (SEARCH_FLOWFIELD == mSearchMode) {
+		if (mGrid.IsInside(mTargetNode) && !mStartNode.Compare(mTargetNode)) {
+			mFlowFields.GetField(mGrid, mTargetNode).BuildPath(mStartNode, mPath);
+		}
+		return;
+	}
+	if (SEARCH_DSTAR == mSearchMode) {
+		mDStar.FindPath(mStartNode, mTargetNode, mPath);
+		return;
+	}
+
+	AStarSearch& search = GetSearch();
+	search.Begin(mStartNode, mTargetNode);
+	if (AStarSearch::SEARCH_FOUND == search.Run()) {
+		search.BuildPath(mPath);
 	}
-	std::reverse(mPath.begin(), mPath.end());
 }
 
 GridNode Pathfinder::GetNodeFromScreenPosition(const USVec2D& screenPosition) const {
 	GridNode result(0, 0);
-	if (mGridRows && mGridCols) {
+	if (!mGrid.IsEmpty()) {
 		int left = -512;
 		int top = -384;
-		int colWidth = 1024/mGridCols;
-		int rowHeight = 768/mGridRows;
+		int colWidth = 1024/mGrid.GetCols();
+		int rowHeight = 768/mGrid.GetRows();
 		result.x = (screenPosition.mX - left) / colWidth;
 		result.y = (screenPosition.mY - top) / rowHeight;
 	}
 	return result;
 }
 
-int Pathfinder::CalculateDistance(const GridNode& node) const {
-	int x = mEndNode.x - node.x;
-	int y = mEndNode.y - node.y;
-	int dist = static_cast<int>(sqrtf(x * x + y * y));
-	return dist;
-}
-
-bool Pathfinder::PathNodeSort(PathNode* pathNode1, PathNode* pathNode2) { 
-	return *pathNode1 < *pathNode2; 
+USVec2D Pathfinder::GetScreenPositionFromNode(const GridNode& node) const {
+	USVec2D result(0.0f, 0.0f);
+	if (!mGrid.IsEmpty()) {
+		int left = -512;
+		int top = -384;
+		int colWidth = 1024/mGrid.GetCols();
+		int rowHeight = 768/mGrid.GetRows();
+		result.mX = left + (node.x + 0.5f) * colWidth;
+		result.mY = top + (node.y + 0.5f) * rowHeight;
+	}
+	return result;
 }
 
 void Pathfinder::DrawDebug()
 {
 	MOAIGfxDevice& gfxDevice = MOAIGfxDevice::Get();
 
-	if (mGridRows && mGridCols) {
+	if (!mGrid.IsEmpty()) {
 		int left = -512;
 		int top = -384;
-		int colWidth = 1024/mGridCols;
-		int rowHeight = 768/mGridRows;
+		int colWidth = 1024/mGrid.GetCols();
+		int rowHeight = 768/mGrid.GetRows();
 
-		for (int x = 0; x < static_cast<int>(mGridCols); ++x) {
+		for (int x = 0; x < mGrid.GetCols(); ++x) {
 			int pointLeft = x * colWidth + left;
-			for (int y = 0; y < static_cast<int>(mGridRows); ++y) {
+			for (int y = 0; y < mGrid.GetRows(); ++y) {
 				int pointTop = y * rowHeight + top;
 				
-				GridNode currentNode(x, y);
-				if (IsGridNodeValid(currentNode)) {
-					switch (mGrid[currentNode]) {
+				int index = mGrid.GetIndex(x, y);
+				if (mGrid.IsWalkable(index)) {
+					switch (mGrid.GetCost(index)) {
 					case 1:
 						gfxDevice.SetPenColor(0.2f, 0.2f, 0.9f, 0.2f);
 						break;
@@ -247,6 +607,23 @@ void Pathfinder::DrawDebug()
 			}
 		}
 
+		if (mDrawExpanded && IsGridSearchMode()) {
+			DrawExpanded(mSearch, left, top, colWidth, rowHeight);
+			if (SEARCH_BIDIRECTIONAL == mSearchMode) {
+				DrawExpanded(mReverseSearch, left, top, colWidth, rowHeight);
+			}
+		}
+
+		if (mDrawExpanded && SEARCH_LANDMARKS == mSearchMode && mLandmarks.IsCurrent(mGrid, mConnectivity)) {
+			gfxDevice.SetPenColor(1.0f, 0.0f, 1.0f, 0.75f);
+			for (int i = 0; i < mLandmarks.GetLandmarkCount(); ++i) {
+				GridNode landmark = mGrid.GetNode(mLandmarks.GetLandmark(i));
+				int pointLeft = landmark.x * colWidth + left;
+				int pointTop = landmark.y * rowHeight + top;
+				MOAIDraw::DrawRectFill(pointLeft, pointTop, pointLeft + colWidth, pointTop + rowHeight);
+			}
+		}
+
 		if (!mPath.empty()) {
 			for (GridNode& node : mPath) {
 				int pointLeft = node.x * colWidth + left;
@@ -258,6 +635,13 @@ void Pathfinder::DrawDebug()
 			}
 		}
 
+		if (mAnyAngle) {
+			gfxDevice.SetPenColor(1.0f, 1.0f, 0.0f, 1.0f);
+			for (size_t i = 1; i < mWaypoints.size(); ++i) {
+				MOAIDraw::DrawLine(mWaypoints[i - 1].mX, mWaypoints[i - 1].mY, mWaypoints[i].mX, mWaypoints[i].mY);
+			}
+		}
+
 		gfxDevice.SetPenColor(1.0f, 1.0f, 1.0f, 0.75f);
 		int startPointLeft = mStartNode.x * colWidth + left;
 		int startPointTop = mStartNode.y * rowHeight + top;
@@ -271,12 +655,122 @@ void Pathfinder::DrawDebug()
 	}
 }
 
+void Pathfinder::DrawExpanded(const SearchContext& context, int left, int top, int colWidth, int rowHeight)
+{
+	MOAIGfxDevice& gfxDevice = MOAIGfxDevice::Get();
+
+	// Only the nodes of the last query are visited in the current generation
+	if (context.GetCellCount() != mGrid.GetCellCount() || 0 == context.GetGeneration()) {
+		return;
+	}
+	int maxCost = 1;
+	for (int index = 0; index < context.GetCellCount(); ++index) {
+		if (context.IsVisited(index)) {
+			maxCost = std::max(maxCost, context.GetNode(index).g);
+		}
+	}
+
+	for (int x = 0; x < mGrid.GetCols(); ++x) {
+		int pointLeft = x * colWidth + left;
+		for (int y = 0; y < mGrid.GetRows(); ++y) {
+			int pointTop = y * rowHeight + top;
+			int index = mGrid.GetIndex(x, y);
+			if (context.IsClosed(index)) {
+				// Expanded cells go from yellow near where the search started to red at the highest cost
+				float heat = static_cast<float>(context.GetNode(index).g) / maxCost;
+				gfxDevice.SetPenColor(1.0f, 1.0f - heat, 0.0f, 0.4f);
+			} else if (context.IsOpen(index)) {
+				// Frontier of the search
+				gfxDevice.SetPenColor(0.0f, 0.8f, 0.0f, 0.4f);
+			} else {
+				continue;
+			}
+			MOAIDraw::DrawRectFill(pointLeft, pointTop, pointLeft + colWidth, pointTop + rowHeight);
+		}
+	}
+}
+
 bool Pathfinder::PathfindStep()
 {
-    // returns true if pathfinding process finished
-    return true;
+	// returns true if pathfinding process finished
+	AStarSearch& search = GetSearch();
+	if (!mPathRequested && !search.IsRunning()) {
+		return true;
+	}
+
+	auto stepStart = std::chrono::steady_clock::now();
+	if (mPathRequested) {
+		mPathRequested = false;
+		mQueryStats.Clear();
+		mQueryAllocatedBytes = mSearch.GetAllocatedBytes() + mReverseSearch.GetAllocatedBytes();
+		if (SEARCH_HIERARCHICAL == mSearchMode || SEARCH_FLOWFIELD == mSearchMode || SEARCH_DSTAR == mSearchMode) {
+			// The abstract search is short enough to run within a single step, a flow field
+			// is built once per goal and then shared by every start position, and D* Lite
+			// only repairs its previous search
+			Astar();
+			BuildWaypoints();
+			StorePath();
+		} else {
+			search.Begin(mStartNode, mTargetNode);
+		}
+	}
+
+	if (search.IsRunning()) {
+		unsigned int maxExpansions = mStepNodeBudget ? mStepNodeBudget : AStarSearch::UNLIMITED;
+		if (mStepTimeBudget) {
+			// Expanding in small batches keeps the clock reads out of the inner loop
+			std::chrono::microseconds timeBudget(mStepTimeBudget);
+			unsigned int expansions = 0;
+			while (search.IsRunning() && expansions < maxExpansions && std::chrono::steady_clock::now() - stepStart < timeBudget) {
+				unsigned int batch = std::min(TIME_CHECK_EXPANSIONS, maxExpansions - expansions);
+				search.Step(batch);
+				expansions += batch;
+			}
+		} else {
+			search.Step(maxExpansions);
+		}
+
+		if (AStarSearch::SEARCH_FOUND == search.GetStatus()) {
+			search.BuildPath(mPath);
+		}
+		if (!search.IsRunning()) {
+			BuildWaypoints();
+			StorePath();
+		}
+	}
+
+	mQueryStats.microseconds += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - stepStart).count();
+	if (search.IsRunning()) {
+		return false;
+	}
+	EndQueryStats();
+	return true;
 }
 
+void Pathfinder::EndQueryStats()
+{
+	// The counters come from the search that ran the query, the hierarchical search only
+	// counts its expansions and flow fields only their time
+	double microseconds = mQueryStats.microseconds;
+	size_t allocatedBytes = mSearch.GetAllocatedBytes() + mReverseSearch.GetAllocatedBytes() - mQueryAllocatedBytes;
+	if (IsGridSearchMode()) {
+		mQueryStats = GetSearch().GetStats();
+	} else if (SEARCH_DSTAR == mSearchMode) {
+		// D* Lite owns its search context
+		mQueryStats = mDStar.GetStats();
+		allocatedBytes = mQueryStats.allocatedBytes;
+	} else {
+		mQueryStats.Clear();
+		if (SEARCH_HIERARCHICAL == mSearchMode) {
+			mQueryStats.expanded = mClusterGraph.GetExpandedCount();
+		}
+	}
+	mQueryStats.microseconds = microseconds;
+	mQueryStats.allocatedBytes = allocatedBytes;
+	mStatsHistory.Add(mQueryStats);
+}
+
+
 
 
 
@@ -288,6 +782,22 @@ bool Pathfinder::PathfindStep()
 
 
 
+namespace {
+
+// Pushes the counters of a query in the order documented by getQueryStats
+int PushSearchStats(MOAILuaState& state, const SearchStats& stats)
+{
+	state.Push(stats.expanded);
+	state.Push(stats.generated);
+	state.Push(stats.openListPeak);
+	state.Push(stats.reopened);
+	state.Push(stats.heuristicEvaluations);
+	state.Push(static_cast<float>(stats.microseconds));
+	state.Push(static_cast<u32>(stats.allocatedBytes));
+	return 7;
+}
+
+}
 
 //lua configuration ----------------------------------------------------------------//
 void Pathfinder::RegisterLuaFuncs(MOAILuaState& state)
@@ -298,6 +808,35 @@ void Pathfinder::RegisterLuaFuncs(MOAILuaState& state)
 		{ "setStartPosition",		_setStartPosition},
 		{ "setEndPosition",			_setEndPosition},
         { "pathfindStep",           _pathfindStep},
+		{ "setStepBudget",			_setStepBudget},
+		{ "setSearchMode",			_setSearchMode},
+		{ "setMovement",			_setMovement},
+		{ "setClusterSize",			_setClusterSize},
+		{ "setLandmarks",			_setLandmarks},
+		{ "getCacheStats",			_getCacheStats},
+		{ "setCacheSize",			_setCacheSize},
+		{ "setRetarget",			_setRetarget},
+		{ "setAnyAngle",			_setAnyAngle},
+		{ "getWaypointCount",		_getWaypointCount},
+		{ "getWaypoint",			_getWaypoint},
+		{ "requestPath",			_requestPath},
+		{ "cancelRequest",			_cancelRequest},
+		{ "getRequestStats",		_getRequestStats},
+		{ "getPathBuffer",			_getPathBuffer},
+		{ "findPaths",				_findPaths},
+		{ "getFlowDirection",		_getFlowDirection},
+		{ "getFlowDirections",		_getFlowDirections},
+		{ "setCellCost",			_setCellCost},
+		{ "setRegionCost",			_setRegionCost},
+		{ "loadGrid",				_loadGrid},
+		{ "loadTextGrid",			_loadTextGrid},
+		{ "openWorld",				_openWorld},
+		{ "findWorldPath",			_findWorldPath},
+		{ "getWorldStats",			_getWorldStats},
+		{ "getQueryStats",			_getQueryStats},
+		{ "getStatsHistory",		_getStatsHistory},
+		{ "resetStats",				_resetStats},
+		{ "setDrawExpanded",		_setDrawExpanded},
 		{ NULL, NULL }
 	};
 
@@ -328,6 +867,408 @@ int Pathfinder::_pathfindStep(lua_State* L)
 {
     MOAI_LUA_SETUP(Pathfinder, "U")
 
-    self->PathfindStep();
-    return 0;
+	// Returns whether the search finished and its progress
+	state.Push(self->PathfindStep());
+	state.Push(self->GetExpandedCount());
+	state.Push(static_cast<u32>(self->GetOpenListSize()));
+	return 3;
+}
+
+int Pathfinder::_setStepBudget(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "U")
+
+	u32 maxExpansions = state.GetValue<u32>(2, 0);
+	u32 maxMicroseconds = state.GetValue<u32>(3, 0);
+	self->SetStepBudget(maxExpansions, maxMicroseconds);
+	return 0;
+}
+
+int Pathfinder::_setSearchMode(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "US")
+
+	// Search modes by name: "astar", "jps", "hpa", "flow", "dstar", "bidir" or "alt". On maps
+	// with obstacles "bidir" expands more cells than "astar" and answers fewer queries per
+	// second, it only wins on open terrain where the heuristic underestimates a lot
+	std::string mode = state.GetValue<cc8*>(2, "astar");
+	if (mode == "jps") {
+		self->SetSearchMode(SEARCH_JPS);
+	} else if (mode == "hpa") {
+		self->SetSearchMode(SEARCH_HIERARCHICAL);
+	} else if (mode == "flow") {
+		self->SetSearchMode(SEARCH_FLOWFIELD);
+	} else if (mode == "dstar") {
+		self->SetSearchMode(SEARCH_DSTAR);
+	} else if (mode == "bidir") {
+		self->SetSearchMode(SEARCH_BIDIRECTIONAL);
+	} else if (mode == "alt") {
+		self->SetSearchMode(SEARCH_LANDMARKS);
+	} else {
+		self->SetSearchMode(SEARCH_ASTAR);
+	}
+	return 0;
+}
+
+int Pathfinder::_setMovement(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "UN")
+
+	// 4 or 8 directions, and for diagonal moves beside blocked cells a corner cutting rule:
+	// "never", "single" when one of the two cells is walkable or "always"
+	int directions = state.GetValue<int>(2, GridTopology::CONNECTIVITY_4);
+	std::string cornerCutting = state.GetValue<cc8*>(3, "never");
+	GridTopology::Connectivity connectivity = directions == GridTopology::CONNECTIVITY_8 ? GridTopology::CONNECTIVITY_8 : GridTopology::CONNECTIVITY_4;
+	if (cornerCutting == "always") {
+		self->SetMovement(connectivity, GridTopology::CUT_CORNERS_ALWAYS);
+	} else if (cornerCutting == "single") {
+		self->SetMovement(connectivity, GridTopology::CUT_CORNERS_SINGLE);
+	} else {
+		self->SetMovement(connectivity, GridTopology::CUT_CORNERS_NEVER);
+	}
+	return 0;
+}
+
+int Pathfinder::_setClusterSize(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "UN")
+
+	int clusterSize = state.GetValue<int>(2, DEFAULT_CLUSTER_SIZE);
+	self->SetClusterSize(clusterSize);
+	return 0;
+}
+
+int Pathfinder::_setLandmarks(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "UN")
+
+	// Number of landmarks and their selection: "avoid" or "farthest"
+	int landmarkCount = state.GetValue<int>(2, DEFAULT_LANDMARKS);
+	std::string selection = state.GetValue<cc8*>(3, "avoid");
+	self->SetLandmarks(landmarkCount, selection == "farthest" ? LandmarkTable::SELECT_FARTHEST : LandmarkTable::SELECT_AVOID);
+	return 0;
+}
+
+int Pathfinder::_getCacheStats(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "U")
+
+	// Returns the hits, the hits reusing the tail of another path and the misses
+	const PathCache& pathCache = self->GetPathCache();
+	state.Push(pathCache.GetHits());
+	state.Push(pathCache.GetSuffixHits());
+	state.Push(pathCache.GetMisses());
+	return 3;
+}
+
+int Pathfinder::_setCacheSize(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "UN")
+
+	u32 capacity = state.GetValue<u32>(2, DEFAULT_CACHE_SIZE);
+	self->SetPathCacheSize(capacity);
+	return 0;
+}
+
+int Pathfinder::_setRetarget(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "UB")
+
+	self->SetRetarget(state.GetValue<bool>(2, false));
+	return 0;
+}
+
+int Pathfinder::_setAnyAngle(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "UB")
+
+	self->SetAnyAngle(state.GetValue<bool>(2, true));
+	return 0;
+}
+
+int Pathfinder::_getWaypointCount(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "U")
+
+	state.Push(static_cast<u32>(self->GetWaypoints().size()));
+	return 1;
+}
+
+int Pathfinder::_getWaypoint(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "UN")
+
+	// Returns the position of a waypoint, counted from 1, or nothing past the last one
+	const std::vector<USVec2D>& waypoints = self->GetWaypoints();
+	int waypoint = state.GetValue<int>(2, 1) - 1;
+	if (waypoint < 0 || waypoint >= static_cast<int>(waypoints.size())) {
+		return 0;
+	}
+	state.Push(waypoints[waypoint].mX);
+	state.Push(waypoints[waypoint].mY);
+	return 2;
+}
+
+int Pathfinder::_requestPath(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "UNNNNF")
+
+	// Start and end positions, the callback and an optional priority, higher requests are
+	// searched first. Returns the id of the request.
+	USVec2D startPosition(state.GetValue<float>(2, 0.0f), state.GetValue<float>(3, 0.0f));
+	USVec2D endPosition(state.GetValue<float>(4, 0.0f), state.GetValue<float>(5, 0.0f));
+	int priority = state.GetValue<int>(7, 0);
+	unsigned int id = self->RequestPath(startPosition, endPosition, priority);
+	lua_pushvalue(state, 6);
+	self->mRequestCallbacks[id] = luaL_ref(state, LUA_REGISTRYINDEX);
+	state.Push(id);
+	return 1;
+}
+
+int Pathfinder::_cancelRequest(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "UN")
+
+	state.Push(self->CancelRequest(state.GetValue<u32>(2, PathJobQueue::NO_JOB)));
+	return 1;
+}
+
+int Pathfinder::_getRequestStats(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "U")
+
+	// Returns the requests waiting, being searched, the most ever waiting, the requests
+	// ended and cancelled, and the mean and highest microseconds from request to result
+	PathJobStats stats = self->GetRequestStats();
+	state.Push(static_cast<u32>(stats.pending));
+	state.Push(stats.running);
+	state.Push(static_cast<u32>(stats.peakPending));
+	state.Push(stats.completed);
+	state.Push(stats.cancelled);
+	state.Push(stats.meanMicroseconds);
+	state.Push(stats.maxMicroseconds);
+	return 7;
+}
+
+int Pathfinder::_getPathBuffer(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "U")
+
+	// Returns a PathBuffer reading the current path, still valid after the path changes
+	PathBuffer::PushView(L, 1, self);
+	return 1;
+}
+
+int Pathfinder::_findPaths(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "UT")
+
+	// Start and end positions of many queries as a flat list {sx1, sy1, ex1, ey1, ...},
+	// searched at once on worker threads. Returns a PathBuffer with one path per query,
+	// reusing the batch buffer given after the list.
+	size_t count = lua_objlen(L, 2) / 4;
+	std::vector<PathQuery> queries(count);
+	for (size_t i = 0; i < count; ++i) {
+		float coordinates[4];
+		for (int j = 0; j < 4; ++j) {
+			lua_rawgeti(L, 2, static_cast<int>(i * 4 + j + 1));
+			coordinates[j] = static_cast<float>(lua_tonumber(L, -1));
+			lua_pop(L, 1);
+		}
+		queries[i].start = self->GetNodeFromScreenPosition(USVec2D(coordinates[0], coordinates[1]));
+		queries[i].end = self->GetNodeFromScreenPosition(USVec2D(coordinates[2], coordinates[3]));
+	}
+
+	PathBuffer* buffer = PathBuffer::Get(L, 3);
+	if (buffer && !buffer->IsView() && buffer->GetPathfinder() == self) {
+		lua_pushvalue(L, 3);
+	} else {
+		buffer = PathBuffer::PushBatch(L, 1, self);
+	}
+	self->FindPaths(queries.data(), count, buffer->GetBatch());
+	return 1;
+}
+
+int Pathfinder::_getFlowDirection(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "UNNNN")
+
+	// Returns the grid step to take from a position to reach the goal, zero if there is none
+	USVec2D goalPosition(state.GetValue<float>(2, 0.0f), state.GetValue<float>(3, 0.0f));
+	USVec2D position(state.GetValue<float>(4, 0.0f), state.GetValue<float>(5, 0.0f));
+	USVec2D direction;
+	self->GetFlowDirection(goalPosition, position, direction);
+	state.Push(direction.mX);
+	state.Push(direction.mY);
+	return 2;
+}
+
+int Pathfinder::_getFlowDirections(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "UNNT")
+
+	// Goal position and a flat list of positions {x1, y1, ...}. Returns the grid steps of
+	// every position as a flat list, filling the table given after the positions if any.
+	USVec2D goalPosition(state.GetValue<float>(2, 0.0f), state.GetValue<float>(3, 0.0f));
+	size_t count = lua_objlen(L, 4) / 2;
+	std::vector<USVec2D> positions(count);
+	for (size_t i = 0; i < count; ++i) {
+		lua_rawgeti(L, 4, static_cast<int>(i * 2 + 1));
+		lua_rawgeti(L, 4, static_cast<int>(i * 2 + 2));
+		positions[i] = USVec2D(static_cast<float>(lua_tonumber(L, -2)), static_cast<float>(lua_tonumber(L, -1)));
+		lua_pop(L, 2);
+	}
+	std::vector<USVec2D> directions(count);
+	self->GetFlowDirections(goalPosition, positions.data(), count, directions.data());
+
+	if (lua_istable(L, 5)) {
+		lua_pushvalue(L, 5);
+	} else {
+		lua_createtable(L, static_cast<int>(count * 2), 0);
+	}
+	for (size_t i = 0; i < count; ++i) {
+		lua_pushnumber(L, directions[i].mX);
+		lua_rawseti(L, -2, static_cast<int>(i * 2 + 1));
+		lua_pushnumber(L, directions[i].mY);
+		lua_rawseti(L, -2, static_cast<int>(i * 2 + 2));
+	}
+	return 1;
+}
+
+int Pathfinder::_setCellCost(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "UNNN")
+
+	// Cell coordinates and the new cost, negative to block the cell
+	int x = state.GetValue<int>(2, 0);
+	int y = state.GetValue<int>(3, 0);
+	int cost = state.GetValue<int>(4, 1);
+	self->SetCellCost(x, y, cost);
+	return 0;
+}
+
+int Pathfinder::_setRegionCost(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "UNNNNN")
+
+	// Rectangle of cells given by its first cell and its size, and the new cost
+	int x = state.GetValue<int>(2, 0);
+	int y = state.GetValue<int>(3, 0);
+	int width = state.GetValue<int>(4, 1);
+	int height = state.GetValue<int>(5, 1);
+	int cost = state.GetValue<int>(6, 1);
+	self->SetRegionCost(x, y, width, height, cost);
+	return 0;
+}
+
+int Pathfinder::_loadGrid(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "US")
+
+	// Binary grid file written by tools/GridConvert, returns false if it could not be loaded
+	cc8* filename = state.GetValue<cc8*>(2, "");
+	state.Push(self->LoadGrid(filename));
+	return 1;
+}
+
+int Pathfinder::_loadTextGrid(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "USS")
+
+	cc8* gridFilename = state.GetValue<cc8*>(2, "");
+	cc8* pathCostFilename = state.GetValue<cc8*>(3, "");
+	state.Push(self->LoadTextGrid(gridFilename, pathCostFilename));
+	return 1;
+}
+
+int Pathfinder::_openWorld(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "US")
+
+	// World file written by ChunkedWorld::Write() and the memory for its resident chunks
+	cc8* filename = state.GetValue<cc8*>(2, "");
+	u32 memoryBudget = state.GetValue<u32>(3, 64 * 1024 * 1024);
+	state.Push(self->OpenWorld(filename, memoryBudget));
+	return 1;
+}
+
+int Pathfinder::_findWorldPath(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "UNNNN")
+
+	// Returns whether a path was found, its cost, its length in cells, the nodes expanded
+	// and a PathBuffer holding the path, reusing the batch buffer given after the cells.
+	// Its cells are world cells, to be read with getCell().
+	GridNode start(state.GetValue<int>(2, 0), state.GetValue<int>(3, 0));
+	GridNode end(state.GetValue<int>(4, 0), state.GetValue<int>(5, 0));
+	PathBuffer* buffer = PathBuffer::Get(L, 6);
+	if (buffer && !buffer->IsView() && buffer->GetPathfinder() == self) {
+		lua_pushvalue(L, 6);
+	} else {
+		buffer = PathBuffer::PushBatch(L, 1, self);
+	}
+	int bufferIndex = lua_gettop(L);
+	PathBatch& batch = buffer->GetBatch();
+	bool found = self->FindWorldPath(start, end, batch.nodes);
+	batch.offsets.assign(1, 0);
+	batch.offsets.push_back(batch.nodes.size());
+
+	state.Push(found);
+	state.Push(self->GetWorldSearch().GetPathCost());
+	state.Push(static_cast<u32>(batch.nodes.size()));
+	state.Push(self->GetWorldSearch().GetExpandedCount());
+	lua_pushvalue(L, bufferIndex);
+	return 5;
+}
+
+int Pathfinder::_getWorldStats(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "U")
+
+	// Returns the chunk faults, prefetches, evictions, the bytes of resident chunks and the
+	// bytes of search nodes
+	const ChunkedWorld& world = self->GetWorld();
+	state.Push(world.GetFaultCount());
+	state.Push(world.GetPrefetchCount());
+	state.Push(world.GetEvictionCount());
+	state.Push(static_cast<u32>(world.GetResidentBytes()));
+	state.Push(static_cast<u32>(self->GetWorldSearch().GetNodeBytes()));
+	return 5;
+}
+
+int Pathfinder::_getQueryStats(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "U")
+
+	// Returns the nodes expanded, generated, the open list peak, the nodes reopened, the
+	// heuristic evaluations, the microseconds and the bytes allocated by the last query
+	return PushSearchStats(state, self->GetQueryStats());
+}
+
+int Pathfinder::_getStatsHistory(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "U")
+
+	// Returns the number of recent queries followed by their "mean" or "max" counters, in
+	// the order of getQueryStats
+	const SearchStatsHistory& history = self->GetStatsHistory();
+	std::string aggregate = state.GetValue<cc8*>(2, "mean");
+	state.Push(static_cast<u32>(history.GetCount()));
+	return 1 + PushSearchStats(state, aggregate == "max" ? history.GetMax() : history.GetMean());
+}
+
+int Pathfinder::_resetStats(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "U")
+
+	self->ResetStats();
+	return 0;
+}
+
+int Pathfinder::_setDrawExpanded(lua_State* L)
+{
+	MOAI_LUA_SETUP(Pathfinder, "UB")
+
+	self->SetDrawExpanded(state.GetValue<bool>(2, true));
+	return 0;
 }
\ No newline at end of file
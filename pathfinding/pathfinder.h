@@ -4,10 +4,40 @@
 #include <moaicore/MOAIEntity2D.h>
 #include "GridNode.h"
 #include "PathNode.h"
+#include "CostGrid.h"
+#include "SearchContext.h"
+#include "SearchStats.h"
+#include "AStarSearch.h"
+#include "SpecializedAStar.h"
+#include "JumpPointSearch.h"
+#include "BidirectionalSearch.h"
+#include "LandmarkTable.h"
+#include "ClusterGraph.h"
+#include "ConnectedComponents.h"
+#include "PathCache.h"
+#include "BatchPathfinder.h"
+#include "FlowField.h"
+#include "GridFile.h"
+#include "ChunkedWorld.h"
+#include "ChunkedSearch.h"
+#include "DStarLite.h"
+#include "PathSmoother.h"
+#include "PathJobQueue.h"
+#include <unordered_map>
 
 class Pathfinder: public virtual MOAIEntity2D
 {
 public:
+	enum SearchMode {
+		SEARCH_ASTAR,
+		SEARCH_JPS,
+		SEARCH_HIERARCHICAL,
+		SEARCH_FLOWFIELD,
+		SEARCH_DSTAR,
+		SEARCH_BIDIRECTIONAL,
+		SEARCH_LANDMARKS
+	};
+
 	Pathfinder();
 	~Pathfinder();
 
@@ -18,33 +48,209 @@ public:
 	const USVec2D& GetStartPosition() const { return mStartPosition;}
 	const USVec2D& GetEndPosition() const { return mEndPosition;}
 
+	// Cells of the current path from the start to the end, empty while it is searched or
+	// when there is none
+	const std::vector<GridNode>& GetPath() const { return mPath; }
+	// Cell under a screen position, and screen position of the center of a cell
+	GridNode GetNodeFromScreenPosition(const USVec2D& screenPosition) const;
+	USVec2D GetScreenPositionFromNode(const GridNode& node) const;
+
+	// Advances the queued search by the step budget, returns true when there is no search left to run
     bool PathfindStep();
+	// Limits the work of each PathfindStep(), a zero budget is unlimited
+	void SetStepBudget(unsigned int maxExpansions, unsigned int maxMicroseconds) { mStepNodeBudget = maxExpansions; mStepTimeBudget = maxMicroseconds; }
+	unsigned int GetExpandedCount() const;
+	size_t GetOpenListSize() const { return GetSearch().GetOpenListSize(); }
+
+	void SetSearchMode(SearchMode searchMode);
+	SearchMode GetSearchMode() const { return mSearchMode; }
+	// Moves of the A*, JPS and bidirectional searches and of the batches, the other modes
+	// stay 4-connected
+	void SetMovement(GridTopology::Connectivity connectivity, GridTopology::CornerCutting cornerCutting);
+	GridTopology::Connectivity GetConnectivity() const { return mConnectivity; }
+	// Size in cells of the clusters used by the hierarchical search, rebuilds the cluster graph
+	void SetClusterSize(int clusterSize);
+	// Landmarks of the ALT search and how they are chosen, the table is built at once in
+	// that mode, and otherwise when the mode is selected. ALT needs the moves of
+	// IntegrationSweep, 8-connected moves that cut corners fall back to A*.
+	void SetLandmarks(int landmarkCount, LandmarkTable::Selection selection);
+	const LandmarkTable& GetLandmarks() const { return mLandmarks; }
+
+	// Solves many queries at once on worker threads, with the A* or JPS search of the current mode
+	void FindPaths(const PathQuery* queries, size_t count, PathBatch& batch);
+
+	// Ends that can not be reached from the start have no path, found in constant time from
+	// the connected components of the grid. With retargeting, the path goes to the nearest
+	// cell that can be reached instead.
+	void SetRetarget(bool retarget);
+	const ConnectedComponents& GetComponents() const { return mComponents; }
+
+	// Points of the path for an agent to steer through, in screen coordinates. The cells
+	// where the path turns, or with any-angle paths the corners of the straight lines
+	// pulled over the cells, no more expensive than the cells they replace.
+	void SetAnyAngle(bool anyAngle);
+	bool IsAnyAngle() const { return mAnyAngle; }
+	const std::vector<USVec2D>& GetWaypoints() const { return mWaypoints; }
+
+	// Searches a path on worker threads while the game goes on, returns the id of the request.
+	// Requests are searched with A* and the moves, retargeting and any-angle setting of the
+	// Pathfinder, on the grid as it is when they are made. The results of the requests made
+	// from Lua are given to their callback by OnUpdate(). Stopping or destroying the
+	// Pathfinder cancels the requests that have not been delivered and releases their
+	// callbacks without calling them, so callbacks referencing the Pathfinder do not keep
+	// it alive once it is stopped.
+	unsigned int RequestPath(const USVec2D& startPosition, const USVec2D& endPosition, int priority);
+	// True when the request had not ended, its callback is then never called
+	bool CancelRequest(unsigned int id);
+	void CancelAllRequests();
+	PathJobStats GetRequestStats() const;
+
+	const PathCache& GetPathCache() const { return mPathCache; }
+	void SetPathCacheSize(size_t capacity) { mPathCache.SetCapacity(capacity); }
+
+	// Direction of the flow field towards the goal at a position, false if the goal can not be
+	// reached from it. Fields are shared by every agent heading to the same goal cell.
+	bool GetFlowDirection(const USVec2D& goalPosition, const USVec2D& position, USVec2D& direction);
+	// Directions of many positions towards the same goal, with a single lookup of the field
+	void GetFlowDirections(const USVec2D& goalPosition, const USVec2D* positions, size_t count, USVec2D* directions);
+	const FlowFieldCache& GetFlowFields() const { return mFlowFields; }
+
+	// Changes the cost of cells of the grid, in cells. Negative costs block the cells. Only the
+	// data that depends on the changed cells is repaired: the clusters around them and the
+	// cached paths crossing them, while flow fields and D* Lite repair themselves on their
+	// next query.
+	void SetCellCost(int x, int y, int cost) { SetRegionCost(x, y, 1, 1, cost); }
+	void SetRegionCost(int x, int y, int width, int height, int cost);
+	const CostGrid& GetGrid() const { return mGrid; }
+
+	// Replaces the grid with a binary grid file, or with a grid and path cost text pair
+	bool LoadGrid(const char* filename);
+	bool LoadTextGrid(const char* gridFilename, const char* pathCostFilename);
+
+	// Opens a world streamed from disk in chunks, searched with FindWorldPath() instead
+	// of the loaded grid. Positions are world cells.
+	bool OpenWorld(const char* filename, size_t memoryBudget);
+	bool FindWorldPath(const GridNode& start, const GridNode& end, std::vector<GridNode>& path) { return mWorldSearch.FindPath(start, end, path); }
+	const ChunkedWorld& GetWorld() const { return mWorld; }
+	const ChunkedSearch& GetWorldSearch() const { return mWorldSearch; }
+
+	// Counters of the last finished query and of the recent ones. Queries answered by the
+	// path cache or by the components run no search and are not counted.
+	const SearchStats& GetQueryStats() const { return mQueryStats; }
+	const SearchStatsHistory& GetStatsHistory() const { return mStatsHistory; }
+	void ResetStats() { mQueryStats.Clear(); mStatsHistory.Clear(); }
+	// Draws the cells visited by the last A*, JPS, bidirectional or ALT query in DrawDebug(),
+	// colored by their cost, and the landmarks of ALT
+	void SetDrawExpanded(bool drawExpanded) { mDrawExpanded = drawExpanded; }
+
+	// Number of heap allocations made by the search since the Pathfinder was created
+	size_t GetSearchAllocationCount() const { return mSearch.GetAllocationCount(); }
+protected:
+	virtual void OnUpdate(float step);
+	virtual void OnStop();
 private:
 	void UpdatePath();
-	void ReadPath(const char* gridFilename, const char* pathCostFilename);
+	int FindTargetCell(int startCell, int endCell);
+	PathJobQueue& GetJobQueue();
+	void DeliverRequests();
+	void StorePath();
+	void BuildWaypoints();
+	void OnGridLoaded();
+	// Builds or refreshes the landmark table in the ALT mode, outside of the budgeted steps
+	void UpdateLandmarks();
+	// True for the modes searched by an AStarSearch on mSearch
+	bool IsGridSearchMode() const;
+	BatchPathfinder& GetBatchPathfinder();
+	void EndQueryStats();
+	void DrawExpanded(const SearchContext& context, int left, int top, int colWidth, int rowHeight);
 	void Astar();
-	void GetNodeConnections(const PathNode& pathNode, std::vector<PathNode*>& connections);
-	bool IsGridNodeValid(const GridNode& node) const;
-	void BuildPath(const PathNode& lastNode);
-	GridNode GetNodeFromScreenPosition(const USVec2D& screenPosition) const;
-	int CalculateDistance(const GridNode& node) const;
-
-	static bool PathNodeSort(PathNode* pathNode1, PathNode* pathNode2);
+	AStarSearch& GetSearch();
+	const AStarSearch& GetSearch() const;
 
-	static const int NUM_DIRECTIONS;
-	static const int dirX[];
-	static const int dirY[];
+	static const unsigned int TIME_CHECK_EXPANSIONS;
+	static const int DEFAULT_CLUSTER_SIZE;
+	static const size_t DEFAULT_CACHE_SIZE;
+	static const size_t DEFAULT_FLOW_FIELDS;
+	static const int DEFAULT_LANDMARKS;
 
-	std::map<GridNode, int> mGrid;
-	size_t mGridRows;
-	size_t mGridCols;
+	CostGrid mGrid;
 	std::vector<GridNode> mPath;
+	// Waypoints of mPath, as cells and as screen positions
+	PathSmoother mSmoother;
+	std::vector<GridNode> mWaypointCells;
+	std::vector<USVec2D> mWaypoints;
+
+	// Search nodes and open list, allocated once per grid and reused between queries
+	SearchContext mSearch;
+	// A* compiled for each movement, the one of mConnectivity and mCornerCutting is used
+	AStarVariants mAstar;
+	JumpPointSearch mJps;
+	// Backward half of the bidirectional search
+	SearchContext mReverseSearch;
+	BidirectionalSearch mBidirectional;
+	// Costs to the landmarks, built when the grid, the moves or the landmarks change and
+	// refreshed after edits
+	LandmarkTable mLandmarks;
+	int mLandmarkCount;
+	LandmarkTable::Selection mLandmarkSelection;
+	LandmarkSearch4 mAlt4;
+	LandmarkSearch8 mAlt8;
+	SearchMode mSearchMode;
+	GridTopology::Connectivity mConnectivity;
+	GridTopology::CornerCutting mCornerCutting;
+	// Abstract graph of the grid for the hierarchical search, rebuilt with the chosen
+	// cluster size when a grid is loaded
+	int mClusterSize;
+	ClusterGraph mClusterGraph;
+	// Labels of the cells reachable from each other, repaired when costs change
+	ConnectedComponents mComponents;
+	bool mRetarget;
+	bool mAnyAngle;
+
+	// Flow fields of the recent goals, repaired when costs change
+	FlowFieldCache mFlowFields;
+
+	// Search kept between queries to the same goal, repaired when the start moves or costs change
+	DStarLite mDStar;
+
+	// World too large for mGrid, paged in chunk by chunk
+	ChunkedWorld mWorld;
+	ChunkedSearch mWorldSearch;
+
+	// Created on the first batch of queries
+	BatchPathfinder* mBatchPathfinder;
+
+	// Created on the first request, with the Lua callback of each request not delivered yet
+	PathJobQueue* mJobQueue;
+	std::unordered_map<unsigned int, int> mRequestCallbacks;
+	std::vector<PathJobResult> mRequestResults;
+
+	// Paths of recent queries, and the query mPath belongs to
+	PathCache mPathCache;
+	bool mHasQuery;
+	int mQueryStartCell;
+	int mQueryEndCell;
+	SearchMode mQueryMode;
+	unsigned int mQueryVersion;
+
+	// A query waiting for the next PathfindStep() to start it
+	bool mPathRequested;
+	unsigned int mStepNodeBudget;
+	unsigned int mStepTimeBudget;
+
+	// Statistics of the query being searched and of the previous ones
+	SearchStats mQueryStats;
+	SearchStatsHistory mStatsHistory;
+	size_t mQueryAllocatedBytes;
+	bool mDrawExpanded;
 
 private:
 	USVec2D mStartPosition;
 	USVec2D mEndPosition;
 	GridNode mStartNode;
 	GridNode mEndNode;
+	// End of the searches, mEndNode or the cell it was retargeted to
+	GridNode mTargetNode;
 
 	// Lua configuration
 public:
@@ -55,6 +261,35 @@ private:
 	static int _setStartPosition(lua_State* L);
 	static int _setEndPosition(lua_State* L);
     static int _pathfindStep(lua_State* L);
+	static int _setStepBudget(lua_State* L);
+	static int _setSearchMode(lua_State* L);
+	static int _setMovement(lua_State* L);
+	static int _setClusterSize(lua_State* L);
+	static int _setLandmarks(lua_State* L);
+	static int _getCacheStats(lua_State* L);
+	static int _setCacheSize(lua_State* L);
+	static int _setRetarget(lua_State* L);
+	static int _setAnyAngle(lua_State* L);
+	static int _getWaypointCount(lua_State* L);
+	static int _getWaypoint(lua_State* L);
+	static int _requestPath(lua_State* L);
+	static int _cancelRequest(lua_State* L);
+	static int _getRequestStats(lua_State* L);
+	static int _getPathBuffer(lua_State* L);
+	static int _findPaths(lua_State* L);
+	static int _getFlowDirection(lua_State* L);
+	static int _getFlowDirections(lua_State* L);
+	static int _setCellCost(lua_State* L);
+	static int _setRegionCost(lua_State* L);
+	static int _loadGrid(lua_State* L);
+	static int _loadTextGrid(lua_State* L);
+	static int _openWorld(lua_State* L);
+	static int _findWorldPath(lua_State* L);
+	static int _getWorldStats(lua_State* L);
+	static int _getQueryStats(lua_State* L);
+	static int _getStatsHistory(lua_State* L);
+	static int _resetStats(lua_State* L);
+	static int _setDrawExpanded(lua_State* L);
 };
 
 
@@ -0,0 +1,82 @@
+-- Cost of crossing from Lua to C++ for every query against a single crossing for a whole
+-- list of them, with the Pathfinder bindings. Run it with the host from sample/:
+-- moai bench_bindings.lua
+-- Prints the microseconds per query of each way, and how many times faster the bulk one is.
+
+local AGENTS = 10000
+local QUERIES = 2000
+local ROUNDS = 20
+
+pathfinder = Pathfinder.new()
+pathfinder:setStepBudget(0, 0)
+-- Every single query is searched, as the bulk ones are
+pathfinder:setCacheSize(0)
+math.randomseed(12345)
+
+local function randomPosition()
+	return math.random() * 1024 - 512, math.random() * 768 - 384
+end
+
+-- Microseconds per query of run(), after a first run that builds the flow fields and threads
+local function measure(count, run)
+	run()
+	local start = MOAISim.getDeviceTime()
+	for round = 1, ROUNDS do
+		run()
+	end
+	return (MOAISim.getDeviceTime() - start) * 1000000 / (ROUNDS * count)
+end
+
+local function report(name, perCall, bulk)
+	print(string.format("%-16s per call %8.3f us  bulk %8.3f us  speedup %6.1f", name, perCall, bulk, perCall / bulk))
+end
+
+-- Flow directions of many agents heading to the same goal
+local goalX, goalY = randomPosition()
+local positions = {}
+for i = 1, AGENTS do
+	positions[2 * i - 1], positions[2 * i] = randomPosition()
+end
+local directions = {}
+report("flow directions",
+	measure(AGENTS, function()
+		for i = 1, AGENTS do
+			directions[2 * i - 1], directions[2 * i] = pathfinder:getFlowDirection(goalX, goalY, positions[2 * i - 1], positions[2 * i])
+		end
+	end),
+	measure(AGENTS, function()
+		pathfinder:getFlowDirections(goalX, goalY, positions, directions)
+	end))
+
+-- Queries that start and end in the same cell, read back cell by cell from a path buffer.
+-- Their search is a single expansion on both sides, so the times are what each way costs
+-- around a search: the crossings and path reads, and for the bulk one handing the list to
+-- the worker threads. Longer paths would compare the Lua thread with all the workers.
+local queries = {}
+for i = 1, QUERIES do
+	queries[4 * i - 3], queries[4 * i - 2] = randomPosition()
+	queries[4 * i - 1], queries[4 * i] = queries[4 * i - 3], queries[4 * i - 2]
+end
+local pathBuffer = pathfinder:getPathBuffer()
+local batchBuffer = nil
+report("one cell paths",
+	measure(QUERIES, function()
+		for i = 1, QUERIES do
+			pathfinder:setStartPosition(queries[4 * i - 3], queries[4 * i - 2])
+			pathfinder:setEndPosition(queries[4 * i - 1], queries[4 * i])
+			pathfinder:pathfindStep()
+			for cell = 1, #pathBuffer do
+				local x, y = pathBuffer:getPosition(cell)
+			end
+		end
+	end),
+	measure(QUERIES, function()
+		batchBuffer = pathfinder:findPaths(queries, batchBuffer)
+		for path = 1, batchBuffer:getPathCount() do
+			for cell = 1, batchBuffer:getLength(path) do
+				local x, y = batchBuffer:getPosition(cell, path)
+			end
+		end
+	end))
+
+os.exit(0)
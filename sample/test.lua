@@ -34,8 +34,16 @@ layer:setDrawDebug(debug)
 MOAIDrawDebug.insertEntity(entity)
 
 
+startX = 5
+startY = 10
 pathfinder = Pathfinder.new()
-pathfinder:setStartPosition(5, 10)
+-- Expand at most 256 nodes or 2 milliseconds of search per frame
+pathfinder:setStepBudget(256, 2000)
+-- Start the pathfinder (OnUpdate advances the queued search and calls the requestPath callbacks every frame)
+pathfinder:start()
+-- Color the cells expanded by the last search
+pathfinder:setDrawExpanded(true)
+pathfinder:setStartPosition(startX, startY)
 pathfinder:setEndPosition(20, 40)
 MOAIDrawDebug.insertEntity(pathfinder)
 
@@ -43,7 +51,8 @@ mouseX = 0
 mouseY = 0
 
 function onClick(down)
-  pathfinder:setStartPosition(mouseX, mouseY)
+  startX, startY = mouseX, mouseY
+  pathfinder:setStartPosition(startX, startY)
 end
 
 function onRightClick(down)
@@ -63,11 +72,25 @@ function onKeyPressed(key, down)
 		if down then
 			print(tostring(key))
 		else
-			pathfinder:pathfindStep()
+			local finished, expanded, open = pathfinder:pathfindStep()
+			print("finished: " .. tostring(finished) .. " expanded: " .. expanded .. " open: " .. open)
+			if finished then
+				local expanded, generated, openPeak, reopened, heuristics, microseconds, bytes = pathfinder:getQueryStats()
+				print("generated: " .. generated .. " open peak: " .. openPeak .. " reopened: " .. reopened .. " us: " .. microseconds .. " bytes: " .. bytes)
+			end
 		end
+	elseif key == 114 and not down then
+		-- R searches a path from the start to the pointer on a worker thread, the game goes on
+		pathfinder:requestPath(startX, startY, mouseX, mouseY, onPathFound)
 	end
 end
 
+function onPathFound(id, found, waypoints, expanded)
+	print("request " .. id .. " found: " .. tostring(found) .. " waypoints: " .. #waypoints / 2 .. " expanded: " .. expanded)
+	local pending, running, peak, completed, cancelled, meanMicroseconds = pathfinder:getRequestStats()
+	print("pending: " .. pending .. " running: " .. running .. " peak: " .. peak .. " completed: " .. completed .. " cancelled: " .. cancelled .. " mean us: " .. meanMicroseconds)
+end
+
 if (MOAIInputMgr.device.keyboard) then
     MOAIInputMgr.device.keyboard:setCallback(onKeyPressed)
 end
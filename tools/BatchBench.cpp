@@ -0,0 +1,82 @@
+// Throughput of BatchPathfinder with a growing number of threads.
+//
+// Usage: BatchBench [size] [queries] [maxThreads]
+// Prints one line per thread count: threads, queries per second, speedup over one
+// thread and a checksum of the paths, which must be the same for every thread count.
+#include <stdafx.h>
+
+#include "BatchPathfinder.h"
+#include <chrono>
+#include <random>
+#include <thread>
+
+namespace {
+
+void BuildRandomGrid(CostGrid& grid, int size, std::mt19937& random) {
+	// Terrain patches with walls, similar to the sample grid at a larger scale
+	grid.Resize(size, size);
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			int terrain = 1 + ((x / 13) * 7 + (y / 11) * 3) % 4;
+			bool wall = (x % 24 == 0 && (y / 8) % 4 != 0) || (y % 32 == 0 && (x / 8) % 5 != 0);
+			grid.SetCost(x, y, wall || random() % 100 < 8 ? CostGrid::BLOCKED : static_cast<CostGrid::Cost>(terrain));
+		}
+	}
+}
+
+GridNode RandomWalkableNode(const CostGrid& grid, std::mt19937& random) {
+	GridNode node;
+	do {
+		node = GridNode(random() % grid.GetCols(), random() % grid.GetRows());
+	} while (!grid.IsWalkable(node));
+	return node;
+}
+
+unsigned long long Checksum(const PathBatch& batch) {
+	unsigned long long checksum = batch.GetPathCount();
+	for (const GridNode& node : batch.nodes) {
+		checksum = checksum * 1099511628211ULL + static_cast<unsigned long long>(node.y * 65536 + node.x);
+	}
+	return checksum;
+}
+
+}
+
+int main(int argc, char** argv) {
+	int size = argc > 1 ? atoi(argv[1]) : 512;
+	size_t numQueries = argc > 2 ? atoi(argv[2]) : 2000;
+	unsigned int maxThreads = argc > 3 ? atoi(argv[3]) : std::max(std::thread::hardware_concurrency(), 1u);
+
+	std::mt19937 random(12345);
+	CostGrid grid;
+	BuildRandomGrid(grid, size, random);
+
+	std::vector<PathQuery> queries(numQueries);
+	for (PathQuery& query : queries) {
+		query.start = RandomWalkableNode(grid, random);
+		query.end = RandomWalkableNode(grid, random);
+	}
+
+	printf("threads,queries_per_second,speedup,path_nodes,checksum\n");
+	double baseRate = 0.0;
+	for (unsigned int threads = 1; threads <= maxThreads; threads *= 2) {
+		BatchPathfinder batchPathfinder(grid, threads);
+		PathBatch batch;
+		// Warm up run, sizing every search context
+		batchPathfinder.FindPaths(queries.data(), queries.size(), batch);
+
+		auto start = std::chrono::steady_clock::now();
+		batchPathfinder.FindPaths(queries.data(), queries.size(), batch);
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		double rate = numQueries / seconds;
+		if (threads == 1) {
+			baseRate = rate;
+		}
+		printf("%u,%.1f,%.2f,%zu,%016llx\n", threads, rate, rate / baseRate, batch.nodes.size(), Checksum(batch));
+		if (threads < maxThreads && threads * 2 > maxThreads) {
+			threads = maxThreads / 2;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,107 @@
+// Cost of moving many agents along their paths with AgentSystem, at 60 updates per second.
+//
+// Usage: CrowdBench [agents] [frames] [size]
+// Agents follow any-angle paths over a random grid, one unit per cell. Every second a
+// tenth of the agents gets a new path. Prints the agent count, the frames run, the mean
+// and highest update time in milliseconds, the share of a 60 Hz frame the mean takes,
+// and the agents standing at the end of their path.
+#include <stdafx.h>
+
+#include "AgentSystem.h"
+#include "AStarSearch.h"
+#include "PathSmoother.h"
+#include <chrono>
+#include <random>
+
+namespace {
+
+const float FRAME_STEP = 1.0f / 60.0f;
+const int PATH_COUNT = 256;
+const float MAX_SPEED = 8.0f;
+
+void BuildRandomGrid(CostGrid& grid, int size, std::mt19937& random) {
+	grid.Resize(size, size);
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			int terrain = 1 + ((x / 13) * 7 + (y / 11) * 3) % 4;
+			bool wall = (x % 24 == 0 && (y / 8) % 4 != 0) || (y % 32 == 0 && (x / 8) % 5 != 0);
+			grid.SetCost(x, y, wall || random() % 100 < 8 ? CostGrid::BLOCKED : static_cast<CostGrid::Cost>(terrain));
+		}
+	}
+}
+
+GridNode RandomWalkableNode(const CostGrid& grid, std::mt19937& random) {
+	GridNode node;
+	do {
+		node = GridNode(random() % grid.GetCols(), random() % grid.GetRows());
+	} while (!grid.IsWalkable(node));
+	return node;
+}
+
+}
+
+int main(int argc, char** argv) {
+	int agentCount = argc > 1 ? atoi(argv[1]) : 10000;
+	int frameCount = argc > 2 ? atoi(argv[2]) : 1200;
+	int size = argc > 3 ? atoi(argv[3]) : 256;
+
+	std::mt19937 random(12345);
+	CostGrid grid;
+	BuildRandomGrid(grid, size, random);
+
+	// Waypoints at the centers of the cells
+	SearchContext context;
+	AStarSearch search(grid, context);
+	PathSmoother smoother;
+	std::vector<std::vector<float>> paths;
+	std::vector<GridNode> cells;
+	std::vector<GridNode> waypoints;
+	while (paths.size() < PATH_COUNT) {
+		search.Begin(RandomWalkableNode(grid, random), RandomWalkableNode(grid, random));
+		if (search.Run() != AStarSearch::SEARCH_FOUND) {
+			continue;
+		}
+		search.BuildPath(cells);
+		smoother.Smooth(grid, cells, waypoints);
+		std::vector<float> points;
+		for (const GridNode& waypoint : waypoints) {
+			points.push_back(waypoint.x + 0.5f);
+			points.push_back(waypoint.y + 0.5f);
+		}
+		paths.push_back(points);
+	}
+
+	AgentSystem agents;
+	agents.SetArrivalRadius(0.5f);
+	for (int i = 0; i < agentCount; ++i) {
+		const std::vector<float>& path = paths[i % PATH_COUNT];
+		int agent = agents.AddAgent(path[0], path[1], MAX_SPEED);
+		agents.SetPath(agent, path.data(), static_cast<int>(path.size() / 2));
+	}
+
+	double totalMilliseconds = 0.0;
+	double maxMilliseconds = 0.0;
+	for (int frame = 0; frame < frameCount; ++frame) {
+		if (frame > 0 && frame % 60 == 0) {
+			for (int i = 0; i < agentCount / 10; ++i) {
+				int agent = agents.GetHandle(random() % agents.GetAgentCount());
+				const std::vector<float>& path = paths[random() % PATH_COUNT];
+				agents.SetPath(agent, path.data(), static_cast<int>(path.size() / 2));
+			}
+		}
+		auto start = std::chrono::steady_clock::now();
+		agents.Update(FRAME_STEP);
+		double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		totalMilliseconds += milliseconds;
+		maxMilliseconds = std::max(maxMilliseconds, milliseconds);
+	}
+
+	int arrived = 0;
+	for (int i = 0; i < agents.GetAgentCount(); ++i) {
+		arrived += agents.HasArrived(agents.GetHandle(i)) ? 1 : 0;
+	}
+	double meanMilliseconds = totalMilliseconds / std::max(frameCount, 1);
+	printf("agents,frames,mean_ms,max_ms,frame_share,arrived\n");
+	printf("%d,%d,%.4f,%.4f,%.4f,%d\n", agentCount, frameCount, meanMilliseconds, maxMilliseconds, meanMilliseconds / (1000.0 * FRAME_STEP), arrived);
+	return 0;
+}
@@ -0,0 +1,293 @@
+// Edits per second of runtime terrain changes while agents keep querying the grid, with
+// the localized repair used by Pathfinder::SetRegionCost() and with a rebuild of all the
+// precomputed data after every frame of edits.
+//
+// Usage: EditBench [size] [frames] [editsPerFrame] [agents]
+// Every frame changes the cost of small regions and then runs the queries of the agents:
+// a cached A* path, followed one cell per frame, a flow field lookup towards one of a few
+// shared goals, hierarchical queries and a batch of A* queries on worker threads. Goals
+// in another connected component than the agent are rejected without a search. Prints
+// one line per strategy: edits per second counting the edits and the repairs they trigger,
+// milliseconds spent editing and querying, path cache hit rate, rejected queries and
+// mismatches against fresh searches, which must be 0. Both strategies run with 4-connected
+// moves, then with 8-connected moves that never cut corners, for the agents and the batch,
+// with an extra edit every frame blocking a cell beside a diagonal move of an agent.
+#include <stdafx.h>
+
+#include "BatchPathfinder.h"
+#include "ClusterGraph.h"
+#include "ConnectedComponents.h"
+#include "FlowField.h"
+#include "PathCache.h"
+#include <chrono>
+#include <random>
+
+namespace {
+
+const int CLUSTER_SIZE = 16;
+const int NUM_GOALS = 8;
+const int MAX_EDIT_SIZE = 4;
+// Frames between two checks of the agent paths, the checks are not timed
+const int CHECK_INTERVAL = 10;
+const int HPA_CHECKS = 50;
+
+struct Agent {
+	GridNode start;
+	GridNode end;
+	std::vector<GridNode> path;
+	bool found;
+};
+
+void BuildRandomGrid(CostGrid& grid, int size, std::mt19937& random) {
+	// Terrain patches with walls, the same map as BatchBench
+	grid.Resize(size, size);
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			int terrain = 1 + ((x / 13) * 7 + (y / 11) * 3) % 4;
+			bool wall = (x % 24 == 0 && (y / 8) % 4 != 0) || (y % 32 == 0 && (x / 8) % 5 != 0);
+			grid.SetCost(x, y, wall || random() % 100 < 8 ? CostGrid::BLOCKED : static_cast<CostGrid::Cost>(terrain));
+		}
+	}
+}
+
+GridNode RandomWalkableNode(const CostGrid& grid, std::mt19937& random) {
+	GridNode node;
+	do {
+		node = GridNode(random() % grid.GetCols(), random() % grid.GetRows());
+	} while (!grid.IsWalkable(node));
+	return node;
+}
+
+unsigned int PathCost(const CostGrid& grid, const std::vector<GridNode>& path, GridTopology::Connectivity connectivity) {
+	unsigned int cost = 0;
+	for (size_t i = 1; i < path.size(); ++i) {
+		cost += grid.GetCost(path[i].x, path[i].y) * GridTopology::GetDistance(connectivity, path[i].x - path[i - 1].x, path[i].y - path[i - 1].y);
+	}
+	return cost;
+}
+
+// Whether every cell of a path is walkable, and no diagonal move passes beside a blocked cell
+bool IsValidPath(const CostGrid& grid, const std::vector<GridNode>& path) {
+	for (size_t i = 0; i < path.size(); ++i) {
+		if (!grid.IsWalkable(path[i])) {
+			return false;
+		}
+		if (i > 0 && path[i].x != path[i - 1].x && path[i].y != path[i - 1].y
+			&& (!grid.IsWalkable(GridNode(path[i - 1].x, path[i].y)) || !grid.IsWalkable(GridNode(path[i].x, path[i - 1].y)))) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool Search(AStarSearch& search, const GridNode& start, const GridNode& end, std::vector<GridNode>& path) {
+	path.clear();
+	search.Begin(start, end);
+	if (AStarSearch::SEARCH_FOUND != search.Run()) {
+		return false;
+	}
+	search.BuildPath(path);
+	return true;
+}
+
+// Changes the costs of a rectangle like Pathfinder::SetRegionCost(), repairing the cluster
+// graph, the path cache and the components when they are given
+void ApplyEdit(CostGrid& grid, int x0, int y0, int x1, int y1, CostGrid::Cost cost, GridTopology::Connectivity connectivity,
+	ClusterGraph* clusterGraph, PathCache* pathCache, ConnectedComponents* components) {
+	unsigned int version = grid.GetVersion();
+	bool costsIncreased = true;
+	bool walkabilityChanged = false;
+	for (int y = y0; y <= y1; ++y) {
+		for (int x = x0; x <= x1; ++x) {
+			CostGrid::Cost oldCost = grid.GetCost(x, y);
+			if (oldCost != cost) {
+				costsIncreased &= cost > oldCost;
+				walkabilityChanged |= (CostGrid::BLOCKED == oldCost) != (CostGrid::BLOCKED == cost);
+				grid.SetCost(x, y, cost);
+			}
+		}
+	}
+	if (grid.GetVersion() == version) {
+		return;
+	}
+	if (clusterGraph) {
+		clusterGraph->OnRegionChanged(x0, y0, x1, y1, walkabilityChanged);
+	}
+	if (pathCache) {
+		pathCache->Revalidate(grid, version, x0, y0, x1, y1, costsIncreased, connectivity);
+	}
+	if (components) {
+		components->OnRegionChanged(grid, version, x0, y0, x1, y1);
+	}
+}
+
+unsigned int Run(const char* name, bool localized, GridTopology::Connectivity connectivity, int size, int frames, int editsPerFrame, int numAgents) {
+	// Both strategies see the same grid, edits and agents
+	std::mt19937 random(12345);
+	CostGrid grid;
+	BuildRandomGrid(grid, size, random);
+
+	GridNode goals[NUM_GOALS];
+	for (GridNode& goal : goals) {
+		goal = RandomWalkableNode(grid, random);
+	}
+	std::vector<Agent> agents(numAgents);
+	for (int i = 0; i < numAgents; ++i) {
+		agents[i].start = RandomWalkableNode(grid, random);
+		agents[i].end = goals[i % NUM_GOALS];
+	}
+
+	ClusterGraph clusterGraph;
+	clusterGraph.Build(grid, CLUSTER_SIZE);
+	ConnectedComponents components;
+	components.Build(grid, connectivity, GridTopology::CUT_CORNERS_NEVER);
+	FlowFieldCache flowFields(NUM_GOALS);
+	PathCache pathCache(numAgents * 2);
+	SearchContext context;
+	AStarSearch search(grid, context);
+	search.SetMovement(connectivity, GridTopology::CUT_CORNERS_NEVER);
+	BatchPathfinder batchPathfinder(grid);
+	batchPathfinder.SetMovement(connectivity, GridTopology::CUT_CORNERS_NEVER);
+	std::vector<PathQuery> queries(numAgents);
+	PathBatch batch;
+	std::vector<GridNode> path;
+
+	int edits = 0;
+	unsigned int lookups = 0;
+	unsigned int hits = 0;
+	unsigned int rejected = 0;
+	unsigned int mismatches = 0;
+	double editTime = 0.0;
+	double queryTime = 0.0;
+	for (int frame = 0; frame < frames; ++frame) {
+		auto editStart = std::chrono::steady_clock::now();
+		for (int i = 0; i < editsPerFrame; ++i) {
+			int x0 = random() % size;
+			int y0 = random() % size;
+			int x1 = std::min(x0 + static_cast<int>(random() % MAX_EDIT_SIZE), size - 1);
+			int y1 = std::min(y0 + static_cast<int>(random() % MAX_EDIT_SIZE), size - 1);
+			CostGrid::Cost cost = random() % 10 == 0 ? CostGrid::BLOCKED : static_cast<CostGrid::Cost>(1 + random() % 4);
+			ApplyEdit(grid, x0, y0, x1, y1, cost, connectivity, localized ? &clusterGraph : nullptr, localized ? &pathCache : nullptr, localized ? &components : nullptr);
+			++edits;
+		}
+		if (GridTopology::CONNECTIVITY_8 == connectivity) {
+			// Blocks a cell beside a diagonal move of an agent, the move then cuts a corner
+			// and the path must be searched again
+			const std::vector<GridNode>& path = agents[frame % numAgents].path;
+			for (size_t i = 1; i < path.size(); ++i) {
+				if (path[i].x != path[i - 1].x && path[i].y != path[i - 1].y) {
+					ApplyEdit(grid, path[i].x, path[i - 1].y, path[i].x, path[i - 1].y, CostGrid::BLOCKED, connectivity,
+						localized ? &clusterGraph : nullptr, localized ? &pathCache : nullptr, localized ? &components : nullptr);
+					++edits;
+					break;
+				}
+			}
+		}
+		if (!localized) {
+			clusterGraph.Build(grid, CLUSTER_SIZE);
+			components.Build(grid, connectivity, GridTopology::CUT_CORNERS_NEVER);
+			pathCache.Clear();
+			flowFields.Clear();
+		}
+		auto queryStart = std::chrono::steady_clock::now();
+
+		for (int i = 0; i < numAgents; ++i) {
+			Agent& agent = agents[i];
+			if (!grid.IsWalkable(agent.start) || agent.start.Compare(agent.end)) {
+				agent.start = RandomWalkableNode(grid, random);
+			}
+			int startCell = grid.GetIndex(agent.start);
+			int endCell = grid.GetIndex(agent.end);
+			++lookups;
+			if (!components.AreConnected(startCell, endCell)) {
+				++rejected;
+				agent.found = false;
+				agent.path.clear();
+			} else if (pathCache.Find(startCell, endCell, 0, grid.GetVersion(), agent.start, agent.path)) {
+				++hits;
+				agent.found = !agent.path.empty();
+			} else {
+				agent.found = Search(search, agent.start, agent.end, agent.path);
+				pathCache.Store(startCell, endCell, 0, grid.GetVersion(), agent.path);
+			}
+			flowFields.GetField(grid, agent.end).GetDirection(agent.start);
+			if (i % NUM_GOALS == 0) {
+				clusterGraph.FindPath(agent.start, agents[(i + 1) % numAgents].start, path);
+			}
+			queries[i].start = agent.start;
+			queries[i].end = goals[(i + frame) % NUM_GOALS];
+		}
+		batchPathfinder.FindPaths(queries.data(), queries.size(), batch);
+		auto queryEnd = std::chrono::steady_clock::now();
+		editTime += std::chrono::duration<double, std::milli>(queryStart - editStart).count();
+		queryTime += std::chrono::duration<double, std::milli>(queryEnd - queryStart).count();
+
+		for (int i = 0; i < numAgents; ++i) {
+			Agent& agent = agents[i];
+			if (!IsValidPath(grid, agent.path)) {
+				++mismatches;
+			}
+			if (frame % CHECK_INTERVAL == 0) {
+				bool found = Search(search, agent.start, agent.end, path);
+				if (found != agent.found || (found && PathCost(grid, path, connectivity) != PathCost(grid, agent.path, connectivity))) {
+					++mismatches;
+				}
+			}
+			// Agents walk one cell along their path every frame
+			if (agent.path.size() > 1) {
+				agent.start = agent.path[1];
+			}
+		}
+	}
+
+	if (localized) {
+		// The repaired components must group the cells like components built from scratch
+		ConnectedComponents rebuiltComponents;
+		rebuiltComponents.Build(grid, connectivity, GridTopology::CUT_CORNERS_NEVER);
+		for (int i = 0; i < HPA_CHECKS; ++i) {
+			int cellA = grid.GetIndex(RandomWalkableNode(grid, random));
+			int cellB = grid.GetIndex(RandomWalkableNode(grid, random));
+			if (components.AreConnected(cellA, cellB) != rebuiltComponents.AreConnected(cellA, cellB)) {
+				++mismatches;
+			}
+		}
+		if (components.GetComponentCount() != rebuiltComponents.GetComponentCount()) {
+			++mismatches;
+		}
+
+		// The repaired graph must find the same paths as a graph built from scratch
+		ClusterGraph rebuilt;
+		rebuilt.Build(grid, CLUSTER_SIZE);
+		std::vector<GridNode> rebuiltPath;
+		for (int i = 0; i < HPA_CHECKS; ++i) {
+			GridNode start = RandomWalkableNode(grid, random);
+			GridNode end = RandomWalkableNode(grid, random);
+			bool found = clusterGraph.FindPath(start, end, path);
+			bool rebuiltFound = rebuilt.FindPath(start, end, rebuiltPath);
+			if (found != rebuiltFound || (found && PathCost(grid, path, GridTopology::CONNECTIVITY_4) != PathCost(grid, rebuiltPath, GridTopology::CONNECTIVITY_4))) {
+				++mismatches;
+			}
+		}
+	}
+
+	double editsPerSecond = editTime > 0.0 ? edits * 1000.0 / editTime : 0.0;
+	printf("%s,%d,%d,%.0f,%.1f,%.1f,%.3f,%u,%u\n", name, frames, edits, editsPerSecond, editTime, queryTime,
+		lookups ? static_cast<double>(hits) / lookups : 0.0, rejected, mismatches);
+	return mismatches;
+}
+
+}
+
+int main(int argc, char** argv) {
+	int size = argc > 1 ? atoi(argv[1]) : 256;
+	int frames = argc > 2 ? atoi(argv[2]) : 60;
+	int editsPerFrame = argc > 3 ? atoi(argv[3]) : 4;
+	int numAgents = argc > 4 ? atoi(argv[4]) : 16;
+
+	printf("strategy,frames,edits,edits_per_second,edit_ms,query_ms,cache_hit_rate,rejected,mismatches\n");
+	unsigned int mismatches = Run("localized", true, GridTopology::CONNECTIVITY_4, size, frames, editsPerFrame, numAgents);
+	mismatches += Run("rebuild", false, GridTopology::CONNECTIVITY_4, size, frames, editsPerFrame, numAgents);
+	mismatches += Run("localized_8", true, GridTopology::CONNECTIVITY_8, size, frames, editsPerFrame, numAgents);
+	mismatches += Run("rebuild_8", false, GridTopology::CONNECTIVITY_8, size, frames, editsPerFrame, numAgents);
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,304 @@
+// Checks the background path jobs of PathJobQueue against synchronous A* searches, and
+// fails when any job is answered wrongly, out of order or after it was cancelled.
+//
+// Usage: JobQueueCheck [rounds] [seed]
+// Every round submits jobs on a grid edited between the submissions with a movement that
+// changes from round to round, cancels some of them, and compares the other results with
+// A* run on a copy of the grid as it was when the job was submitted, so that a job never
+// sees the edits made after it. A single worker busy with a long job then receives jobs of
+// random priorities: they must end highest priority first and in submission order among
+// equals, the pending ones cancelled and the long one cancelled while it runs must have no
+// result, and CancelAll must leave neither a job nor a result behind. Prints one line per
+// check with the jobs checked and the mismatches, and returns 1 if there is any mismatch.
+#include <stdafx.h>
+
+#include "PathJobQueue.h"
+#include <algorithm>
+#include <climits>
+#include <map>
+#include <random>
+
+namespace {
+
+const int GRID_SIZE = 48;
+const int EDITS_PER_BATCH = 24;
+const int JOBS_PER_BATCH = 8;
+const int BATCHES_PER_ROUND = 3;
+const int THREADS = 4;
+// Jobs of random priorities queued behind the long job, one in CANCEL_EVERY is cancelled
+const int QUEUED_JOBS = 32;
+const int CANCEL_EVERY = 5;
+const int MAX_PRIORITY = 4;
+// The long job searches all of a grid this large for an end it can not reach
+const int LONG_GRID_SIZE = 1024;
+
+struct CheckStats {
+	const char* name;
+	unsigned int queries;
+	unsigned int mismatches;
+};
+
+struct Movement {
+	GridTopology::Connectivity connectivity;
+	GridTopology::CornerCutting cornerCutting;
+};
+
+const Movement MOVEMENTS[] = {
+	{ GridTopology::CONNECTIVITY_4, GridTopology::CUT_CORNERS_NEVER },
+	{ GridTopology::CONNECTIVITY_8, GridTopology::CUT_CORNERS_NEVER },
+	{ GridTopology::CONNECTIVITY_8, GridTopology::CUT_CORNERS_SINGLE },
+	{ GridTopology::CONNECTIVITY_8, GridTopology::CUT_CORNERS_ALWAYS }
+};
+const int NUM_MOVEMENTS = sizeof(MOVEMENTS) / sizeof(MOVEMENTS[0]);
+
+// What a job was asked, to search it again synchronously
+struct SubmittedJob {
+	GridNode start;
+	GridNode end;
+	Movement movement;
+	std::shared_ptr<const CostGrid> grid;
+	bool cancelled;
+};
+
+void EditGrid(CostGrid& grid, int edits, std::mt19937& random) {
+	for (int i = 0; i < edits; ++i) {
+		grid.SetCost(random() % grid.GetCols(), random() % grid.GetRows(), random() % 4 == 0 ? CostGrid::BLOCKED : static_cast<CostGrid::Cost>(random() % 5));
+	}
+}
+
+GridNode RandomNode(const CostGrid& grid, std::mt19937& random) {
+	return GridNode(random() % grid.GetCols(), random() % grid.GetRows());
+}
+
+// Grid every cell of which is walkable but the end, walled in by its neighbours
+void BuildLongGrid(CostGrid& grid, GridNode& start, GridNode& end) {
+	grid.Resize(LONG_GRID_SIZE, LONG_GRID_SIZE);
+	for (int y = 0; y < LONG_GRID_SIZE; ++y) {
+		for (int x = 0; x < LONG_GRID_SIZE; ++x) {
+			grid.SetCost(x, y, 1);
+		}
+	}
+	start = GridNode(0, 0);
+	end = GridNode(LONG_GRID_SIZE - 2, LONG_GRID_SIZE - 2);
+	for (int y = end.y - 1; y <= end.y + 1; ++y) {
+		for (int x = end.x - 1; x <= end.x + 1; ++x) {
+			if (x != end.x || y != end.y) {
+				grid.SetCost(x, y, CostGrid::BLOCKED);
+			}
+		}
+	}
+}
+
+// Whether a result is the one of A* on the grid of the job
+bool MatchesSearch(const SubmittedJob& job, const PathJobResult& result) {
+	SearchContext context;
+	AStarVariants astar(*job.grid, context);
+	AStarSearch& search = astar.Get(job.movement.connectivity, job.movement.cornerCutting);
+	search.Begin(job.start, job.end);
+	bool found = AStarSearch::SEARCH_FOUND == search.Run();
+	std::vector<GridNode> waypoints;
+	if (found) {
+		std::vector<GridNode> path;
+		search.BuildPath(path);
+		PathSmoother::Compress(path, waypoints);
+	}
+	if (found != result.found || search.GetExpandedCount() != result.expanded || waypoints.size() != result.waypoints.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < waypoints.size(); ++i) {
+		if (!waypoints[i].Compare(result.waypoints[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void WaitIdle(const PathJobQueue& queue) {
+	while (true) {
+		PathJobStats stats = queue.GetStats();
+		if (stats.pending == 0 && stats.running == 0) {
+			return;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+void WaitRunning(const PathJobQueue& queue) {
+	while (queue.GetStats().running == 0) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+// Counts a mismatch for every job without exactly one result, or with a result it should
+// not have or not equal to the one of A*
+void CheckResults(const std::map<unsigned int, SubmittedJob>& jobs, const std::vector<PathJobResult>& results, CheckStats& stats) {
+	std::map<unsigned int, const PathJobResult*> byId;
+	for (const PathJobResult& result : results) {
+		auto job = jobs.find(result.id);
+		if (job == jobs.end() || job->second.cancelled || !byId.insert(std::make_pair(result.id, &result)).second) {
+			++stats.mismatches;
+		}
+	}
+	for (const auto& job : jobs) {
+		if (job.second.cancelled) {
+			continue;
+		}
+		++stats.queries;
+		auto result = byId.find(job.first);
+		if (result == byId.end() || !MatchesSearch(job.second, *result->second)) {
+			++stats.mismatches;
+		}
+	}
+}
+
+unsigned int Submit(PathJobQueue& queue, const CostGrid& grid, const Movement& movement, int priority, std::mt19937& random,
+	std::shared_ptr<const CostGrid>& snapshot, std::map<unsigned int, SubmittedJob>& jobs) {
+	// The copy of the check follows the copies of the queue, once per version of the grid
+	if (!snapshot || snapshot->GetVersion() != grid.GetVersion()) {
+		snapshot = std::make_shared<const CostGrid>(grid);
+	}
+	SubmittedJob job = { RandomNode(grid, random), RandomNode(grid, random), movement, snapshot, false };
+	unsigned int id = queue.Submit(grid, job.start, job.end, priority);
+	jobs[id] = job;
+	return id;
+}
+
+// Jobs of several versions of the grid in flight at once on every worker
+CheckStats CheckEditedGrid(int rounds, std::mt19937& random) {
+	CheckStats stats = { "results", 0, 0 };
+	PathJobQueue queue(THREADS);
+	CostGrid grid;
+	grid.Resize(GRID_SIZE, GRID_SIZE);
+	EditGrid(grid, GRID_SIZE * GRID_SIZE, random);
+	std::shared_ptr<const CostGrid> snapshot;
+	std::vector<PathJobResult> results;
+	for (int round = 0; round < rounds; ++round) {
+		const Movement& movement = MOVEMENTS[round % NUM_MOVEMENTS];
+		queue.SetMovement(movement.connectivity, movement.cornerCutting);
+		std::map<unsigned int, SubmittedJob> jobs;
+		for (int batch = 0; batch < BATCHES_PER_ROUND; ++batch) {
+			std::vector<unsigned int> ids;
+			for (int i = 0; i < JOBS_PER_BATCH; ++i) {
+				ids.push_back(Submit(queue, grid, movement, random() % MAX_PRIORITY, random, snapshot, jobs));
+			}
+			// A job that already ended can not be cancelled and keeps its result
+			for (size_t i = 0; i < ids.size(); i += CANCEL_EVERY) {
+				jobs[ids[i]].cancelled = queue.Cancel(ids[i]);
+			}
+			EditGrid(grid, EDITS_PER_BATCH, random);
+		}
+		WaitIdle(queue);
+		results.clear();
+		queue.PollResults(results);
+		CheckResults(jobs, results, stats);
+	}
+	return stats;
+}
+
+// Priorities, cancellation and CancelAll on one worker kept busy by a long job
+void CheckQueue(std::mt19937& random, std::vector<CheckStats>& checks) {
+	CheckStats order = { "priority_order", 0, 0 };
+	CheckStats cancelPending = { "cancel_pending", 0, 0 };
+	CheckStats cancelRunning = { "cancel_running", 0, 0 };
+	CheckStats cancelAll = { "cancel_all", 0, 0 };
+
+	PathJobQueue queue(1);
+	CostGrid longGrid;
+	GridNode longStart;
+	GridNode longEnd;
+	BuildLongGrid(longGrid, longStart, longEnd);
+	CostGrid grid;
+	grid.Resize(GRID_SIZE, GRID_SIZE);
+	EditGrid(grid, GRID_SIZE * GRID_SIZE, random);
+	std::shared_ptr<const CostGrid> snapshot;
+	const Movement& movement = MOVEMENTS[0];
+	std::vector<PathJobResult> results;
+
+	// The long job has the highest priority, it runs first even if the worker is not
+	// waiting yet when the others are submitted
+	unsigned int longId = queue.Submit(longGrid, longStart, longEnd, INT_MAX);
+	WaitRunning(queue);
+	std::map<unsigned int, SubmittedJob> jobs;
+	std::vector<std::pair<int, unsigned int>> expected;
+	for (int i = 0; i < QUEUED_JOBS; ++i) {
+		int priority = random() % MAX_PRIORITY;
+		unsigned int id = Submit(queue, grid, movement, priority, random, snapshot, jobs);
+		if (i % CANCEL_EVERY == 0) {
+			++cancelPending.queries;
+			jobs[id].cancelled = true;
+			if (!queue.Cancel(id) || queue.Cancel(id)) {
+				++cancelPending.mismatches;
+			}
+		} else {
+			expected.push_back(std::make_pair(-priority, id));
+		}
+	}
+	++cancelRunning.queries;
+	PathJobStats stats = queue.GetStats();
+	if (stats.running != 1 || stats.pending != expected.size() || !queue.Cancel(longId) || queue.Cancel(longId)) {
+		++cancelRunning.mismatches;
+	}
+	WaitIdle(queue);
+	queue.PollResults(results);
+	stats = queue.GetStats();
+	if (stats.cancelled != cancelPending.queries + 1) {
+		++cancelRunning.mismatches;
+	}
+	// The long job is not in the jobs checked, its result would be a mismatch
+	CheckResults(jobs, results, order);
+	std::sort(expected.begin(), expected.end());
+	for (size_t i = 0; i < expected.size(); ++i) {
+		if (i >= results.size() || results[i].id != expected[i].second) {
+			++order.mismatches;
+		}
+	}
+
+	// Neither the pending jobs, the running one nor the results not polled yet survive
+	longId = queue.Submit(longGrid, longStart, longEnd, INT_MAX);
+	WaitRunning(queue);
+	jobs.clear();
+	for (int i = 0; i < QUEUED_JOBS; ++i) {
+		unsigned int id = Submit(queue, grid, movement, random() % MAX_PRIORITY, random, snapshot, jobs);
+		jobs[id].cancelled = true;
+	}
+	jobs[queue.SubmitFailed()].cancelled = true;
+	queue.CancelAll();
+	++cancelAll.queries;
+	if (queue.Cancel(longId)) {
+		++cancelAll.mismatches;
+	}
+	WaitIdle(queue);
+	results.clear();
+	queue.PollResults(results);
+	// The queue still runs the jobs submitted afterwards
+	EditGrid(grid, EDITS_PER_BATCH, random);
+	Submit(queue, grid, movement, 0, random, snapshot, jobs);
+	WaitIdle(queue);
+	queue.PollResults(results);
+	CheckResults(jobs, results, cancelAll);
+
+	checks.push_back(order);
+	checks.push_back(cancelPending);
+	checks.push_back(cancelRunning);
+	checks.push_back(cancelAll);
+}
+
+}
+
+int main(int argc, char** argv) {
+	int rounds = argc > 1 ? atoi(argv[1]) : 100;
+	unsigned int seed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 12345;
+
+	std::mt19937 random(seed);
+	std::vector<CheckStats> checks;
+	checks.push_back(CheckEditedGrid(rounds, random));
+	CheckQueue(random, checks);
+
+	unsigned int mismatches = 0;
+	printf("check,queries,mismatches\n");
+	for (const CheckStats& check : checks) {
+		printf("%s,%u,%u\n", check.name, check.queries, check.mismatches);
+		mismatches += check.mismatches;
+	}
+	return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,313 @@
+// Runs Moving AI benchmark scenarios (https://movingai.com/benchmarks) through every
+// search mode of Pathfinder.
+//
+// Usage: MovingAIBench [--json] [--modes astar,jps,hpa,flow,dstar,bidir,astar8,bidir8,astar_runtime,alt,alt8] [--maps directory] file.scen...
+// Maps are looked up in the maps directory, by default the directory of each scenario
+// file, by the path in the scenario and then by file name.
+//
+// The scenario optimal lengths are octile distances with diagonal moves that never cut
+// corners, while most search modes move in 4 directions. Every scenario is checked twice:
+// - the map and scenario are checked against an 8-connected integration field with the
+//   same rules, whose cost must match the optimal length;
+// - the path of each mode is checked against the exact cost of an integration field with
+//   the moves of the mode, 4-connected or 8-connected for astar8, bidir8 and alt8. Modes that
+//   are not optimal by design, like hpa, report their cost ratio instead.
+// astar and astar8 run the A* compiled for their movement, astar_runtime the A* that
+// reads its movement at runtime, to compare the two. alt and alt8 build their landmark
+// tables when a map is loaded, outside of the timed queries.
+//
+// Prints one line per mode, or a JSON object with --json: queries, solved, cost
+// mismatches, mean cost ratio to the optimum, nodes expanded, queries per second and
+// p50, p99 and max latency in microseconds.
+#include <stdafx.h>
+
+#include "AStarSearch.h"
+#include "BidirectionalSearch.h"
+#include "ClusterGraph.h"
+#include "DStarLite.h"
+#include "FlowField.h"
+#include "GridFile.h"
+#include "IntegrationSweep.h"
+#include "JumpPointSearch.h"
+#include "LandmarkTable.h"
+#include "SpecializedAStar.h"
+#include <chrono>
+#include <map>
+#include <sstream>
+
+namespace {
+
+struct Scenario {
+	std::string directory;
+	std::string map;
+	GridNode start;
+	GridNode end;
+	double optimalLength;
+};
+
+struct ModeStats {
+	std::string name;
+	bool exact;
+	GridTopology::Connectivity connectivity;
+	unsigned int queries;
+	unsigned int solved;
+	unsigned int mismatches;
+	double costRatioSum;
+	unsigned long long expanded;
+	std::vector<double> latencies;
+};
+
+const int CLUSTER_SIZE = 16;
+const int LANDMARK_COUNT = 8;
+// 99 / 70 is within 5e-5 of sqrt(2), far below the precision of the scenario files
+const double OCTILE_TOLERANCE = 1e-4;
+
+bool ReadScenarios(const std::string& filename, const std::string& mapDirectory, std::vector<Scenario>& scenarios) {
+	std::ifstream file(filename);
+	if (!file.is_open()) {
+		return false;
+	}
+	std::string line;
+	while (std::getline(file, line)) {
+		std::istringstream fields(line);
+		int bucket;
+		int cols;
+		int rows;
+		Scenario scenario;
+		// Lines are "bucket map width height startX startY goalX goalY optimalLength", after a version line
+		if (fields >> bucket >> scenario.map >> cols >> rows >> scenario.start.x >> scenario.start.y >> scenario.end.x >> scenario.end.y >> scenario.optimalLength) {
+			scenario.directory = mapDirectory;
+			scenarios.push_back(scenario);
+		}
+	}
+	return true;
+}
+
+bool LoadMap(const Scenario& scenario, CostGrid& grid) {
+	if (GridFile::ReadMovingAIMap((scenario.directory + "/" + scenario.map).c_str(), grid)) {
+		return true;
+	}
+	// Scenario files often hold the path of the map in the original archive
+	size_t nameStart = scenario.map.rfind('/');
+	return std::string::npos != nameStart && GridFile::ReadMovingAIMap((scenario.directory + scenario.map.substr(nameStart)).c_str(), grid);
+}
+
+unsigned int PathCost(const CostGrid& grid, const std::vector<GridNode>& path, GridTopology::Connectivity connectivity) {
+	unsigned int cost = 0;
+	for (size_t i = 1; i < path.size(); ++i) {
+		int distanceX = path[i].x - path[i - 1].x;
+		int distanceY = path[i].y - path[i - 1].y;
+		bool straight = std::abs(distanceX) + std::abs(distanceY) == 1;
+		bool diagonal = GridTopology::CONNECTIVITY_8 == connectivity && std::abs(distanceX) == 1 && std::abs(distanceY) == 1
+			&& grid.IsWalkable(GridNode(path[i].x, path[i - 1].y)) && grid.IsWalkable(GridNode(path[i - 1].x, path[i].y));
+		if ((!straight && !diagonal) || !grid.IsWalkable(path[i])) {
+			// Not a valid path with the moves of the mode, counted as a mismatch
+			return 0;
+		}
+		cost += grid.GetCost(path[i].x, path[i].y) * GridTopology::GetDistance(connectivity, distanceX, distanceY);
+	}
+	return cost;
+}
+
+double Percentile(const std::vector<double>& sorted, double percentile) {
+	if (sorted.empty()) {
+		return 0.0;
+	}
+	size_t index = static_cast<size_t>(percentile * (sorted.size() - 1) + 0.5);
+	return sorted[index];
+}
+
+}
+
+int main(int argc, char** argv) {
+	bool json = false;
+	std::string modeList = "astar,jps,hpa,flow,dstar,bidir,astar8,bidir8,astar_runtime,alt,alt8";
+	std::string mapDirectory;
+	std::vector<std::string> scenarioFiles;
+	for (int i = 1; i < argc; ++i) {
+		std::string argument = argv[i];
+		if (argument == "--json") {
+			json = true;
+		} else if (argument == "--modes" && i + 1 < argc) {
+			modeList = argv[++i];
+		} else if (argument == "--maps" && i + 1 < argc) {
+			mapDirectory = argv[++i];
+		} else {
+			scenarioFiles.push_back(argument);
+		}
+	}
+	if (scenarioFiles.empty()) {
+		fprintf(stderr, "Usage: %s [--json] [--modes astar,jps,hpa,flow,dstar,bidir,astar8,bidir8,astar_runtime,alt,alt8] [--maps directory] file.scen...\n", argv[0]);
+		return 2;
+	}
+
+	std::vector<Scenario> scenarios;
+	for (const std::string& scenarioFile : scenarioFiles) {
+		size_t separator = scenarioFile.rfind('/');
+		std::string directory = !mapDirectory.empty() ? mapDirectory : (std::string::npos == separator ? "." : scenarioFile.substr(0, separator));
+		if (!ReadScenarios(scenarioFile, directory, scenarios)) {
+			fprintf(stderr, "Could not read %s\n", scenarioFile.c_str());
+			return 1;
+		}
+	}
+
+	std::vector<ModeStats> modes;
+	std::istringstream modeNames(modeList);
+	std::string modeName;
+	while (std::getline(modeNames, modeName, ',')) {
+		if (modeName == "astar" || modeName == "jps" || modeName == "hpa" || modeName == "flow" || modeName == "dstar" || modeName == "bidir"
+			|| modeName == "astar8" || modeName == "bidir8" || modeName == "astar_runtime" || modeName == "alt" || modeName == "alt8") {
+			GridTopology::Connectivity connectivity = modeName.back() == '8' ? GridTopology::CONNECTIVITY_8 : GridTopology::CONNECTIVITY_4;
+			ModeStats stats = { modeName, modeName != "hpa", connectivity, 0, 0, 0, 0.0, 0, std::vector<double>() };
+			modes.push_back(stats);
+		}
+	}
+
+	CostGrid grid;
+	SearchContext context;
+	AStarSearch4 astar(grid, context);
+	AStarSearch runtimeAstar(grid, context);
+	JumpPointSearch jps(grid, context);
+	SearchContext reverseContext;
+	BidirectionalSearch bidirectional(grid, context, reverseContext);
+	AStarSearch8 astar8(grid, context);
+	BidirectionalSearch bidirectional8(grid, context, reverseContext);
+	bidirectional8.SetMovement(GridTopology::CONNECTIVITY_8, GridTopology::CUT_CORNERS_NEVER);
+	// Modes run through the interface of AStarSearch
+	std::map<std::string, AStarSearch*> searches;
+	searches["astar"] = &astar;
+	searches["jps"] = &jps;
+	searches["bidir"] = &bidirectional;
+	searches["astar8"] = &astar8;
+	searches["bidir8"] = &bidirectional8;
+	searches["astar_runtime"] = &runtimeAstar;
+	ThreadPool threadPool;
+	LandmarkTable landmarks;
+	LandmarkSearch4 alt(grid, context);
+	alt.GetHeuristic().SetTable(&landmarks);
+	LandmarkTable landmarks8;
+	LandmarkSearch8 alt8(grid, context);
+	alt8.GetHeuristic().SetTable(&landmarks8);
+	searches["alt"] = &alt;
+	searches["alt8"] = &alt8;
+	bool useLandmarks = false;
+	bool useLandmarks8 = false;
+	for (const ModeStats& mode : modes) {
+		useLandmarks |= mode.name == "alt";
+		useLandmarks8 |= mode.name == "alt8";
+	}
+	ClusterGraph clusterGraph;
+	FlowFieldCache flowFields(1);
+	DStarLite dstar(grid);
+	IntegrationSweep sweep;
+	std::vector<GridNode> path;
+	std::string loadedMap;
+	unsigned int octileMismatches = 0;
+	unsigned int skipped = 0;
+
+	for (const Scenario& scenario : scenarios) {
+		if (scenario.directory + "/" + scenario.map != loadedMap) {
+			loadedMap = scenario.directory + "/" + scenario.map;
+			if (!LoadMap(scenario, grid)) {
+				fprintf(stderr, "Could not read %s\n", scenario.map.c_str());
+				return 1;
+			}
+			context.Prepare(grid.GetCellCount());
+			clusterGraph.Build(grid, CLUSTER_SIZE);
+			flowFields.Clear();
+			if (useLandmarks) {
+				landmarks.Build(grid, GridTopology::CONNECTIVITY_4, LANDMARK_COUNT, LandmarkTable::SELECT_AVOID, threadPool);
+			}
+			if (useLandmarks8) {
+				landmarks8.Build(grid, GridTopology::CONNECTIVITY_8, LANDMARK_COUNT, LandmarkTable::SELECT_AVOID, threadPool);
+			}
+		}
+		if (!grid.IsWalkable(scenario.start) || !grid.IsWalkable(scenario.end) || scenario.start.Compare(scenario.end)) {
+			++skipped;
+			continue;
+		}
+
+		sweep.Compute(grid, &scenario.end, 1, GridTopology::CONNECTIVITY_8);
+		int octileCost = sweep.GetField()[grid.GetIndex(scenario.start)];
+		double octileLength = static_cast<double>(octileCost) / GridTopology::STRAIGHT_WEIGHT;
+		if (std::abs(octileLength - scenario.optimalLength) > OCTILE_TOLERANCE * std::max(scenario.optimalLength, 1.0)) {
+			++octileMismatches;
+		}
+		sweep.Compute(grid, &scenario.end, 1, GridTopology::CONNECTIVITY_4);
+		int optimalCost = sweep.GetField()[grid.GetIndex(scenario.start)];
+		if (IntegrationSweep::UNREACHABLE == optimalCost) {
+			++skipped;
+			continue;
+		}
+
+		for (ModeStats& mode : modes) {
+			unsigned int expanded = 0;
+			auto start = std::chrono::steady_clock::now();
+			bool found = false;
+			if (searches.count(mode.name)) {
+				AStarSearch& search = *searches[mode.name];
+				search.Begin(scenario.start, scenario.end);
+				found = AStarSearch::SEARCH_FOUND == search.Run();
+				if (found) {
+					search.BuildPath(path);
+				}
+				expanded = search.GetExpandedCount();
+			} else if (mode.name == "hpa") {
+				found = clusterGraph.FindPath(scenario.start, scenario.end, path);
+				expanded = clusterGraph.GetExpandedCount();
+			} else if (mode.name == "dstar") {
+				// Consecutive scenarios with the same goal repair the previous search
+				found = dstar.FindPath(scenario.start, scenario.end, path);
+				expanded = dstar.GetExpandedCount();
+			} else {
+				// Scenarios rarely share goals, every query builds a field
+				flowFields.Clear();
+				found = flowFields.GetField(grid, scenario.end).BuildPath(scenario.start, path);
+			}
+			mode.latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+
+			++mode.queries;
+			mode.expanded += expanded;
+			unsigned int cost = found ? PathCost(grid, path, mode.connectivity) : 0;
+			unsigned int modeOptimalCost = GridTopology::CONNECTIVITY_8 == mode.connectivity ? octileCost : optimalCost;
+			if (found) {
+				++mode.solved;
+				mode.costRatioSum += static_cast<double>(cost) / modeOptimalCost;
+			}
+			if (!found || cost < modeOptimalCost || (mode.exact && cost != modeOptimalCost)) {
+				++mode.mismatches;
+			}
+		}
+	}
+
+	if (json) {
+		printf("{\"scenarios\":%zu,\"skipped\":%u,\"octile_mismatches\":%u,\"modes\":[", scenarios.size(), skipped, octileMismatches);
+	} else {
+		printf("mode,queries,solved,cost_mismatches,mean_cost_ratio,expanded_total,expanded_mean,queries_per_second,p50_us,p99_us,max_us\n");
+	}
+	bool failed = octileMismatches != 0;
+	for (size_t i = 0; i < modes.size(); ++i) {
+		ModeStats& mode = modes[i];
+		double totalTime = 0.0;
+		for (double latency : mode.latencies) {
+			totalTime += latency;
+		}
+		std::sort(mode.latencies.begin(), mode.latencies.end());
+		double queriesPerSecond = totalTime > 0.0 ? mode.queries * 1e6 / totalTime : 0.0;
+		double meanRatio = mode.solved ? mode.costRatioSum / mode.solved : 0.0;
+		double meanExpanded = mode.queries ? static_cast<double>(mode.expanded) / mode.queries : 0.0;
+		double maxLatency = mode.latencies.empty() ? 0.0 : mode.latencies.back();
+		const char* format = json
+			? "%s{\"mode\":\"%s\",\"queries\":%u,\"solved\":%u,\"cost_mismatches\":%u,\"mean_cost_ratio\":%.5f,\"expanded_total\":%llu,\"expanded_mean\":%.1f,\"queries_per_second\":%.1f,\"p50_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f}"
+			: "%s%s,%u,%u,%u,%.5f,%llu,%.1f,%.1f,%.1f,%.1f,%.1f\n";
+		printf(format, json && i > 0 ? "," : "", mode.name.c_str(), mode.queries, mode.solved, mode.mismatches, meanRatio, mode.expanded, meanExpanded,
+			queriesPerSecond, Percentile(mode.latencies, 0.5), Percentile(mode.latencies, 0.99), maxLatency);
+		failed |= mode.exact && mode.mismatches != 0;
+	}
+	if (json) {
+		printf("]}\n");
+	} else if (octileMismatches) {
+		fprintf(stderr, "%u scenarios do not match the optimal length of their file\n", octileMismatches);
+	}
+	return failed ? 1 : 0;
+}
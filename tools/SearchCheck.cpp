@@ -0,0 +1,357 @@
+// Checks the searches against a reference Dijkstra on random grids with weighted and zero
+// cost cells, and fails when any query disagrees.
+//
+// Usage: SearchCheck [grids] [seed]
+// The searches that find optimal paths answer random queries on every grid, with every
+// movement they support: A* with its movement read at runtime and compiled for it, JPS,
+// bidirectional A*, ALT, whose 8-connected moves never cut corners, and the 4-connected
+// flow fields. D* Lite follows an agent across grids edited between its queries, so that
+// the repairs of the search are checked as well as its first searches: the agent walks
+// along its path, cells change cost or get blocked, and the start or the goal jump
+// elsewhere. A*, JPS and bidirectional A* answer the same queries twice, and the second
+// pass must not allocate. Prints one line per check with the queries run and the
+// mismatches, a query whose path is not valid or not as cheap as the reference or that
+// allocated on a warm context, and returns 1 if there is any mismatch.
+#include <stdafx.h>
+
+#include "AStarSearch.h"
+#include "BidirectionalSearch.h"
+#include "DStarLite.h"
+#include "FlowField.h"
+#include "GridTopology.h"
+#include "JumpPointSearch.h"
+#include "LandmarkTable.h"
+#include "SpecializedAStar.h"
+#include <climits>
+#include <queue>
+#include <random>
+
+namespace {
+
+const int MAX_GRID_SIZE = 64;
+const int QUERIES_PER_GRID = 8;
+const int LANDMARKS = 4;
+const int DSTAR_STEPS = 40;
+const int ALLOCATION_GRID_SIZE = 128;
+const int ALLOCATION_QUERIES = 64;
+
+struct CheckStats {
+	std::string name;
+	unsigned int queries;
+	unsigned int mismatches;
+};
+
+struct Movement {
+	GridTopology::Connectivity connectivity;
+	GridTopology::CornerCutting cornerCutting;
+	const char* name;
+};
+
+const Movement MOVEMENTS[] = {
+	{ GridTopology::CONNECTIVITY_4, GridTopology::CUT_CORNERS_NEVER, "4" },
+	{ GridTopology::CONNECTIVITY_8, GridTopology::CUT_CORNERS_NEVER, "8_never" },
+	{ GridTopology::CONNECTIVITY_8, GridTopology::CUT_CORNERS_SINGLE, "8_single" },
+	{ GridTopology::CONNECTIVITY_8, GridTopology::CUT_CORNERS_ALWAYS, "8_always" }
+};
+const int NUM_MOVEMENTS = sizeof(MOVEMENTS) / sizeof(MOVEMENTS[0]);
+
+enum Mode {
+	MODE_ASTAR,
+	MODE_ASTAR_RUNTIME,
+	MODE_JPS,
+	MODE_BIDIRECTIONAL,
+	MODE_ALT,
+	MODE_FLOW,
+	NUM_MODES
+};
+
+const char* const MODE_NAMES[NUM_MODES] = { "astar", "astar_runtime", "jps", "bidir", "alt", "flow" };
+
+// Random grid with blocked cells and costs from minCost to maxCost
+void BuildRandomGrid(CostGrid& grid, int cols, int rows, int blockedPercent, int minCost, int maxCost, std::mt19937& random) {
+	grid.Resize(cols, rows);
+	for (int y = 0; y < rows; ++y) {
+		for (int x = 0; x < cols; ++x) {
+			bool blocked = static_cast<int>(random() % 100) < blockedPercent;
+			grid.SetCost(x, y, blocked ? CostGrid::BLOCKED : static_cast<CostGrid::Cost>(minCost + random() % (maxCost - minCost + 1)));
+		}
+	}
+}
+
+GridNode RandomNode(const CostGrid& grid, std::mt19937& random) {
+	return GridNode(random() % grid.GetCols(), random() % grid.GetRows());
+}
+
+// Cost of the cheapest path with Dijkstra, INT_MAX if there is none
+int ReferenceCost(const CostGrid& grid, const GridNode& start, const GridNode& end, GridTopology::Connectivity connectivity, GridTopology::CornerCutting cornerCutting) {
+	if (!grid.IsWalkable(start) || !grid.IsWalkable(end)) {
+		return INT_MAX;
+	}
+	typedef std::pair<int, int> Entry;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+	std::vector<int> costs(grid.GetCellCount(), INT_MAX);
+	int stride = grid.GetStride();
+	int endIndex = grid.GetIndex(end);
+	costs[grid.GetIndex(start)] = 0;
+	open.push(Entry(0, grid.GetIndex(start)));
+	while (!open.empty()) {
+		Entry entry = open.top();
+		open.pop();
+		int index = entry.second;
+		if (entry.first != costs[index]) {
+			continue;
+		}
+		if (index == endIndex) {
+			return entry.first;
+		}
+		for (int i = 0; i < GridTopology::GetDirectionCount(connectivity); ++i) {
+			int next = index + GridTopology::GetOffset(i, stride);
+			if (!grid.IsWalkable(next)) {
+				continue;
+			}
+			if (GridTopology::IsDiagonal(i) && !GridTopology::CanCutCorner(cornerCutting,
+				grid.IsWalkable(index + GridTopology::GetOffset(GridTopology::GetFirstSide(i), stride)),
+				grid.IsWalkable(index + GridTopology::GetOffset(GridTopology::GetSecondSide(i), stride)))) {
+				continue;
+			}
+			int cost = entry.first + grid.GetCost(next) * GridTopology::GetWeight(connectivity, i);
+			if (cost < costs[next]) {
+				costs[next] = cost;
+				open.push(Entry(cost, next));
+			}
+		}
+	}
+	return INT_MAX;
+}
+
+// Cost of a path from start to end, -1 if one of its moves is not allowed
+int PathCost(const CostGrid& grid, const std::vector<GridNode>& path, const GridNode& start, const GridNode& end,
+	GridTopology::Connectivity connectivity, GridTopology::CornerCutting cornerCutting) {
+	if (path.empty() || !path.front().Compare(start) || !path.back().Compare(end)) {
+		return -1;
+	}
+	int cost = 0;
+	for (size_t i = 1; i < path.size(); ++i) {
+		const GridNode& from = path[i - 1];
+		const GridNode& to = path[i];
+		int dx = to.x - from.x;
+		int dy = to.y - from.y;
+		bool diagonal = dx != 0 && dy != 0;
+		if (std::abs(dx) > 1 || std::abs(dy) > 1 || (dx == 0 && dy == 0) || !grid.IsWalkable(to)
+			|| (diagonal && GridTopology::CONNECTIVITY_4 == connectivity)) {
+			return -1;
+		}
+		if (diagonal && !GridTopology::CanCutCorner(cornerCutting, grid.IsWalkable(GridNode(to.x, from.y)), grid.IsWalkable(GridNode(from.x, to.y)))) {
+			return -1;
+		}
+		cost += grid.GetCost(to.x, to.y) * GridTopology::GetDistance(connectivity, dx, dy);
+	}
+	return cost;
+}
+
+// Whether a search answered like the reference, found or not and at the same cost
+bool Matches(const CostGrid& grid, bool found, const std::vector<GridNode>& path, const GridNode& start, const GridNode& end,
+	GridTopology::Connectivity connectivity, GridTopology::CornerCutting cornerCutting) {
+	int reference = ReferenceCost(grid, start, end, connectivity, cornerCutting);
+	if (!found) {
+		return INT_MAX == reference;
+	}
+	return PathCost(grid, path, start, end, connectivity, cornerCutting) == reference;
+}
+
+bool IsSupported(Mode mode, const Movement& movement) {
+	if (MODE_FLOW == mode) {
+		return GridTopology::CONNECTIVITY_4 == movement.connectivity;
+	}
+	return MODE_ALT != mode || GridTopology::CUT_CORNERS_NEVER == movement.cornerCutting;
+}
+
+void CheckSearches(int grids, std::mt19937& random, std::vector<CheckStats>& checks) {
+	CostGrid grid;
+	SearchContext context;
+	SearchContext reverseContext;
+	AStarSearch astarRuntime(grid, context);
+	AStarVariants astar(grid, context);
+	JumpPointSearch jps(grid, context);
+	BidirectionalSearch bidirectional(grid, context, reverseContext);
+	ThreadPool threadPool;
+	LandmarkTable landmarks;
+	LandmarkSearch4 alt4(grid, context);
+	LandmarkSearch8 alt8(grid, context);
+	alt4.GetHeuristic().SetTable(&landmarks);
+	alt8.GetHeuristic().SetTable(&landmarks);
+	FlowField flowField;
+
+	size_t first = checks.size();
+	for (int mode = 0; mode < NUM_MODES; ++mode) {
+		for (const Movement& movement : MOVEMENTS) {
+			CheckStats stats = { std::string(MODE_NAMES[mode]) + "_" + movement.name, 0, 0 };
+			checks.push_back(stats);
+		}
+	}
+
+	std::vector<GridNode> path;
+	for (int i = 0; i < grids; ++i) {
+		// Sparse to maze-like grids, with uniform or weighted costs starting at 0, 1 or 2
+		int minCost = random() % 3;
+		int maxCost = minCost + (i % 2 == 0 ? 0 : 5);
+		BuildRandomGrid(grid, 2 + random() % (MAX_GRID_SIZE - 1), 2 + random() % (MAX_GRID_SIZE - 1), random() % 45, minCost, maxCost, random);
+
+		for (int m = 0; m < NUM_MOVEMENTS; ++m) {
+			const Movement& movement = MOVEMENTS[m];
+			landmarks.Clear();
+			for (int query = 0; query < QUERIES_PER_GRID; ++query) {
+				GridNode start = RandomNode(grid, random);
+				GridNode end = RandomNode(grid, random);
+				if (start.Compare(end)) {
+					continue;
+				}
+				for (int mode = 0; mode < NUM_MODES; ++mode) {
+					if (!IsSupported(static_cast<Mode>(mode), movement)) {
+						continue;
+					}
+					bool found;
+					if (MODE_FLOW == mode) {
+						flowField.Build(grid, end);
+						found = flowField.BuildPath(start, path);
+					} else {
+						AStarSearch* search;
+						if (MODE_ASTAR == mode) {
+							search = &astar.Get(movement.connectivity, movement.cornerCutting);
+						} else if (MODE_ALT == mode) {
+							if (!landmarks.IsBuilt()) {
+								landmarks.Build(grid, movement.connectivity, LANDMARKS, LandmarkTable::SELECT_AVOID, threadPool);
+							}
+							search = GridTopology::CONNECTIVITY_4 == movement.connectivity ? static_cast<AStarSearch*>(&alt4) : &alt8;
+						} else {
+							search = MODE_JPS == mode ? &jps : (MODE_BIDIRECTIONAL == mode ? &bidirectional : &astarRuntime);
+							search->SetMovement(movement.connectivity, movement.cornerCutting);
+						}
+						search->Begin(start, end);
+						found = AStarSearch::SEARCH_FOUND == search->Run();
+						if (found) {
+							search->BuildPath(path);
+						}
+					}
+					CheckStats& stats = checks[first + mode * NUM_MOVEMENTS + m];
+					++stats.queries;
+					if (!Matches(grid, found, path, start, end, movement.connectivity, movement.cornerCutting)) {
+						++stats.mismatches;
+					}
+				}
+			}
+		}
+	}
+
+	// Movements a search does not support have no line
+	for (size_t i = checks.size(); i > first; --i) {
+		if (checks[i - 1].queries == 0) {
+			checks.erase(checks.begin() + (i - 1));
+		}
+	}
+}
+
+CheckStats CheckDStar(int grids, std::mt19937& random) {
+	CheckStats stats = { "dstar", 0, 0 };
+	CostGrid grid;
+	DStarLite dstar(grid);
+	std::vector<GridNode> path;
+	for (int i = 0; i < grids; ++i) {
+		BuildRandomGrid(grid, 5 + random() % (MAX_GRID_SIZE - 4), 5 + random() % (MAX_GRID_SIZE - 4), 20, 0, 3, random);
+		GridNode start = RandomNode(grid, random);
+		GridNode end = RandomNode(grid, random);
+		for (int step = 0; step < DSTAR_STEPS; ++step) {
+			int event = random() % 10;
+			if (event < 5) {
+				if (path.size() > 1) {
+					start = path[1];
+				}
+			} else if (event < 8) {
+				for (int edits = 1 + random() % 5; edits > 0; --edits) {
+					grid.SetCost(random() % grid.GetCols(), random() % grid.GetRows(), random() % 10 < 3 ? CostGrid::BLOCKED : static_cast<CostGrid::Cost>(random() % 4));
+				}
+			} else if (event < 9) {
+				end = RandomNode(grid, random);
+			} else {
+				start = RandomNode(grid, random);
+			}
+			if (start.Compare(end)) {
+				continue;
+			}
+
+			bool found = dstar.FindPath(start, end, path);
+			++stats.queries;
+			if (!Matches(grid, found, path, start, end, GridTopology::CONNECTIVITY_4, GridTopology::CUT_CORNERS_NEVER)) {
+				++stats.mismatches;
+			}
+			if (!found) {
+				path.clear();
+			}
+		}
+	}
+	return stats;
+}
+
+// Runs the same queries twice with A*, JPS and bidirectional A*, the first pass warms the
+// contexts up and every query of the second pass must not allocate
+void CheckAllocations(std::mt19937& random, std::vector<CheckStats>& checks) {
+	CostGrid grid;
+	BuildRandomGrid(grid, ALLOCATION_GRID_SIZE, ALLOCATION_GRID_SIZE, 20, 1, 5, random);
+	std::vector<GridNode> starts;
+	std::vector<GridNode> ends;
+	for (int query = 0; query < ALLOCATION_QUERIES; ++query) {
+		starts.push_back(RandomNode(grid, random));
+		ends.push_back(RandomNode(grid, random));
+	}
+
+	SearchContext context;
+	SearchContext reverseContext;
+	AStarSearch astar(grid, context);
+	JumpPointSearch jps(grid, context);
+	BidirectionalSearch bidirectional(grid, context, reverseContext);
+	AStarSearch* searches[] = { &astar, &jps, &bidirectional };
+	const char* names[] = { "allocations_astar", "allocations_jps", "allocations_bidir" };
+
+	std::vector<GridNode> path;
+	for (int s = 0; s < 3; ++s) {
+		CheckStats stats = { names[s], 0, 0 };
+		searches[s]->SetMovement(GridTopology::CONNECTIVITY_8, GridTopology::CUT_CORNERS_NEVER);
+		for (int pass = 0; pass < 2; ++pass) {
+			for (int query = 0; query < ALLOCATION_QUERIES; ++query) {
+				size_t allocations = context.GetAllocationCount() + reverseContext.GetAllocationCount();
+				searches[s]->Begin(starts[query], ends[query]);
+				if (AStarSearch::SEARCH_FOUND == searches[s]->Run()) {
+					searches[s]->BuildPath(path);
+				}
+				if (pass == 1) {
+					++stats.queries;
+					if (context.GetAllocationCount() + reverseContext.GetAllocationCount() != allocations) {
+						++stats.mismatches;
+					}
+				}
+			}
+		}
+		checks.push_back(stats);
+	}
+}
+
+}
+
+int main(int argc, char** argv) {
+	int grids = argc > 1 ? atoi(argv[1]) : 200;
+	unsigned int seed = argc > 2 ? static_cast<unsigned int>(atoi(argv[2])) : 12345;
+
+	std::mt19937 random(seed);
+	std::vector<CheckStats> checks;
+	CheckSearches(grids, random, checks);
+	checks.push_back(CheckDStar(grids, random));
+	CheckAllocations(random, checks);
+
+	unsigned int mismatches = 0;
+	printf("check,queries,mismatches\n");
+	for (const CheckStats& check : checks) {
+		printf("%s,%u,%u\n", check.name.c_str(), check.queries, check.mismatches);
+		mismatches += check.mismatches;
+	}
+	return mismatches == 0 ? 0 : 1;
+}
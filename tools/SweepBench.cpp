@@ -0,0 +1,146 @@
+// Checks IntegrationSweep against Dijkstra and compares their speed.
+//
+// Usage: SweepBench [size] [repeats] [blockedPercent]
+// First solves random small grids with both and counts the cells where they disagree,
+// which must be zero, then times full fields on a size x size map with walls and
+// randomly blocked cells, or open weighted terrain when blockedPercent is 0. Prints one
+// line per connectivity: instruction set, iterations, milliseconds per field for the
+// sweep and for the reference Dijkstra and, with 4-connectivity, milliseconds per
+// FlowField built with Dijkstra and with the sweep.
+// Build with CXXFLAGS="-O2 -mavx2" to time the AVX2 kernel.
+#include <stdafx.h>
+
+#include "IntegrationSweep.h"
+#include "FlowField.h"
+#include <chrono>
+#include <functional>
+#include <queue>
+#include <random>
+
+namespace {
+
+// Dijkstra from the goal with the move costs and corner rule of IntegrationSweep
+void ReferenceField(const CostGrid& grid, const GridNode& goal, GridTopology::Connectivity connectivity, std::vector<int>& field) {
+	typedef std::pair<int, int> Entry;
+	std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry> > queue;
+	field.assign(grid.GetCellCount(), IntegrationSweep::UNREACHABLE);
+	if (!grid.IsWalkable(goal)) {
+		return;
+	}
+	int stride = grid.GetStride();
+	field[grid.GetIndex(goal)] = 0;
+	queue.push(Entry(0, grid.GetIndex(goal)));
+	while (!queue.empty()) {
+		Entry entry = queue.top();
+		queue.pop();
+		int cell = entry.second;
+		if (entry.first != field[cell]) {
+			continue;
+		}
+		for (int i = 0; i < GridTopology::GetDirectionCount(connectivity); ++i) {
+			int next = cell + GridTopology::GetOffset(i, stride);
+			if (!grid.IsWalkable(next)) {
+				continue;
+			}
+			if (GridTopology::IsDiagonal(i)) {
+				// The move from next to cell passes beside these two cells
+				int first = cell + GridTopology::GetOffset(i - 4, stride);
+				int second = cell + GridTopology::GetOffset((i - 3) % 4, stride);
+				if (!grid.IsWalkable(first) || !grid.IsWalkable(second)) {
+					continue;
+				}
+			}
+			int integration = entry.first + grid.GetCost(cell) * GridTopology::GetWeight(connectivity, i);
+			if (integration < field[next]) {
+				field[next] = integration;
+				queue.push(Entry(integration, next));
+			}
+		}
+	}
+}
+
+void BuildRandomGrid(CostGrid& grid, int cols, int rows, int blockedPercent, std::mt19937& random) {
+	grid.Resize(cols, rows);
+	for (int y = 0; y < rows; ++y) {
+		for (int x = 0; x < cols; ++x) {
+			int terrain = 1 + ((x / 13) * 7 + (y / 11) * 3) % 4;
+			bool wall = blockedPercent > 0 && ((x % 24 == 0 && (y / 8) % 4 != 0) || (y % 32 == 0 && (x / 8) % 5 != 0));
+			bool blocked = wall || static_cast<int>(random() % 100) < blockedPercent;
+			grid.SetCost(x, y, blocked ? CostGrid::BLOCKED : static_cast<CostGrid::Cost>(terrain + random() % 3));
+		}
+	}
+}
+
+size_t CountMismatches(const std::vector<int>& field, const std::vector<int>& reference) {
+	size_t mismatches = 0;
+	for (size_t i = 0; i < field.size(); ++i) {
+		mismatches += field[i] != reference[i];
+	}
+	return mismatches;
+}
+
+template <typename Function>
+double MillisecondsPerRun(int repeats, Function function) {
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < repeats; ++i) {
+		function();
+	}
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / repeats;
+}
+
+}
+
+int main(int argc, char** argv) {
+	int size = argc > 1 ? atoi(argv[1]) : 512;
+	int repeats = argc > 2 ? atoi(argv[2]) : 10;
+	const GridTopology::Connectivity connectivities[] = { GridTopology::CONNECTIVITY_4, GridTopology::CONNECTIVITY_8 };
+
+	std::mt19937 random(12345);
+	IntegrationSweep sweep;
+	std::vector<int> reference;
+
+	size_t mismatches = 0;
+	for (int test = 0; test < 500; ++test) {
+		CostGrid grid;
+		BuildRandomGrid(grid, 1 + random() % 70, 1 + random() % 70, random() % 40, random);
+		GridNode goal(random() % grid.GetCols(), random() % grid.GetRows());
+		for (GridTopology::Connectivity connectivity : connectivities) {
+			sweep.Compute(grid, &goal, 1, connectivity);
+			ReferenceField(grid, goal, connectivity, reference);
+			mismatches += CountMismatches(sweep.GetField(), reference);
+		}
+	}
+
+	CostGrid grid;
+	BuildRandomGrid(grid, size, size, argc > 3 ? atoi(argv[3]) : 8, random);
+	GridNode goal(size / 2, size / 2);
+	grid.SetCost(goal.x, goal.y, 1);
+
+	printf("connectivity,instruction_set,iterations,sweep_ms,dijkstra_ms,flowfield_ms,flowfield_sweep_ms,mismatches\n");
+	for (GridTopology::Connectivity connectivity : connectivities) {
+		unsigned int iterations = sweep.Compute(grid, &goal, 1, connectivity);
+		const std::vector<int>& field = sweep.GetField();
+		ReferenceField(grid, goal, connectivity, reference);
+		size_t fieldMismatches = mismatches + CountMismatches(field, reference);
+
+		double sweepTime = MillisecondsPerRun(repeats, [&]() { sweep.Compute(grid, &goal, 1, connectivity); });
+		double dijkstraTime = MillisecondsPerRun(repeats, [&]() { ReferenceField(grid, goal, connectivity, reference); });
+		double flowFieldTime = 0.0;
+		double flowFieldSweepTime = 0.0;
+		if (GridTopology::CONNECTIVITY_4 == connectivity) {
+			FlowField flowField;
+			flowFieldTime = MillisecondsPerRun(repeats, [&]() { flowField.Build(grid, goal); });
+			FlowField sweptFlowField;
+			IntegrationSweep flowFieldSweep;
+			flowFieldSweepTime = MillisecondsPerRun(repeats, [&]() { sweptFlowField.Build(grid, goal, &flowFieldSweep); });
+			fieldMismatches += sweptFlowField.GetIntegrationField() != flowField.GetIntegrationField();
+			for (size_t i = 0; i < field.size(); ++i) {
+				bool reachable = field[i] != IntegrationSweep::UNREACHABLE;
+				fieldMismatches += reachable ? flowField.GetIntegration(static_cast<int>(i)) != static_cast<unsigned int>(field[i]) : flowField.GetIntegration(static_cast<int>(i)) != FlowField::UNREACHABLE;
+			}
+		}
+		printf("%d,%s,%u,%.3f,%.3f,%.3f,%.3f,%zu\n", connectivity, IntegrationSweep::GetInstructionSet(), iterations, sweepTime, dijkstraTime, flowFieldTime, flowFieldSweepTime, fieldMismatches);
+		mismatches = fieldMismatches;
+	}
+	return mismatches == 0 ? 0 : 1;
+}
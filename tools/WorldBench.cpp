@@ -0,0 +1,126 @@
+// Searches a world streamed in chunks with a small memory budget and checks the paths
+// against A* on the same grid held in memory.
+//
+// Usage: WorldBench [size] [chunkSize] [budgetKB] [queries] [worldFile]
+// Writes a size x size world file for each map, terrain and then terrain crossed by roads
+// of zero cost, which gets an eighth of the queries. Prints one line per map: queries,
+// cost mismatches, chunk faults, prefetches, evictions, resident and budget bytes, peak
+// bytes of search nodes and the milliseconds taken by the streamed and the in memory
+// searches.
+#include <stdafx.h>
+
+#include "AStarSearch.h"
+#include "ChunkedSearch.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+namespace {
+
+void BuildRandomGrid(CostGrid& grid, int size, bool roads, std::mt19937& random) {
+	// Terrain patches with walls, the same map as BatchBench, optionally crossed by roads of
+	// zero cost that leave the searches without a heuristic
+	grid.Resize(size, size);
+	for (int y = 0; y < size; ++y) {
+		for (int x = 0; x < size; ++x) {
+			bool road = roads && (x % 40 == 20 || y % 40 == 20);
+			int terrain = road ? 0 : 1 + ((x / 13) * 7 + (y / 11) * 3) % 4;
+			bool wall = (x % 24 == 0 && (y / 8) % 4 != 0) || (y % 32 == 0 && (x / 8) % 5 != 0);
+			grid.SetCost(x, y, wall || random() % 100 < 8 ? CostGrid::BLOCKED : static_cast<CostGrid::Cost>(terrain));
+		}
+	}
+}
+
+GridNode RandomWalkableNode(const CostGrid& grid, std::mt19937& random) {
+	GridNode node;
+	do {
+		node = GridNode(random() % grid.GetCols(), random() % grid.GetRows());
+	} while (!grid.IsWalkable(node));
+	return node;
+}
+
+unsigned int PathCost(const CostGrid& grid, const std::vector<GridNode>& path) {
+	unsigned int cost = 0;
+	for (size_t i = 1; i < path.size(); ++i) {
+		cost += grid.GetCost(path[i].x, path[i].y);
+	}
+	return cost;
+}
+
+// Runs the queries on a world written from the grid and prints its line, returns the
+// mismatches or -1 if the world file could not be written
+int RunWorld(const char* name, const CostGrid& grid, int chunkSize, size_t budget, int numQueries, const char* worldFilename, std::mt19937& random) {
+	if (!ChunkedWorld::Write(worldFilename, grid, chunkSize)) {
+		fprintf(stderr, "Could not write %s\n", worldFilename);
+		return -1;
+	}
+
+	ChunkedWorld world;
+	if (!world.Open(worldFilename)) {
+		fprintf(stderr, "Could not open %s\n", worldFilename);
+		return -1;
+	}
+	world.SetMemoryBudget(budget);
+	ChunkedSearch chunkedSearch(world);
+	SearchContext context;
+	AStarSearch search(grid, context);
+
+	std::vector<GridNode> path;
+	std::vector<GridNode> referencePath;
+	int mismatches = 0;
+	double chunkedTime = 0.0;
+	double referenceTime = 0.0;
+	size_t nodeBytes = 0;
+	for (int i = 0; i < numQueries; ++i) {
+		// Queries a few hundred cells apart, like agents crossing part of the world
+		GridNode start = RandomWalkableNode(grid, random);
+		GridNode end;
+		do {
+			end = RandomWalkableNode(grid, random);
+		} while (std::abs(end.x - start.x) + std::abs(end.y - start.y) > grid.GetCols() / 4);
+
+		auto chunkedStart = std::chrono::steady_clock::now();
+		bool found = chunkedSearch.FindPath(start, end, path);
+		auto referenceStart = std::chrono::steady_clock::now();
+		nodeBytes = std::max(nodeBytes, chunkedSearch.GetNodeBytes());
+		search.Begin(start, end);
+		bool referenceFound = AStarSearch::SEARCH_FOUND == search.Run();
+		if (referenceFound) {
+			search.BuildPath(referencePath);
+		}
+		auto referenceEnd = std::chrono::steady_clock::now();
+		chunkedTime += std::chrono::duration<double, std::milli>(referenceStart - chunkedStart).count();
+		referenceTime += std::chrono::duration<double, std::milli>(referenceEnd - referenceStart).count();
+
+		if (found != referenceFound || (found && (PathCost(grid, path) != PathCost(grid, referencePath) || chunkedSearch.GetPathCost() != PathCost(grid, path)))) {
+			++mismatches;
+		}
+	}
+
+	printf("%s,%d,%d,%u,%u,%u,%zu,%zu,%zu,%.1f,%.1f\n", name, numQueries, mismatches, world.GetFaultCount(), world.GetPrefetchCount(), world.GetEvictionCount(),
+		world.GetResidentBytes(), world.GetMemoryBudget(), nodeBytes, chunkedTime, referenceTime);
+	world.Close();
+	remove(worldFilename);
+	return mismatches;
+}
+
+}
+
+int main(int argc, char** argv) {
+	int size = argc > 1 ? atoi(argv[1]) : 2048;
+	int chunkSize = argc > 2 ? atoi(argv[2]) : 64;
+	size_t budget = (argc > 3 ? atoi(argv[3]) : 512) * 1024;
+	int numQueries = argc > 4 ? atoi(argv[4]) : 200;
+	const char* worldFilename = argc > 5 ? argv[5] : "WorldBench.world";
+
+	std::mt19937 random(12345);
+	CostGrid grid;
+	printf("map,queries,mismatches,faults,prefetches,evictions,resident_bytes,budget_bytes,node_bytes,chunked_ms,in_memory_ms\n");
+	BuildRandomGrid(grid, size, false, random);
+	int terrainMismatches = RunWorld("terrain", grid, chunkSize, budget, numQueries, worldFilename, random);
+	// Without a heuristic both searches expand every cell cheaper than the goal, fewer
+	// queries keep the run short
+	BuildRandomGrid(grid, size, true, random);
+	int roadMismatches = RunWorld("roads", grid, chunkSize, budget, std::max(numQueries / 8, 1), worldFilename, random);
+	return terrainMismatches == 0 && roadMismatches == 0 ? 0 : 1;
+}
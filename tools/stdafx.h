@@ -0,0 +1,15 @@
+#ifndef __TOOLS_STDAFX_H__
+#define __TOOLS_STDAFX_H__
+
+// Replaces the game precompiled header for the headless tools, which only build the
+// pathfinding sources that do not depend on MOAI
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#endif